@@ -2,11 +2,35 @@
 // function: print different calendar
 // author: Cerbere Ace (cerbere.ace@gmail.com)
 // license: [Unlicense](unlicense.txt)
+// build: cc -o calendar calendar.c -lm
+//        (POSIX systems only : mmap, writev, dirent... on Windows : Cygwin or MSYS2)
+//        (profiling build, with -stats counters : add -DCAL_STATS)
+//        (-pages written by a thread, while rendering : add -DCAL_THREADS -pthread)
+//        (checks : cc -fsanitize=address,undefined ... then calendar -check 1 3000)
+//        (fuzzing : clang -fsanitize=fuzzer,address,undefined -DCAL_FUZZ ...)
 
+//POSIX and BSD functions (strdup, lstat, madvise...) also with -std=c99/c11
+#define _DEFAULT_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <math.h>
 #include <time.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#ifdef CAL_THREADS
+#include <pthread.h>
+#endif
+#if defined(CAL_STATS) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#endif
 
 // WeekDay indexes
 #define SUNDAY		 0
@@ -39,6 +63,8 @@
 #define GREGORIAN_START_DAY     15
 #define GREGORIAN_START_MONTH   OCTOBER
 #define GREGORIAN_START_YEAR    1582
+#define JDN_GREGORIAN_EPOCH     1721426 //Julian Day Number of 01/01/0001 (Gregorian)
+#define JDN_JULIAN_EPOCH        1721424 //Julian Day Number of 01/01/0001 (Julian)
 
 
 #define OPT_NONE          'n'
@@ -52,6 +78,12 @@
 #define OPT_LYC_DEFAULT   'd'
 #define OPT_LYC_JULIAN    'j'
 #define OPT_LYC_GREGORIAN 'g'
+#define OPT_STATS_JSON    'j'
+#define OPT_FORMAT_TEXT   't'
+#define OPT_FORMAT_MD     'm'
+#define OPT_FORMAT_JSON   'j'
+#define OPT_FORMAT_CSV    'c'
+#define OPT_FORMAT_ICS    'i'
 
 //Options indexes
 #define OPT_IDX_WKN      0
@@ -67,12 +99,166 @@
 #define OPT_IDX_FIRSTWD  10
 #define OPT_IDX_NBCOL    11
 #define OPT_IDX_FIXED    12
+#define OPT_IDX_STATS    13 //Print statistics (profiling build)
+#define OPT_IDX_FORMAT   14 //Output format (text, markdown, json...)
 
 #define OPTS_IDX_PRINTED 4
+#define OPTS_NB          15
+
+//Statistics indexes
+#define STAT_IDX_FIRSTWD_CALLS   0
+#define STAT_IDX_WKN_CALLS       1
+#define STAT_IDX_OUTPUT_CALLS    2
+#define STAT_IDX_BYTES           3
+#define STAT_IDX_CYCLES_GRID     4
+#define STAT_IDX_CYCLES_LINEAR   5
+#define STAT_IDX_CYCLES_VERTICAL 6
+#define STAT_IDX_CYCLES_DAY      7
+#define STAT_IDX_CYCLES_FORMAT   8
+#define STAT_IDX_CYCLES_EPOCH    9
+
+#define STATS_NB                 10
+
+static const char* statsStr[STATS_NB]={
+  "getFirstWDMonth_calls",
+  "getWeekNumber_calls",
+  "output_calls",
+  "bytes_emitted",
+  "cycles_view_grid",
+  "cycles_view_linear",
+  "cycles_view_vertical",
+  "cycles_day_infos",
+  "cycles_formats",
+  "cycles_epoch"
+};
+
+//Counters : only in a profiling build (-DCAL_STATS), 
+//otherwise the macros are empty (no cost)
+#ifdef CAL_STATS
+static unsigned long long stats[STATS_NB];
+
+//Return a cycle counter (or nanoseconds if no cycle counter)
+static unsigned long long getCycles(void){
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec*1000000000ULL+ts.tv_nsec;
+#endif
+}
+
+#define STATS_ADD(idx, value)     (stats[(idx)]+=(value))
+#define STATS_START(var)          unsigned long long var=getCycles()
+#define STATS_STOP(idx, var)      STATS_ADD((idx), getCycles()-(var))
+#else
+#define STATS_ADD(idx, value)     ((void)0)
+#define STATS_START(var)
+#define STATS_STOP(idx, var)
+#endif
+
+//Output buffer : all calendars are written through it (see outFlush)
+#define OUT_BUFFER_SIZE 65536
+static char outBuffer[OUT_BUFFER_SIZE];
+static size_t outLength=0;
+static unsigned long long outFlushed=0;   //bytes written to stdout
+
+//Write the buffered output to stdout
+static void outFlush(void){
+  if(outLength>0){
+    fwrite(outBuffer, 1, outLength, stdout);
+    outFlushed=outFlushed+outLength;
+    outLength=0;
+  }
+  fflush(stdout);
+}
+
+//Add len characters to the output
+static void outWrite(const char* str, size_t len){
+  STATS_ADD(STAT_IDX_OUTPUT_CALLS, 1);
+  STATS_ADD(STAT_IDX_BYTES, len);
+  
+  if(outLength+len>OUT_BUFFER_SIZE){
+    outFlush();
+    //Too big for the buffer : write it directly
+    if(len>OUT_BUFFER_SIZE){
+      fwrite(str, 1, len, stdout);
+      outFlushed=outFlushed+len;
+      return;
+    }
+  }
+  memcpy(outBuffer+outLength, str, len);
+  outLength=outLength+len;
+}
+
+//Write all the fragments to the file descriptor (scatter/gather)
+static int writeFragments(int fd, struct iovec* fragments, int nbFragments){
+  ssize_t written;
+  
+  while(nbFragments>0){
+    written=writev(fd, fragments, nbFragments);
+    if(written<0){
+      if(errno==EINTR){
+        continue;
+      }
+      return -1;
+    }
+    //Skip the fragments written (a partial write is possible)
+    while(nbFragments>0 && (size_t)written>=fragments->iov_len){
+      written=written-fragments->iov_len;
+      fragments++;
+      nbFragments--;
+    }
+    if(nbFragments>0){
+      fragments->iov_base=(char*)fragments->iov_base+written;
+      fragments->iov_len=fragments->iov_len-written;
+    }
+  }
+  return 0;
+}
+
+//Add a string to the output
+static void outStr(const char* str){
+  outWrite(str, strlen(str));
+}
+
+//Add a formatted string to the output (printf-like)
+static void outPrintf(const char* format, ...){
+  va_list args;
+  int printed;
+  
+  STATS_ADD(STAT_IDX_OUTPUT_CALLS, 1);
+  
+  //Format directly in the free space of the buffer
+  va_start(args, format);
+  printed=vsnprintf(outBuffer+outLength, OUT_BUFFER_SIZE-outLength, format, args);
+  va_end(args);
+  
+  if(printed>=0 && (size_t)printed>=OUT_BUFFER_SIZE-outLength){
+    //Not enough space : flush and retry
+    outFlush();
+    va_start(args, format);
+    if(printed<OUT_BUFFER_SIZE){
+      printed=vsnprintf(outBuffer, OUT_BUFFER_SIZE, format, args);
+    }else{
+      //Too big for the buffer : write it directly
+      outFlushed=outFlushed+vprintf(format, args);
+      printed=0;
+    }
+    va_end(args);
+  }
+  
+  if(printed>0){
+    outLength=outLength+printed;
+    STATS_ADD(STAT_IDX_BYTES, printed);
+  }
+}
 
 
 //Chars for end of line 
 static const char endLine[4]="\n";
+//Chars for end of line (iCalendar, RFC 5545)
+static const char icsEndLine[4]="\r\n";
 
 static const char* headerStr[6]={
   "WkN", //week number
@@ -115,6 +301,241 @@ static const int daysPerMonth[12]={
   31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31
 };
 
+//Languages of the names (-lang=<code>[,<code>...]) : UTF-8 names (escaped),
+//printed by display columns (combining marks : 0 column, East Asian wide
+//characters : 2 columns). The truncated and padded names are prepared
+//once per language and per width, then copied as they are.
+#define LOCALES_NB          12
+#define NAME_SPAN_COLUMNS   96    //widths prepared (larger : computed)
+#define NAME_SPAN_SIZE      192
+#define NAME_WIDTHS_CACHED  8     //widths kept by language
+
+typedef struct {
+  const char* code;
+  const char* weekdays[7];
+  const char* months[12];
+} Locale;
+
+//A name ready to print
+typedef struct {
+  unsigned char size;
+  char str[NAME_SPAN_SIZE];
+} NameSpan;
+
+//Names of a language, for a width
+typedef struct {
+  int width;                //-1 : not used
+  NameSpan weekdays[7];
+  NameSpan months[12];
+} LocaleNames;
+
+static Locale locales[LOCALES_NB]={
+  //English (the names of the program)
+  {"en", {NULL}, {NULL}},
+  //French
+  {"fr",
+   {"Dimanche", "Lundi", "Mardi", "Mercredi", "Jeudi", "Vendredi", "Samedi"},
+   {"Janvier", "F\303\251vrier", "Mars", "Avril", "Mai", "Juin", "Juillet",
+    "Ao\303\273t", "Septembre", "Octobre", "Novembre", "D\303\251cembre"}},
+  //German
+  {"de",
+   {"Sonntag", "Montag", "Dienstag", "Mittwoch", "Donnerstag", "Freitag", "Samstag"},
+   {"Januar", "Februar", "M\303\244rz", "April", "Mai", "Juni", "Juli", "August",
+    "September", "Oktober", "November", "Dezember"}},
+  //Spanish
+  {"es",
+   {"Domingo", "Lunes", "Martes", "Mi\303\251rcoles", "Jueves", "Viernes",
+    "S\303\241bado"},
+   {"Enero", "Febrero", "Marzo", "Abril", "Mayo", "Junio", "Julio", "Agosto",
+    "Septiembre", "Octubre", "Noviembre", "Diciembre"}},
+  //Italian
+  {"it",
+   {"Domenica", "Luned\303\254", "Marted\303\254", "Mercoled\303\254", "Gioved\303\254",
+    "Venerd\303\254", "Sabato"},
+   {"Gennaio", "Febbraio", "Marzo", "Aprile", "Maggio", "Giugno", "Luglio", "Agosto",
+    "Settembre", "Ottobre", "Novembre", "Dicembre"}},
+  //Portuguese
+  {"pt",
+   {"Domingo", "Segunda-feira", "Ter\303\247a-feira", "Quarta-feira", "Quinta-feira",
+    "Sexta-feira", "S\303\241bado"},
+   {"Janeiro", "Fevereiro", "Mar\303\247o", "Abril", "Maio", "Junho", "Julho", "Agosto",
+    "Setembro", "Outubro", "Novembro", "Dezembro"}},
+  //Dutch
+  {"nl",
+   {"Zondag", "Maandag", "Dinsdag", "Woensdag", "Donderdag", "Vrijdag", "Zaterdag"},
+   {"Januari", "Februari", "Maart", "April", "Mei", "Juni", "Juli", "Augustus",
+    "September", "Oktober", "November", "December"}},
+  //Swedish
+  {"sv",
+   {"S\303\266ndag", "M\303\245ndag", "Tisdag", "Onsdag", "Torsdag", "Fredag",
+    "L\303\266rdag"},
+   {"Januari", "Februari", "Mars", "April", "Maj", "Juni", "Juli", "Augusti",
+    "September", "Oktober", "November", "December"}},
+  //Finnish
+  {"fi",
+   {"Sunnuntai", "Maanantai", "Tiistai", "Keskiviikko", "Torstai", "Perjantai",
+    "Lauantai"},
+   {"Tammikuu", "Helmikuu", "Maaliskuu", "Huhtikuu", "Toukokuu", "Kes\303\244kuu",
+    "Hein\303\244kuu", "Elokuu", "Syyskuu", "Lokakuu", "Marraskuu", "Joulukuu"}},
+  //Polish
+  {"pl",
+   {"Niedziela", "Poniedzia\305\202ek", "Wtorek", "\305\232roda", "Czwartek",
+    "Pi\304\205tek", "Sobota"},
+   {"Stycze\305\204", "Luty", "Marzec", "Kwiecie\305\204", "Maj", "Czerwiec", "Lipiec",
+    "Sierpie\305\204", "Wrzesie\305\204", "Pa\305\272dziernik", "Listopad",
+    "Grudzie\305\204"}},
+  //Russian
+  {"ru",
+   {"\320\222\320\276\321\201\320\272\321\200\320\265\321\201\320\265\320\275\321\214\320\265",
+    "\320\237\320\276\320\275\320\265\320\264\320\265\320\273\321\214\320\275\320\270\320\272",
+    "\320\222\321\202\320\276\321\200\320\275\320\270\320\272",
+    "\320\241\321\200\320\265\320\264\320\260",
+    "\320\247\320\265\321\202\320\262\320\265\321\200\320\263",
+    "\320\237\321\217\321\202\320\275\320\270\321\206\320\260",
+    "\320\241\321\203\320\261\320\261\320\276\321\202\320\260"},
+   {"\320\257\320\275\320\262\320\260\321\200\321\214",
+    "\320\244\320\265\320\262\321\200\320\260\320\273\321\214",
+    "\320\234\320\260\321\200\321\202",
+    "\320\220\320\277\321\200\320\265\320\273\321\214", "\320\234\320\260\320\271",
+    "\320\230\321\216\320\275\321\214", "\320\230\321\216\320\273\321\214",
+    "\320\220\320\262\320\263\321\203\321\201\321\202",
+    "\320\241\320\265\320\275\321\202\321\217\320\261\321\200\321\214",
+    "\320\236\320\272\321\202\321\217\320\261\321\200\321\214",
+    "\320\235\320\276\321\217\320\261\321\200\321\214",
+    "\320\224\320\265\320\272\320\260\320\261\321\200\321\214"}},
+  //Japanese
+  {"ja",
+   {"\346\227\245\346\233\234\346\227\245", "\346\234\210\346\233\234\346\227\245",
+    "\347\201\253\346\233\234\346\227\245", "\346\260\264\346\233\234\346\227\245",
+    "\346\234\250\346\233\234\346\227\245", "\351\207\221\346\233\234\346\227\245",
+    "\345\234\237\346\233\234\346\227\245"},
+   {"1\346\234\210", "2\346\234\210", "3\346\234\210", "4\346\234\210", "5\346\234\210",
+    "6\346\234\210", "7\346\234\210", "8\346\234\210", "9\346\234\210",
+    "10\346\234\210", "11\346\234\210", "12\346\234\210"}},
+};
+
+static const Locale* currentLocale=&locales[0];
+static LocaleNames localeNames[LOCALES_NB][NAME_WIDTHS_CACHED];
+static int localeNamesReady=0;
+
+//Return the number of columns of a character (code point)
+static int getCharColumns(unsigned int code){
+  if((code>=0x0300 && code<=0x036F) || code==0x200B){
+    return 0;
+  }
+  if((code>=0x1100 && code<=0x115F) || (code>=0x2E80 && code<=0xA4CF)
+     || (code>=0xAC00 && code<=0xD7A3) || (code>=0xF900 && code<=0xFAFF)
+     || (code>=0xFF00 && code<=0xFF60) || (code>=0xFFE0 && code<=0xFFE6)
+     || (code>=0x20000 && code<=0x3FFFD)){
+    return 2;
+  }
+  return 1;
+}
+
+//Read an UTF-8 character, return its size (bytes)
+static int readUtf8(const char* str, unsigned int* code){
+  const unsigned char* bytes=(const unsigned char*)str;
+  int size=(bytes[0]<0x80) ? 1 : (bytes[0]<0xE0) ? 2 : (bytes[0]<0xF0) ? 3 : 4;
+  int idx;
+  
+  *code=(size==1) ? bytes[0] : bytes[0]&(0x3F>>(size-1));
+  for(idx=1; idx<size; idx++){
+    if((bytes[idx]&0xC0)!=0x80){
+      //Invalid : a byte as a character
+      *code=bytes[0];
+      return 1;
+    }
+    *code=(*code<<6)|(bytes[idx]&0x3F);
+  }
+  return size;
+}
+
+//Set a name truncated or padded to a width (columns, 0 : the full name)
+static void setNameSpan(NameSpan* span, const char* name, int width){
+  int size=0, columns=0, charSize, charColumns;
+  unsigned int code;
+  
+  while(name[size]!='\0' && size<NAME_SPAN_SIZE-4){
+    charSize=readUtf8(name+size, &code);
+    charColumns=getCharColumns(code);
+    if(width>0 && columns+charColumns>width){
+      break;
+    }
+    memcpy(span->str+size, name+size, charSize);
+    size=size+charSize;
+    columns=columns+charColumns;
+  }
+  for(; columns<width && size<NAME_SPAN_SIZE; columns++){
+    span->str[size++]=' ';
+  }
+  span->size=(unsigned char)size;
+}
+
+//Set the English names, and clear the names prepared
+static void initLocales(void){
+  int idx, slot;
+  
+  for(idx=0; idx<7; idx++){
+    locales[0].weekdays[idx]=weekdays[idx];
+  }
+  for(idx=0; idx<12; idx++){
+    locales[0].months[idx]=months[idx];
+  }
+  for(idx=0; idx<LOCALES_NB; idx++){
+    for(slot=0; slot<NAME_WIDTHS_CACHED; slot++){
+      localeNames[idx][slot].width=-1;
+    }
+  }
+  localeNamesReady=1;
+}
+
+//Return the language of a code (-1 if unknown)
+static int getLocaleIdx(const char* code, size_t length){
+  int idx;
+  
+  for(idx=0; idx<LOCALES_NB; idx++){
+    if(strlen(locales[idx].code)==length && strncmp(locales[idx].code, code, length)==0){
+      return idx;
+    }
+  }
+  return -1;
+}
+
+//Return the names of the current language for a width (prepared once)
+static const LocaleNames* getLocaleNames(int width){
+  static LocaleNames wideNames;
+  LocaleNames* names;
+  int localeIdx, slot, idx;
+  
+  if(!localeNamesReady){
+    initLocales();
+  }
+  localeIdx=(int)(currentLocale-locales);
+  names=localeNames[localeIdx];
+  for(slot=0; slot<NAME_WIDTHS_CACHED && names[slot].width>=0; slot++){
+    if(names[slot].width==width){
+      return &names[slot];
+    }
+  }
+  
+  //Not prepared : a free slot (or the last one), or not kept if too wide
+  if(width>NAME_SPAN_COLUMNS){
+    names=&wideNames;
+  }else{
+    names=&names[(slot<NAME_WIDTHS_CACHED) ? slot : NAME_WIDTHS_CACHED-1];
+  }
+  names->width=width;
+  for(idx=0; idx<7; idx++){
+    setNameSpan(&names->weekdays[idx], currentLocale->weekdays[idx], 
+                (width>NAME_SPAN_COLUMNS) ? NAME_SPAN_COLUMNS : width);
+  }
+  for(idx=0; idx<12; idx++){
+    setNameSpan(&names->months[idx], currentLocale->months[idx], 
+                (width>NAME_SPAN_COLUMNS) ? NAME_SPAN_COLUMNS : width);
+  }
+  return names;
+}
+
 //Print a day number
 static void printDayNumber(int dayNumber, int numLetters, char separator){
   int c;
@@ -131,63 +552,43 @@ static void printDayNumber(int dayNumber, int numLetters, char separator){
   
   //space the missing characters
   for(c=nbDigits; c<numLetters; c++){
-    printf("%c", separator);
+    outPrintf("%c", separator);
   }
   
   //And print the day number
-  printf("%d", dayNumber);
+  outPrintf("%d", dayNumber);
 }
 
-//Print the day name, of numLetter length
+//Print the day name, of numLetter length (display columns)
 static void printWeekDayName(int dayWeek, int numLetters){
-  int c;
-  int len=strlen(weekdays[dayWeek]);
-  if(numLetters==0 || len<=numLetters){
-    //Length OK : print the weekday
-    printf("%s", weekdays[dayWeek]);
-    //Add spaces to complete the size
-    for(c=len;c<numLetters;c++){
-      printf(" ");
-    }
-  }else{
-    //Print the numLetters characters of the weekday name
-    for(c=0;c<numLetters;c++){
-      printf("%c", (weekdays[dayWeek])[c]);
-    }
-  }
+  const NameSpan* span=&getLocaleNames(numLetters)->weekdays[dayWeek];
+  outWrite(span->str, span->size);
 }
 
-//return the month name, of numLetter length
+//return the month name, of numLetter length (display columns)
 static void printMonthName(int month, int numLetters){
-  int c;
-  int len=strlen(months[month]);
-  if(numLetters==0 || len<=numLetters){
-    //Length OK : print the month
-    printf("%s", months[month]);
-    //Add spaces to complete the size
-    for(c=len;c<numLetters;c++){
-      printf(" ");
-    }
-  }else{
-    //Print the numLetters characters of the Month name
-    for(c=0;c<numLetters;c++){
-      printf("%c", (months[month])[c]);
-    }
-  }
+  const NameSpan* span=&getLocaleNames(numLetters)->months[month];
+  outWrite(span->str, span->size);
+}
+
+//Return 1 if the year uses the Gregorian calendar, 0 if the Julian one
+//Depending of the OPT_IDX_LYC option
+static int isGregorianYear(int year, char* opts){
+  int checkGregorianOpt=(opts[OPT_IDX_LYC]==OPT_LYC_GREGORIAN);
+  int checkDefaultOpt=(opts[OPT_IDX_LYC]==OPT_LYC_DEFAULT);
+  
+  return (checkGregorianOpt || (checkDefaultOpt && year>GREGORIAN_START_YEAR));
 }
 
 //Return 0 if not a leap year, 1 if is a leap year
 //Depending of the OPT_IDX_LYC option
 static int isLeapYear(int year, char* opts){
   int leapDay;
-  int checkGregorianOpt=(opts[OPT_IDX_LYC]==OPT_LYC_GREGORIAN);
-  int checkJulianOpt=(opts[OPT_IDX_LYC]==OPT_LYC_JULIAN);
-  int checkDefaultOpt=(opts[OPT_IDX_LYC]==OPT_LYC_DEFAULT);
   
-  if(checkGregorianOpt || (checkDefaultOpt && year>GREGORIAN_START_YEAR)){
+  if(isGregorianYear(year, opts)){
     //Gregorian calculation
     leapDay=(((year%4==0) && (year%100!=0)) || year%400==0);
-  }else if(checkJulianOpt || (checkDefaultOpt && year<=GREGORIAN_START_YEAR)){
+  }else{
     //Julian calculation
     leapDay=(year%4==0);
   }
@@ -298,18 +699,89 @@ static int getDaysInfYear(int year, char* opts){
   return getDayOfYear(daysInDecember, DECEMBER, year, opts);
 }
 
+//Return the number of leap years from year 1 to year (or a difference if
+//year<1), with the Gregorian or the Julian calculation
+static long long countLeapYears(long long year, int gregorian){
+  //Floor divisions (also correct for negative years)
+  long long div4=(year>=0) ? year/4 : -((-year+3)/4);
+  long long div100=(year>=0) ? year/100 : -((-year+99)/100);
+  long long div400=(year>=0) ? year/400 : -((-year+399)/400);
+  
+  if(gregorian){
+    return div4-div100+div400;
+  }
+  return div4;
+}
+
+//Return the Julian Day Number of a date (days since 1st January 4713 BC),
+//in the Gregorian or the Julian calendar of the year
+static long long getJulianDayNumber(int day, int month, int year, char* opts){
+  int gregorian=isGregorianYear(year, opts);
+  long long jdn=(gregorian) ? JDN_GREGORIAN_EPOCH : JDN_JULIAN_EPOCH;
+  
+  jdn=jdn+365LL*(year-1)+countLeapYears((long long)year-1, gregorian);
+  return jdn+getDayOfYear(day, month, year, opts)-1;
+}
+
+//Return the 1st Julian Day Number using the Gregorian calendar
+static long long getGregorianStartDayNumber(char* opts){
+  if(opts[OPT_IDX_LYC]==OPT_LYC_GREGORIAN){
+    return -(1LL<<62);
+  }
+  if(opts[OPT_IDX_LYC]==OPT_LYC_JULIAN){
+    return 1LL<<62;
+  }
+  //Default : the Julian years end with GREGORIAN_START_YEAR (the last 
+  //Julian days of this year are not reached)
+  return getJulianDayNumber(1, JANUARY, GREGORIAN_START_YEAR+1, opts);
+}
+
+//Set the date of a Julian Day Number (the reverse of getJulianDayNumber)
+static void getDateOfDayNumber(long long dayNumber, int* day, int* month, 
+                               int* year, char* opts){
+  long long days, era, dayOfEra, yearOfEra, dayOfYear, monthShift;
+  
+  //Days from the 1st March of the year 0 (the leap day at the end)
+  if(dayNumber>=getGregorianStartDayNumber(opts)){
+    days=dayNumber-(JDN_GREGORIAN_EPOCH-306);
+    era=(days-(days<0)*146096)/146097;
+    dayOfEra=days-era*146097;
+    yearOfEra=(dayOfEra-dayOfEra/1460+dayOfEra/36524-dayOfEra/146096)/365;
+    dayOfYear=dayOfEra-(365*yearOfEra+yearOfEra/4-yearOfEra/100);
+    yearOfEra=yearOfEra+era*400;
+  }else{
+    days=dayNumber-(JDN_JULIAN_EPOCH-306);
+    era=(days-(days<0)*1460)/1461;
+    dayOfEra=days-era*1461;
+    yearOfEra=(dayOfEra-dayOfEra/1460)/365;
+    dayOfYear=dayOfEra-365*yearOfEra;
+    yearOfEra=yearOfEra+era*4;
+  }
+  
+  monthShift=(5*dayOfYear+2)/153;
+  *day=(int)(dayOfYear-(153*monthShift+2)/5+1);
+  *month=(int)((monthShift<10) ? monthShift+2 : monthShift-10);
+  *year=(int)(yearOfEra+(*month<=FEBRUARY));
+}
+
+//Return the WeekDay of a Julian Day Number
+static int getWeekDayOfDayNumber(long long dayNumber){
+  return (int)(((dayNumber+1)%7+7)%7);
+}
+
 //Return the first WeekDay of the month
 static int getFirstWDMonth(int month, int year, char* opts){
-  int tYear, yearsRemaining;
   int calWD, calDay, calMonth, calYear;
   int firstWD;
-  int daysInMonth;
   int signValue;
   int previousDays;
+  int gregorian;
+  long long yearsDays;
   int checkGregorianOpt=(opts[OPT_IDX_LYC]==OPT_LYC_GREGORIAN);
-  int checkJulianOpt=(opts[OPT_IDX_LYC]==OPT_LYC_JULIAN);
   int checkDefaultOpt=(opts[OPT_IDX_LYC]==OPT_LYC_DEFAULT);
   
+  STATS_ADD(STAT_IDX_FIRSTWD_CALLS, 1);
+  
   //Check if date is After Or before the GREGORIAN_START_YEAR
   if(year>GREGORIAN_START_YEAR){
     signValue=1;
@@ -317,13 +789,14 @@ static int getFirstWDMonth(int month, int year, char* opts){
     signValue=-1;
   }
   
-  if(checkGregorianOpt || (checkDefaultOpt && signValue>0)){
+  gregorian=(checkGregorianOpt || (checkDefaultOpt && signValue>0));
+  if(gregorian){
     //Gregorian References point
     calDay=GREGORIAN_START_DAY;
     calMonth=GREGORIAN_START_MONTH;
     calYear=GREGORIAN_START_YEAR;
     calWD=GREGORIAN_START_WEEKDAY;
-  }else if(checkJulianOpt || (checkDefaultOpt && signValue<0)){
+  }else{
     //Julian References point
     calDay=JULIAN_END_DAY;
     calMonth=JULIAN_END_MONTH;
@@ -335,18 +808,18 @@ static int getFirstWDMonth(int month, int year, char* opts){
   previousDays=1-getDayOfYear(calDay, calMonth, calYear, opts);
   firstWD=changeWeekDay(calWD, previousDays);
   
-  //If backward year, begin with the previous year (as current year is done)
-  if(signValue<0){
-    calYear=calYear-1;
-  }
-  
-  //For each year (previous or next, depending of the signValue)
-  tYear=calYear;
-  while((signValue<0 && year<=tYear) || (signValue>0 && tYear<year)){
-    //remove/add 1 day (+1 day if it's a leap year)
-    firstWD=changeWeekDay(firstWD, (signValue*(1+isLeapYear(tYear, opts))));
-    tYear=tYear+signValue;
+  //Add/remove 1 day per year (+1 day per leap year) between the years,
+  //the years between use the same calculation than the reference point
+  if(signValue>0){
+    //years from calYear to year-1
+    yearsDays=(long long)year-calYear
+              +countLeapYears(year-1, gregorian)-countLeapYears(calYear-1, gregorian);
+  }else{
+    //years from year to calYear-1 (backward)
+    yearsDays=-((long long)calYear-year
+                +countLeapYears(calYear-1, gregorian)-countLeapYears(year-1, gregorian));
   }
+  firstWD=changeWeekDay(firstWD, (int)(yearsDays%7));
   
   //Add the days passed until the month
   firstWD=changeWeekDay(firstWD, getDayOfYear(0, month, year, opts));
@@ -405,45 +878,174 @@ static int getNumberWeeksMonth(int month, int year, char* opts){
   return nbWeeks;
 }
 
-//Return the weekNumber (ISO weekday !)
-static int getWeekNumber(int day, int month, int year, char* opts){
-  int daysPassed;
-  int daysOnset, daysOffset, weekday, firstDayOfYear;
-  int weekNumber, maxWeeks;
-  int firstWD=opts[OPT_IDX_FIRSTWD]-'0';
+//Week rule (-weeks=) : the 1st weekday, the minimal days of the 1st 
+//January week to be the week 1 (else it's the last week of the previous 
+//year), and the split of the weeks at the end of the year (the days after
+//the last week are in the week 1 of the next year, if not split)
+//Without rule : the ISO numbers, with the days of the weeks printed
+typedef struct {
+  int enabled;
+  int firstWeekday;
+  int minDays;         //1-7 (1 if split)
+  int split;           //1 : the year ends the week (week 53 or 54)
+} WeekRule;
+
+typedef struct {
+  const char* name;
+  WeekRule rule;
+} NamedWeekRule;
+
+static WeekRule weekRule;
+
+static const NamedWeekRule namedWeekRules[]={
+  {"iso",       {1, MONDAY,   4, 0}},
+  {"us",        {1, SUNDAY,   1, 1}},
+  {"mideast",   {1, SATURDAY, 1, 1}},
+  {"broadcast", {1, MONDAY,   1, 0}}
+};
+#define NAMED_WEEK_RULES_NB ((int)(sizeof(namedWeekRules)/sizeof(namedWeekRules[0])))
+
+//Parse a week rule : a name, or "<weekday>/<minDays>[/split]", return 0
+//if valid (a split rule has the minDays 1 : its week 1 always holds the
+//1st January, so "<weekday>/1/split" only)
+static int parseWeekRule(const char* str, WeekRule* rule){
+  char buffer[64];
+  char* item;
+  char* end;
+  int idx;
+  
+  for(idx=0; idx<NAMED_WEEK_RULES_NB; idx++){
+    if(strcmp(str, namedWeekRules[idx].name)==0){
+      *rule=namedWeekRules[idx].rule;
+      return 0;
+    }
+  }
+  
+  snprintf(buffer, sizeof(buffer), "%s", str);
+  item=strtok(buffer, "/");
+  for(idx=SUNDAY; item!=NULL && idx<=SATURDAY; idx++){
+    if(strcasecmp(item, weekdays[idx])==0){
+      break;
+    }
+  }
+  item=strtok(NULL, "/");
+  if(idx>SATURDAY || item==NULL){
+    return -1;
+  }
+  rule->enabled=1;
+  rule->firstWeekday=idx;
+  rule->minDays=(int)strtol(item, &end, 10);
+  if(end==item || *end!='\0' || rule->minDays<1 || rule->minDays>7){
+    return -1;
+  }
+  item=strtok(NULL, "/");
+  rule->split=(item!=NULL);
+  if(item!=NULL && (strcmp(item, "split")!=0 || strtok(NULL, "/")!=NULL
+                    || rule->minDays!=1)){
+    return -1;
+  }
+  return 0;
+}
+
+//Return 1 if a rule is the current week rule (values computed with it)
+static int isWeekRule(const WeekRule* rule){
+  return rule->enabled==weekRule.enabled && rule->firstWeekday==weekRule.firstWeekday
+         && rule->minDays==weekRule.minDays && rule->split==weekRule.split;
+}
+
+//Return the day of the year starting the week 1 (-5 to 7), with the rule
+static int getRuleWeek1Start(int year, char* opts){
+  int daysBefore=(getFirstWDMonth(JANUARY, year, opts)-weekRule.firstWeekday+7)%7;
+  
+  if(weekRule.split || 7-daysBefore>=weekRule.minDays){
+    return 1-daysBefore;
+  }
+  return 8-daysBefore;
+}
 
-  //get the days passed
-  daysPassed=getDayOfYear(day, month, year, opts);
+//Week numbers of a year : the values needed for any day of the year
+typedef struct {
+  int year;
+  char firstWD;        //options of the values
+  char lyc;
+  WeekRule rule;       //week rule of the values
+  int firstDayOfYear;  //Weekday of the 1st January
+  int daysOnset;       //days present in the 1st week of January
+  int firstWeek;       //week number of these days (1, 52 or 53)
+  int maxWeeks;        //52 or 53 weeks (54 : split week rule)
+  int week1Start;      //week rule : day of the year starting the week 1
+  int previousWeeks;   //week rule : weeks of the previous year
+} YearWeeks;
+
+#define WEEK_TABLES_SIZE 64   //years kept (week numbers)
+
+static YearWeeks weekTables[WEEK_TABLES_SIZE];
+
+//Set the week number values of the year
+static void initYearWeeks(int year, char* opts, YearWeeks* weeks){
+  int firstDayOfYear;
   
   //get the 1st Day of the year
   firstDayOfYear=getFirstWDMonth(JANUARY, year, opts);
+  weeks->year=year;
+  weeks->firstWD=opts[OPT_IDX_FIRSTWD];
+  weeks->lyc=opts[OPT_IDX_LYC];
+  weeks->rule=weekRule;
+  weeks->firstDayOfYear=firstDayOfYear;
   
   //Calculate the days present in the 1st week of January
-  daysOnset=getOffsetMonth(1, JANUARY, year, opts);
+  weeks->daysOnset=getOffsetMonth(1, JANUARY, year, opts);
   
-  //Calculate the days absent (offset) in the 1st week of January
-  daysOffset=getOffsetMonth(-1, JANUARY, year, opts);
+  //Week rule : weeks from the start of the week 1
+  if(weekRule.enabled){
+    weeks->week1Start=getRuleWeek1Start(year, opts);
+    if(weekRule.split){
+      weeks->maxWeeks=(getDaysInfYear(year, opts)-weeks->week1Start+7)/7;
+      weeks->previousWeeks=0;
+    }else{
+      weeks->maxWeeks=(getDaysInfYear(year, opts)+getRuleWeek1Start(year+1, opts)
+                       -weeks->week1Start)/7;
+      weeks->previousWeeks=(getDaysInfYear(year-1, opts)+weeks->week1Start
+                            -getRuleWeek1Start(year-1, opts))/7;
+    }
+    weeks->firstWeek=(weeks->week1Start>1) ? weeks->previousWeeks : 1;
+    return;
+  }
   
   if(firstDayOfYear==SUNDAY || firstDayOfYear>=FRIDAY){
     //if it's Friday OR Saturday with leapYearN-1
     if((firstDayOfYear==FRIDAY) || (firstDayOfYear==SATURDAY && isLeapYear(year-1, opts))){
-      weekNumber=53;
+      weeks->firstWeek=53;
     }else{
       //Sunday OR Saturday without LeapYearN-1
-      weekNumber=52;
+      weeks->firstWeek=52;
     }
   }else{
-    weekNumber=1;
+    weeks->firstWeek=1;
   }
   
   //Calculate if there are 52 or 53 weeks for this year (limit)
   if((firstDayOfYear==THURSDAY) 
       || (firstDayOfYear==WEDNESDAY && isLeapYear(year, opts))){
-    maxWeeks=53;
+    weeks->maxWeeks=53;
   }else{
-    maxWeeks=52;
+    weeks->maxWeeks=52;
   }
+}
 
+//Return the weekNumber of the day of the year (ISO weekday !)
+static int getYearWeekNumber(int daysPassed, YearWeeks* weeks){
+  int daysOnset=weeks->daysOnset;
+  int weekNumber=weeks->firstWeek;
+  
+  if(weekRule.enabled){
+    if(daysPassed<weeks->week1Start){
+      return weeks->previousWeeks;
+    }
+    weekNumber=(daysPassed-weeks->week1Start)/7+1;
+    return (weekNumber>weeks->maxWeeks) ? 1 : weekNumber;
+  }
+  
   if(daysPassed>daysOnset){
     //get the number of full weeks
     weekNumber=(daysPassed-daysOnset)/7;
@@ -458,13 +1060,13 @@ static int getWeekNumber(int day, int month, int year, char* opts){
       weekNumber++;
       
       //remove 1 week if year start with week 52 or 53
-      if(firstDayOfYear==SUNDAY || firstDayOfYear>=FRIDAY){
+      if(weeks->firstDayOfYear==SUNDAY || weeks->firstDayOfYear>=FRIDAY){
         weekNumber=weekNumber-1;
       }
     }
 
     //Set to W1 if weekNumber exceed the number of weeks expected
-    if(weekNumber>maxWeeks){
+    if(weekNumber>weeks->maxWeeks){
         weekNumber=1;
     }
   }
@@ -472,879 +1074,6270 @@ static int getWeekNumber(int day, int month, int year, char* opts){
   return weekNumber;
 }
 
-//Return the number of characters used for headers
-static int getSizeHeader(char* opts){
-  int cPos, headerIdx;
-  int tmpCheckOpt, checkLeft, checkRight;
-  int sizeResult=0;
-  
-  for(cPos=-1; cPos<2; cPos++){
-    for(headerIdx=0; headerIdx<OPTS_IDX_PRINTED; headerIdx++){
-      tmpCheckOpt=(opts[headerIdx]==OPT_LEFT || opts[headerIdx]==OPT_BOTH);
-      checkLeft=(cPos<0 && tmpCheckOpt);
-      tmpCheckOpt=(opts[headerIdx]==OPT_RIGHT || opts[headerIdx]==OPT_BOTH);
-      checkRight=(cPos>0 && tmpCheckOpt);
-        
-      if(opts[headerIdx]!=OPT_NONE){
-        //Right Column : add a space BEFORE writing the week header
-        if(checkRight){
-          sizeResult++;
-        }
+//Return the weekNumber (ISO weekday !)
+static int getWeekNumber(int day, int month, int year, char* opts){
+  YearWeeks* weeks=&weekTables[year&(WEEK_TABLES_SIZE-1)];
 
-        if(checkLeft || checkRight){
-          sizeResult=sizeResult+strlen(headerStr[headerIdx]);
-        }
-        
-        //Left Column: Add a space AFTER writing the week header
-        if(checkLeft){
-          sizeResult++;
-        }
-      }
-    }
+  STATS_ADD(STAT_IDX_WKN_CALLS, 1);
+
+  //Week values of the year, kept for the next days
+  if(weeks->year!=year || weeks->firstWD!=opts[OPT_IDX_FIRSTWD] 
+     || weeks->lyc!=opts[OPT_IDX_LYC] || !isWeekRule(&weeks->rule)){
+    initYearWeeks(year, opts, weeks);
   }
+  return getYearWeekNumber(getDayOfYear(day, month, year, opts), weeks);
+}
 
-  return sizeResult;
+//Iterators over the days of a range, or over its weeks or months (groups
+//of days) : the values of each day are computed from the previous day, 
+//the state is the iterator (no allocation), for the programs using the 
+//calendar values instead of the text
+//e.g. initCalIterator(&it, 1, JANUARY, 2024, 31, DECEMBER, 2024, opts);
+//     while(nextCalDay(&it, &record)){ ... }
+typedef struct {
+  long long dayNumber;  //Julian Day Number
+  int day;              //1-31
+  int month;            //0-11
+  int year;
+  int weekday;          //0-6 : Sunday to Saturday
+  int weekNumber;       //ISO, or the -weeks= rule
+  int dayOfYear;        //1-366
+  int daysLeft;         //days after this day, in the year
+  int leap;             //1 : leap year
+} DayRecord;
+
+//Days of a week or of a month, in the range
+typedef struct {
+  DayRecord first;
+  DayRecord last;
+  int nbDays;
+} GroupRecord;
+
+typedef struct {
+  DayRecord next;       //next day returned
+  int daysInMonth;
+  int daysInYear;
+  long long endKey;     //last day : year*512+month*32+day
+  int done;
+  YearWeeks weeks;      //week numbers of the year of the next day
+  char* opts;
+} CalIterator;
+
+//Return the key of a date (to compare the dates)
+static long long getCalIteratorKey(int day, int month, int year){
+  return (long long)year*512+month*32+day;
 }
 
-//print the headerIdx header
-//cPos=-1 : a left column, cPos=1 : a right column
-//cPos=-2 : Force left column, 
-// cPos=0 : force centered
-// cPos=2 : Force right column
-static void printHeader(int headerIdx, int cPos, char* opts){
-  int checkLeft=(cPos<0);
-  int checkRight=(cPos>0);
-  if(cPos==-1){
-    checkLeft=(opts[headerIdx]==OPT_LEFT || opts[headerIdx]==OPT_BOTH);
+//Set the values of the next day from its date (1st day, or a new year)
+static void setCalIteratorDate(CalIterator* it, int day, int month, int year){
+  DayRecord* next=&it->next;
+  
+  next->day=day;
+  next->month=month;
+  next->year=year;
+  next->dayNumber=getJulianDayNumber(day, month, year, it->opts);
+  next->weekday=getWeekDay(day, month, year, it->opts);
+  next->dayOfYear=getDayOfYear(day, month, year, it->opts);
+  next->leap=isLeapYear(year, it->opts);
+  it->daysInYear=getDaysInfYear(year, it->opts);
+  it->daysInMonth=getDaysPerMonth(month, year, it->opts);
+  initYearWeeks(year, it->opts, &it->weeks);
+  next->daysLeft=it->daysInYear-next->dayOfYear;
+  next->weekNumber=getYearWeekNumber(next->dayOfYear, &it->weeks);
+}
+
+//Start an iterator on the days from..to (dates included)
+//Return 0 if OK, -1 if a date is not valid
+static int initCalIterator(CalIterator* it, int dayFrom, int monthFrom, int yearFrom,
+                           int dayTo, int monthTo, int yearTo, char* opts){
+  memset(it, 0, sizeof(CalIterator));
+  it->opts=opts;
+  if(yearFrom<1 || yearTo<1 || monthFrom<JANUARY || monthFrom>DECEMBER 
+     || monthTo<JANUARY || monthTo>DECEMBER || dayFrom<1 || dayTo<1
+     || dayFrom>getDaysPerMonth(monthFrom, yearFrom, opts)
+     || dayTo>getDaysPerMonth(monthTo, yearTo, opts)){
+    it->done=1;
+    return -1;
   }
-  if(cPos==1){
-    checkRight=(opts[headerIdx]==OPT_RIGHT || opts[headerIdx]==OPT_BOTH);
+  it->endKey=getCalIteratorKey(dayTo, monthTo, yearTo);
+  it->done=(getCalIteratorKey(dayFrom, monthFrom, yearFrom)>it->endKey);
+  setCalIteratorDate(it, dayFrom, monthFrom, yearFrom);
+  return 0;
+}
+
+//Set the next day record, return 0 at the end of the range
+static int nextCalDay(CalIterator* it, DayRecord* record){
+  DayRecord* next=&it->next;
+  
+  if(it->done){
+    return 0;
+  }
+  *record=*next;
+  if(getCalIteratorKey(next->day, next->month, next->year)>=it->endKey){
+    it->done=1;
+    return 1;
   }
   
-  if(cPos!=-1 || cPos!=1 || opts[headerIdx]!=OPT_NONE){
-    //Right Column : add a space BEFORE writing the week header
-    if(checkRight){
-      printf(" ");
-    }
+  //Next day : the same year, or a new year (the values of the new year, 
+  //and the days removed by the Gregorian calendar)
+  if(next->day<it->daysInMonth){
+    next->day++;
+  }else if(next->month<DECEMBER){
+    next->day=1;
+    next->month++;
+    it->daysInMonth=getDaysPerMonth(next->month, next->year, it->opts);
+  }else{
+    setCalIteratorDate(it, 1, JANUARY, next->year+1);
+    return 1;
+  }
+  next->dayNumber++;
+  next->weekday=changeWeekDay(next->weekday, 1);
+  next->dayOfYear++;
+  next->daysLeft--;
+  next->weekNumber=getYearWeekNumber(next->dayOfYear, &it->weeks);
+  return 1;
+}
 
-    if(cPos==0 || checkLeft || checkRight){
-      //Print the header
-      printf("%s", headerStr[headerIdx]);
+//Set the next group of days (unit : 'w' weeks, 'm' months), return 0 at
+//the end of the range (the 1st and last groups can be partial)
+static int nextCalGroup(CalIterator* it, char unit, GroupRecord* group){
+  const DayRecord* next=&it->next;
+  
+  group->nbDays=0;
+  while(nextCalDay(it, &group->last)){
+    if(group->nbDays++==0){
+      group->first=group->last;
     }
-    
-    //Left Column: Add a space AFTER writing the week header
-    if(checkLeft){
-      printf(" ");
+    if(it->done
+       || (unit=='m' && next->month!=group->last.month)
+       || (unit=='w' && (next->weekday==it->opts[OPT_IDX_FIRSTWD]-'0' 
+                         || next->weekNumber!=group->last.weekNumber))){
+      break;
     }
   }
+  return (group->nbDays>0);
 }
 
-//print the week number
-//if day=0 : escape the field (=same week than before)
-static void printWeekNumber(int day, int month, int year, char* opts){
-  if(day>0){
-    //Get the week number
-    int weekNumber=getWeekNumber(day, month, year, opts);
-    
-    //Print the week number ("W01", "W02"...)
-    printf("W");
-    printDayNumber(weekNumber, strlen(headerStr[OPT_IDX_WKN])-1, '0');
-  }else{
-    //space the week number
-    printf("   ");
+//Print the days (or weeks, months) from..to (day numbers), with the iterator
+//days : "YYYY-MM-DD,Weekday,Wnn,dayOfYear,daysLeft,leap"
+//weeks/months : "YYYY-MM-DD,YYYY-MM-DD,days,Wnn|Month" (1st and last days)
+static void printIterations(char unit, long long from, long long to, char* opts){
+  CalIterator it;
+  DayRecord record;
+  GroupRecord group;
+  int dayFrom, monthFrom, yearFrom, dayTo, monthTo, yearTo;
+  
+  getDateOfDayNumber(from, &dayFrom, &monthFrom, &yearFrom, opts);
+  getDateOfDayNumber(to, &dayTo, &monthTo, &yearTo, opts);
+  if(initCalIterator(&it, dayFrom, monthFrom, yearFrom, dayTo, monthTo, yearTo, opts)!=0){
+    return;
+  }
+  
+  if(unit=='d'){
+    while(nextCalDay(&it, &record)){
+      outPrintf("%04d-%02d-%02d,%s,W%02d,%d,%d,%d%s", record.year, record.month+1, 
+                record.day, weekdays[record.weekday], record.weekNumber, 
+                record.dayOfYear, record.daysLeft, record.leap, endLine);
+    }
+    return;
+  }
+  while(nextCalGroup(&it, unit, &group)){
+    outPrintf("%04d-%02d-%02d,%04d-%02d-%02d,%d,", group.first.year, group.first.month+1,
+              group.first.day, group.last.year, group.last.month+1, group.last.day, 
+              group.nbDays);
+    if(unit=='w'){
+      outPrintf("W%02d%s", group.first.weekNumber, endLine);
+    }else{
+      outPrintf("%s%s", months[group.first.month], endLine);
+    }
   }
 }
 
-//print the number of days left
-//if day=0 : escape the field
-static void printDaysLeft(int day, int month, int year, char* opts){    
-  if(day>0){
-    //Calculate the days passed
-    int daysInYear=getDaysInfYear(year, opts);
-    int daysPassed=getDayOfYear(day, month, year, opts);
-    int daysLeft=daysInYear-daysPassed;
+//A cell of a month grid : a day of the month, or of the previous/next month
+typedef struct {
+  signed char day;        //day number, in its own month
+  signed char month;      //month of the day
+  signed char yearShift;  //year of the day : -1 previous, 0 current, 1 next
+  signed char inMonth;    //1 : day of the month of the grid, 0 : not
+  signed char weekNumber; //week number of the row (0 : row after the month)
+} GridCell;
+
+//Maximum number of weeks (= rows) in a month grid
+#define GRID_WEEKS 6
+
+//Layout of all the months of a year, computed once before the rendering
+typedef struct {
+  int year;
+  char firstWD;   //options used for the layout
+  char lyc;
+  WeekRule rule;  //week rule of the week numbers
+  int firstWDMonth[12];
+  int daysInMonth[12];
+  int offset[12];   //days of the previous month in the 1st week
+  int nbWeeks[12];
+  GridCell cells[12][GRID_WEEKS][7];
+} YearLayout;
+
+static YearLayout yearLayout;
+static int yearLayoutReady=0;
+
+//Return the layout of the year (computed only if the year/options changed)
+static YearLayout* getYearLayout(int year, char* opts){
+  int month, week, dayCount, day, firstDay, weekNumber;
+  int daysInMonth, daysInPreviousMonth;
+  GridCell* cell;
+  YearLayout* layout=&yearLayout;
+  
+  if(yearLayoutReady && layout->year==year && layout->firstWD==opts[OPT_IDX_FIRSTWD]
+     && layout->lyc==opts[OPT_IDX_LYC] && isWeekRule(&layout->rule)){
+    return layout;
+  }
+  
+  layout->year=year;
+  layout->firstWD=opts[OPT_IDX_FIRSTWD];
+  layout->lyc=opts[OPT_IDX_LYC];
+  layout->rule=weekRule;
+  
+  for(month=JANUARY; month<=DECEMBER; month++){
+    daysInMonth=getDaysPerMonth(month, year, opts);
+    daysInPreviousMonth=getDaysPerMonth(changeMonth(month, -1), year, opts);
+    layout->firstWDMonth[month]=getFirstWDMonth(month, year, opts);
+    layout->daysInMonth[month]=daysInMonth;
+    layout->offset[month]=getOffsetMonth(-1, month, year, opts);
+    layout->nbWeeks[month]=getNumberWeeksMonth(month, year, opts);
     
-    //Print the days left
-    printDayNumber(daysLeft, strlen(headerStr[OPT_IDX_LEFT]), ' ');
-  }else{
-    //space the days left
-    printf("   ");
+    for(week=0; week<GRID_WEEKS; week++){
+      firstDay=1+(7*week)-layout->offset[month];
+      
+      //Same week number for all the row (the one of its 1st day in the month)
+      if(week<layout->nbWeeks[month]){
+        weekNumber=getWeekNumber((firstDay<1) ? 1 : firstDay, month, year, opts);
+      }else{
+        weekNumber=0;
+      }
+      
+      for(dayCount=0; dayCount<7; dayCount++){
+        cell=&layout->cells[month][week][dayCount];
+        day=firstDay+dayCount;
+        cell->weekNumber=weekNumber;
+        if(day<1){
+          //previous month
+          cell->day=day+daysInPreviousMonth;
+          cell->month=changeMonth(month, -1);
+          cell->yearShift=(month==JANUARY) ? -1 : 0;
+          cell->inMonth=0;
+        }else if(day>daysInMonth){
+          //next month
+          cell->day=day-daysInMonth;
+          cell->month=changeMonth(month, 1);
+          cell->yearShift=(month==DECEMBER) ? 1 : 0;
+          cell->inMonth=0;
+        }else{
+          cell->day=day;
+          cell->month=month;
+          cell->yearShift=0;
+          cell->inMonth=1;
+        }
+      }
+    }
   }
+  
+  yearLayoutReady=1;
+  return layout;
 }
 
-//Print the day of the year
-//if day=0 : escape the field
-static void printDayOfYear(int day, int month, int year, char* opts){
-  if(day>0){
-    //get the day of the year
-    int dayOfYear=getDayOfYear(day, month, year, opts);
-      
-    //Print the day
-    printDayNumber(dayOfYear, strlen(headerStr[OPT_IDX_DOY]), ' ');
-  }else{
-    //space the day of the year
-    printf("   ");
+//Return the 1st day of the month in a row of the grid
+static int getFirstDayRow(GridCell* row){
+  int dayCount;
+  for(dayCount=0; dayCount<6 && !row[dayCount].inMonth; dayCount++){
   }
+  return row[dayCount].day;
 }
 
-//Print the WeekDay (name)
-//if day=-1 : escape the field
-static void printWeekDay(int dayWeek, int numLetters){    
-  if(dayWeek>-1){
-    //Print the weekday
-    printWeekDayName(dayWeek, numLetters);
-  }else{
-    //Escape the numLetters
-    for(int c=0;c<numLetters;c++){
-      printf(" ");
-    }
+//Sunrise, sunset and day length (-loc) : the sunrise equation is computed
+//for a whole month at once, each step is a loop over plain arrays 
+//(no branch inside, the compiler can vectorize them)
+#define SUN_J2000          2451545.0  //Julian Day of 01/01/2000 (noon)
+#define SUN_ALTITUDE       -0.833     //Sun altitude at sunrise (refraction)
+#define SUN_OBLIQUITY      23.439     //Earth's tilt (J2000)
+#define SUN_MINUTES_DAY    1440.0
+#define SUN_COLUMNS_SIZE   18         //"  Rise   Set   Day"
+#define SUN_DEGREES        (3.14159265358979323846/180.0)
+
+//The location asked (-loc=<lat>,<lon>[,<UTC offset>])
+typedef struct {
+  int enabled;
+  double latitude;   //degrees, North>0
+  double longitude;  //degrees, East>0
+  double utcOffset;  //hours, times are printed in UTC+utcOffset
+} SunLocation;
+
+static SunLocation sunLocation={0, 0.0, 0.0, 0.0};
+
+//Times of the days of a month (in minutes from midnight)
+typedef struct {
+  int days;
+  double rise[31];
+  double set[31];
+  double length[31];
+  signed char polar[31]; //1 : Sun always up, -1 : always down, 0 : rise/set
+} SunMonth;
+
+static SunMonth sunMonths[12];
+
+//Compute the sunrise/sunset of all the days of the month
+//(low precision formulas of the Astronomical Almanac, ~1 minute)
+static void computeSunMonth(int month, int year, char* opts, SunMonth* sun){
+  double dayNumber[31], meanLongitude[31], anomaly[31], longitude[31];
+  double equation[31], sinDecl[31], hourAngle[31];
+  double sinLat=sin(sunLocation.latitude*SUN_DEGREES);
+  double cosLat=cos(sunLocation.latitude*SUN_DEGREES);
+  double sinAltitude=sin(SUN_ALTITUDE*SUN_DEGREES);
+  double firstDay;
+  double obliquity, ascension, cosDecl, cosAngle, noon;
+  int days=getDaysPerMonth(month, year, opts);
+  int i;
+  
+  //Days since J2000 at the local mean noon
+  firstDay=(double)getJulianDayNumber(1, month, year, opts)-SUN_J2000;
+  firstDay=firstDay-sunLocation.longitude/360.0;
+  for(i=0; i<days; i++){
+    dayNumber[i]=firstDay+i;
+  }
+  
+  //Mean longitude, mean anomaly and ecliptic longitude of the Sun (radians)
+  for(i=0; i<days; i++){
+    meanLongitude[i]=fmod(280.460+0.9856474*dayNumber[i], 360.0)*SUN_DEGREES;
+    anomaly[i]=fmod(357.528+0.9856003*dayNumber[i], 360.0)*SUN_DEGREES;
+  }
+  for(i=0; i<days; i++){
+    longitude[i]=meanLongitude[i]
+                 +(1.915*sin(anomaly[i])+0.020*sin(2*anomaly[i]))*SUN_DEGREES;
+  }
+  
+  //Right ascension : equation of time (radians, in -PI..PI) and declination
+  for(i=0; i<days; i++){
+    obliquity=(SUN_OBLIQUITY-0.0000004*dayNumber[i])*SUN_DEGREES;
+    ascension=atan2(cos(obliquity)*sin(longitude[i]), cos(longitude[i]));
+    equation[i]=remainder(meanLongitude[i]-ascension, 2*180.0*SUN_DEGREES);
+    sinDecl[i]=sin(obliquity)*sin(longitude[i]);
+  }
+  
+  //Hour angle, in days (clamped for the polar days/nights)
+  for(i=0; i<days; i++){
+    cosDecl=sqrt(1.0-sinDecl[i]*sinDecl[i]);
+    cosAngle=(sinAltitude-sinLat*sinDecl[i])/(cosLat*cosDecl);
+    sun->polar[i]=(signed char)((cosAngle<-1.0)-(cosAngle>1.0));
+    hourAngle[i]=acos(fmax(-1.0, fmin(1.0, cosAngle)))/(2*180.0*SUN_DEGREES);
+  }
+  
+  //Times (minutes) : local solar noon, corrected by the equation of time
+  for(i=0; i<days; i++){
+    noon=0.5-sunLocation.longitude/360.0-equation[i]/(2*180.0*SUN_DEGREES);
+    noon=noon*SUN_MINUTES_DAY+sunLocation.utcOffset*60.0;
+    sun->rise[i]=noon-hourAngle[i]*SUN_MINUTES_DAY;
+    sun->set[i]=noon+hourAngle[i]*SUN_MINUTES_DAY;
+    sun->length[i]=2*hourAngle[i]*SUN_MINUTES_DAY;
   }
+  
+  sun->days=days;
 }
 
-//print headers, depending of opts
-//cPos=-1 : a left column, cPos=1 : a right column
-static void printHeaders(int cPos, char* opts){
-  int i;
-  if(cPos<0){
-    //print the headers
-    for(i=0; i<OPTS_IDX_PRINTED; i++){
-      printHeader(i, cPos, opts);
-    }
-  }else{
-    //print the header (inverted)
-    for(i=OPTS_IDX_PRINTED-1; i>-1; i--){
-      printHeader(i, cPos, opts);
+//Print a time "HH:MM" (modulo 1 day if wrap), "--:--" if no time
+static void printSunTime(double minutes, int valid, int wrap){
+  int time=(int)floor(minutes+0.5);
+  if(!valid){
+    outPrintf("--:--");
+    return;
+  }
+  if(wrap){
+    time=((time%1440)+1440)%1440;
+  }
+  outPrintf("%02d:%02d", time/60, time%60);
+}
+
+//Print the sunrise, sunset and day length of the day (escaped if day=0)
+static void printSunInfos(SunMonth* sun, int day){
+  if(day<1 || day>sun->days){
+    outPrintf("%*s", SUN_COLUMNS_SIZE, "");
+    return;
+  }
+  outPrintf(" ");
+  printSunTime(sun->rise[day-1], sun->polar[day-1]==0, 1);
+  outPrintf(" ");
+  printSunTime(sun->set[day-1], sun->polar[day-1]==0, 1);
+  outPrintf(" ");
+  printSunTime(sun->length[day-1], 1, 0);
+}
+
+//Recurrence rules (RFC 5545 RRULE) : "FREQ=MONTHLY;BYDAY=2TU", the 
+//occurrences are produced one by one (lazy), each period (day, week, month
+//or year) gives directly its candidate days, no day is tested one by one
+#define RRULE_DAILY        'd'
+#define RRULE_WEEKLY       'w'
+#define RRULE_MONTHLY      'm'
+#define RRULE_YEARLY       'y'
+#define RRULE_MAX_BYDAY    14
+#define RRULE_MAX_SETPOS   8
+#define RRULE_CANDIDATES   384    //days of a period (a year at most)
+#define RRULE_EMPTY_PERIODS 1000  //end of the rule if no more occurrences
+#define RRULE_MAX_YEAR     999999
+
+//A rule (only plain values : can be stored in the events index)
+typedef struct {
+  char freq;
+  int interval;
+  long long count;                      //0 : no limit
+  long long until;                      //last day number
+  long long start;                      //DTSTART day number
+  int startDay, startMonth, startYear, startWeekday;
+  int weekStart;                        //WKST
+  int nbByDay;
+  signed char byDayWeekday[RRULE_MAX_BYDAY];
+  signed char byDayOrdinal[RRULE_MAX_BYDAY]; //0 : every weekday
+  unsigned int byMonthDay;              //bits 1-31
+  unsigned int byMonthDayLast;          //bits 1-31 : -1 to -31
+  unsigned int byMonth;                 //bits 0-11 (0 : all months)
+  int nbBySetPos;
+  short bySetPos[RRULE_MAX_SETPOS];
+} RRule;
+
+//Iterator on the occurrences of a rule
+typedef struct {
+  const RRule* rule;
+  long long period;       //index of the current period (from DTSTART)
+  long long emitted;      //occurrences counted (for COUNT)
+  long long from;         //1st day number returned
+  int nbCandidates;
+  int next;
+  int done;
+  long long candidates[RRULE_CANDIDATES];
+} RRuleIterator;
+
+static const char* rruleWeekdays[7]={"SU", "MO", "TU", "WE", "TH", "FR", "SA"};
+
+//Read a weekday ("MO"...), return -1 if not a weekday
+static int parseRRuleWeekday(const char* str){
+  for(int weekday=SUNDAY; weekday<=SATURDAY; weekday++){
+    if(strncmp(str, rruleWeekdays[weekday], 2)==0){
+      return weekday;
     }
   }
+  return -1;
 }
 
-//print info
-//cPos=-1 : a left column, cPos=1 : a right column
-static int printInfo(int day, int month, int year, int cPos, 
-                      int optsIdx, char* opts, int numLetters){
-  int printed=0;
-  int checkLeft=(cPos<0);
-  int checkRight=(cPos>0);
-  int weekday;
-  if(cPos==-1){
-    checkLeft=(opts[optsIdx]==OPT_LEFT || opts[optsIdx]==OPT_BOTH);
+//Read a date "YYYYMMDD" as a day number, return -1 if not valid
+static long long parseRRuleDate(const char* str, char* opts){
+  long value;
+  int day, month, year;
+  char* end;
+  
+  value=strtol(str, &end, 10);
+  if(end-str<8 || value<101 || (*end!='\0' && *end!=';' && *end!='T')){
+    return -1;
   }
-  if(cPos==1){
-    checkRight=(opts[optsIdx]==OPT_RIGHT || opts[optsIdx]==OPT_BOTH);
+  day=value%100;
+  month=(value/100)%100;
+  year=(int)(value/10000);
+  if(year<1 || year>RRULE_MAX_YEAR || month<1 || month>12
+     || day<1 || day>getDaysPerMonth(month-1, year, opts)){
+    return -1;
+  }
+  return getJulianDayNumber(day, month-1, year, opts);
+}
+
+//Parse a rule, "DTSTART=YYYYMMDD;" is accepted in the rule
+//(defaultStart : day number used without DTSTART)
+//Return 0 if valid
+static int parseRRule(const char* str, long long defaultStart, RRule* rule, char* opts){
+  char part[256];
+  char* value;
+  char* item;
+  char* end;
+  const char* next;
+  long number;
+  int weekday;
+  size_t length;
+  
+  memset(rule, 0, sizeof(RRule));
+  rule->interval=1;
+  rule->until=1LL<<62;
+  rule->start=defaultStart;
+  rule->weekStart=MONDAY;
+  if(strncmp(str, "RRULE:", 6)==0){
+    str=str+6;
   }
   
-  if(cPos!=-1 || cPos!=1 || opts[optsIdx]!=OPT_NONE){
-    //Right Column : add a space BEFORE writing the info
-    if(checkRight){
-      printf(" ");
-      printed++;
+  while(*str!='\0' && *str!=' ' && *str!='\t' && *str!='\n' && *str!='\r'){
+    //Copy a part "NAME=value"
+    for(length=0; str[length]!='\0' && str[length]!=';' && str[length]!=' '
+                  && str[length]!='\t' && str[length]!='\n' && str[length]!='\r'; length++){
     }
-
-    if(opts[optsIdx]!=OPT_NONE && (cPos==0 || checkLeft || checkRight)){
-      if(optsIdx==OPT_IDX_WKN){
-        printWeekNumber(day, month, year, opts);
-        printed=printed+3;
-      }else if(optsIdx==OPT_IDX_LEFT){
-        printDaysLeft(day, month, year, opts);
-        printed=printed+3;
-      }else if(optsIdx==OPT_IDX_DOY){
-        printDayOfYear(day, month, year, opts);
-        printed=printed+3;
-      }else if(optsIdx==OPT_IDX_WD){
-        weekday=getWeekDay(day, month, year, opts);
-        printWeekDay(weekday, numLetters);
-        printed=printed+numLetters;
-      }else if(optsIdx==OPT_IDX_LYD){
-        printf("%d", isLeapYear(year, opts));
-        printed++; //Only 0 or 1
-      }
+    if(length>=sizeof(part)){
+      return -1;
     }
+    memcpy(part, str, length);
+    part[length]='\0';
+    next=str+length+(str[length]==';');
+    str=next;
     
-    //Left Column: Add a space AFTER writing the info
-    if(checkLeft){
-      printf(" ");
-      printed++;
+    value=strchr(part, '=');
+    if(value==NULL){
+      return -1;
+    }
+    *value++='\0';
+    
+    if(strcmp(part, "FREQ")==0){
+      if(strcmp(value, "DAILY")==0){
+        rule->freq=RRULE_DAILY;
+      }else if(strcmp(value, "WEEKLY")==0){
+        rule->freq=RRULE_WEEKLY;
+      }else if(strcmp(value, "MONTHLY")==0){
+        rule->freq=RRULE_MONTHLY;
+      }else if(strcmp(value, "YEARLY")==0){
+        rule->freq=RRULE_YEARLY;
+      }else{
+        return -1;
+      }
+    }else if(strcmp(part, "DTSTART")==0){
+      rule->start=parseRRuleDate(value, opts);
+      if(rule->start<0){
+        return -1;
+      }
+    }else if(strcmp(part, "UNTIL")==0){
+      rule->until=parseRRuleDate(value, opts);
+      if(rule->until<0){
+        return -1;
+      }
+    }else if(strcmp(part, "INTERVAL")==0 || strcmp(part, "COUNT")==0){
+      number=strtol(value, &end, 10);
+      if(end==value || *end!='\0' || number<1 || number>1000000){
+        return -1;
+      }
+      if(part[0]=='I'){
+        rule->interval=(int)number;
+      }else{
+        rule->count=number;
+      }
+    }else if(strcmp(part, "WKST")==0){
+      rule->weekStart=parseRRuleWeekday(value);
+      if(rule->weekStart<0 || value[2]!='\0'){
+        return -1;
+      }
+    }else{
+      //Lists of values
+      for(item=strtok(value, ","); item!=NULL; item=strtok(NULL, ",")){
+        number=strtol(item, &end, 10);
+        if(strcmp(part, "BYDAY")==0){
+          weekday=parseRRuleWeekday(end);
+          if(weekday<0 || end[2]!='\0' || number<-53 || number>53
+             || (end!=item && number==0) || rule->nbByDay>=RRULE_MAX_BYDAY){
+            return -1;
+          }
+          rule->byDayWeekday[rule->nbByDay]=(signed char)weekday;
+          rule->byDayOrdinal[rule->nbByDay++]=(signed char)number;
+        }else if(end==item || *end!='\0'){
+          return -1;
+        }else if(strcmp(part, "BYMONTHDAY")==0 && number>=1 && number<=31){
+          rule->byMonthDay|=1u<<number;
+        }else if(strcmp(part, "BYMONTHDAY")==0 && number<=-1 && number>=-31){
+          rule->byMonthDayLast|=1u<<(-number);
+        }else if(strcmp(part, "BYMONTH")==0 && number>=1 && number<=12){
+          rule->byMonth|=1u<<(number-1);
+        }else if(strcmp(part, "BYSETPOS")==0 && number!=0 && number>=-366 
+                 && number<=366 && rule->nbBySetPos<RRULE_MAX_SETPOS){
+          rule->bySetPos[rule->nbBySetPos++]=(short)number;
+        }else{
+          return -1;
+        }
+      }
     }
   }
   
-  return printed;
+  if(rule->freq==0 || rule->start<0){
+    return -1;
+  }
+  getDateOfDayNumber(rule->start, &rule->startDay, &rule->startMonth, 
+                     &rule->startYear, opts);
+  rule->startWeekday=getWeekDayOfDayNumber(rule->start);
+  return 0;
 }
 
-//print information, depending of opts
-static void printInfos(int day, int month, int year, int cPos, char* opts){
-  for(int idx=0; idx<OPTS_IDX_PRINTED; idx++){
-    printInfo(day, month, year, cPos, idx, opts, 2);
+//Return the days (bits 1-31) of a month matching the BYDAY/BYMONTHDAY 
+//parts (ordinals of BYDAY : in the month)
+static unsigned int getRRuleMonthDays(const RRule* rule, int firstWDMonth, int daysInMonth){
+  unsigned int days=0, weekdays=0, monthDays;
+  unsigned int monthMask=(daysInMonth==31) ? 0xFFFFFFFEu : ((1u<<(daysInMonth+1))-2);
+  int idx, day, ordinal, lastWD;
+  
+  //BYDAY : the weekdays (every or n-th in the month)
+  for(idx=0; idx<rule->nbByDay; idx++){
+    ordinal=rule->byDayOrdinal[idx];
+    day=1+(rule->byDayWeekday[idx]-firstWDMonth+7)%7;
+    if(ordinal==0){
+      for(; day<=daysInMonth; day=day+7){
+        weekdays|=1u<<day;
+      }
+    }else{
+      if(ordinal<0){
+        lastWD=(firstWDMonth+daysInMonth-1)%7;
+        day=daysInMonth-(lastWD-rule->byDayWeekday[idx]+7)%7+7*(ordinal+1);
+      }else{
+        day=day+7*(ordinal-1);
+      }
+      if(day>=1 && day<=daysInMonth){
+        weekdays|=1u<<day;
+      }
+    }
   }
-  //print the Leap Year information
-  printInfo(day, month, year, cPos, OPT_IDX_LYD, opts, 2);
+  
+  //BYMONTHDAY (the negative days from the end of the month)
+  monthDays=rule->byMonthDay;
+  for(day=1; day<=daysInMonth; day++){
+    if(rule->byMonthDayLast&(1u<<day)){
+      monthDays|=1u<<(daysInMonth-day+1);
+    }
+  }
+  
+  if(rule->nbByDay>0 && (monthDays!=0)){
+    days=weekdays&monthDays;
+  }else if(rule->nbByDay>0){
+    days=weekdays;
+  }else if(monthDays!=0){
+    days=monthDays;
+  }else{
+    //Default : the day of DTSTART
+    days=1u<<rule->startDay;
+  }
+  return days&monthMask;
 }
 
-//
-static void printDayInfos(int day, int month, int year, int cPos, char* opts){
-  int escapeCol=0;
-  int printResult;
-  for(int idx=0; idx<OPTS_IDX_PRINTED; idx++){
-    printResult=printInfo(day, month, year, escapeCol, idx, opts, 0);
-    if(printResult>0){
-      //escape the next col (use checkRight)
-      escapeCol=1;
+//Add the days of a month (bits) to the candidates
+static void addRRuleMonthDays(RRuleIterator* iterator, unsigned int days, 
+                              long long firstDayNumber){
+  for(int day=1; day<=31; day++){
+    if((days&(1u<<day)) && iterator->nbCandidates<RRULE_CANDIDATES){
+      iterator->candidates[iterator->nbCandidates++]=firstDayNumber+day-1;
     }
   }
-  //print the Leap Year information
-  printInfo(day, month, year, escapeCol, OPT_IDX_LYD, opts, 0);
 }
 
-//print a Grid calendar
-//- use a full-week/line print technique, NEEDED for printing multiples cols
-//for 1 month print, the linear approach is better :
-//     (print all days, add an endline when last day of the week)
-static void printGCal(int monthStart, int monthEnd, int year, char* opts){
-
-  int day;      //1-31, the day of the month
-  int month;
-  int weekday;        //0-7 : sunday to saturday
-  int dayCount;     //increment to print all days
-  int daysInMonth, daysInPreviousMonth;
-  int firstWD=opts[OPT_IDX_FIRSTWD]-'0';
-  int offset;
-  int monthsToPrint=opts[OPT_IDX_NBCOL]-'A'; //nb of month to print
-  int printedMonth;
-  int lastMonthToPrint;
-  int rowSize;
-  int numberWeeksMonth, numberWeeksToPrint;
+//Set the candidates of the current period of the iterator
+static void expandRRulePeriod(RRuleIterator* iterator, char* opts){
+  const RRule* rule=iterator->rule;
+  long long period=iterator->period*rule->interval;
+  long long dayNumber, monthIndex, firstDay, lastDay;
+  int day, month, year, firstWDMonth, daysInMonth;
+  int idx, weekday, ordinal, position, nb;
+  long long selected[RRULE_MAX_SETPOS];
+  char yearDays[RRULE_CANDIDATES];
   
-  //Header : for multiples months, print the year in 1st line
-  if(monthsToPrint>1){
-    printf("%d:%s", year, endLine);
-    rowSize=(7*3-1)+getSizeHeader(opts)+2;
-  }else{
-    rowSize=0;
-  }
+  iterator->nbCandidates=0;
+  iterator->next=0;
   
-  //Print all months
-  for(month=monthStart; month<=monthEnd; month=month+monthsToPrint){
-    
-    //Check the last month to print
-    if(month+monthsToPrint>DECEMBER){
-      lastMonthToPrint=DECEMBER+1;
-    }else{
-      lastMonthToPrint=month+monthsToPrint;
+  if(rule->freq==RRULE_DAILY){
+    //A day : the parts only filter it
+    dayNumber=rule->start+period;
+    getDateOfDayNumber(dayNumber, &day, &month, &year, opts);
+    weekday=getWeekDayOfDayNumber(dayNumber);
+    if(rule->byMonth!=0 && !(rule->byMonth&(1u<<month))){
+      return;
     }
-    
-    //HEADER : if not compact view : print the full Month name
-    if(opts[OPT_IDX_COMPACT]!=OPT_YES){
-      //Do for each print month
-      for(printedMonth=month; printedMonth<lastMonthToPrint; printedMonth++){
-        printMonthName(printedMonth, rowSize);
+    if(rule->nbByDay>0 || rule->byMonthDay!=0 || rule->byMonthDayLast!=0){
+      daysInMonth=getDaysPerMonth(month, year, opts);
+      firstWDMonth=getWeekDayOfDayNumber(dayNumber-day+1);
+      if(!(getRRuleMonthDays(rule, firstWDMonth, daysInMonth)&(1u<<day))){
+        return;
       }
     }
-      
-    //HEADERS
-    if(month==monthStart || opts[OPT_IDX_COMPACT]!=OPT_YES){
-
-      if(monthsToPrint==1){
-        //print the year
-        printf(" %d:", year);
+    iterator->candidates[iterator->nbCandidates++]=dayNumber;
+    
+  }else if(rule->freq==RRULE_WEEKLY){
+    //The week of DTSTART (starting with WKST), then every INTERVAL weeks
+    firstDay=rule->start-(rule->startWeekday-rule->weekStart+7)%7+7*period;
+    for(idx=0; idx<7; idx++){
+      weekday=(rule->weekStart+idx)%7;
+      for(ordinal=0; ordinal<rule->nbByDay && rule->byDayWeekday[ordinal]!=weekday; ordinal++){
       }
-      
-      //Escape the line (months)
-      printf("%s", endLine);
-      
-      //Compact views : print a month column
-      if(opts[OPT_IDX_COMPACT]==OPT_YES){
-        printHeader(OPT_IDX_MONTH, -2, opts);
+      if((rule->nbByDay>0 && ordinal==rule->nbByDay) 
+         || (rule->nbByDay==0 && weekday!=rule->startWeekday)){
+        continue;
       }
-      
-      //Do for each print month
-      for(printedMonth=month; printedMonth<lastMonthToPrint; printedMonth++){
-        //print Left HEADER columns
-        printHeaders(-1, opts);
-
-        //HEADER : Day names
-        weekday=firstWD;
-        
-        for(dayCount=0; dayCount<7; dayCount++){
-          //print the day names (short : 2 characters)
-          printWeekDayName(weekday, 2);
-          //Add a space between days
-          if(dayCount<6){
-            printf(" ");
-          }
-          //Go to the next day and increment the number days
-          weekday=changeWeekDay(weekday, 1);
-        }
-        
-        //HEADER : right columns
-        printHeaders(1, opts);
-        
-        if(printedMonth<lastMonthToPrint-1){
-          //escape months
-          printf("  ");
+      dayNumber=firstDay+idx;
+      if(rule->byMonth!=0){
+        getDateOfDayNumber(dayNumber, &day, &month, &year, opts);
+        if(!(rule->byMonth&(1u<<month))){
+          continue;
         }
       }
-      
-      //HEADER : END 
-      printf("%s", endLine);
+      iterator->candidates[iterator->nbCandidates++]=dayNumber;
     }
     
-    //Found the number of weeks (= lines) to print
-    numberWeeksToPrint=0;
-    for(printedMonth=month; printedMonth<lastMonthToPrint; printedMonth++){
-      numberWeeksMonth=getNumberWeeksMonth(printedMonth, year, opts);
-      if(numberWeeksToPrint<numberWeeksMonth){
-        numberWeeksToPrint=numberWeeksMonth;
-      }
+  }else if(rule->freq==RRULE_MONTHLY){
+    monthIndex=(long long)rule->startYear*12+rule->startMonth+period;
+    year=(int)(monthIndex/12);
+    month=(int)(monthIndex%12);
+    if(year>RRULE_MAX_YEAR || (rule->byMonth!=0 && !(rule->byMonth&(1u<<month)))){
+      return;
     }
+    firstDay=getJulianDayNumber(1, month, year, opts);
+    daysInMonth=getDaysPerMonth(month, year, opts);
+    addRRuleMonthDays(iterator, getRRuleMonthDays(rule, getWeekDayOfDayNumber(firstDay), 
+                                                  daysInMonth), firstDay);
     
+  }else{
+    year=(int)(rule->startYear+period);
+    if(year>RRULE_MAX_YEAR){
+      return;
+    }
     
-    //Printing each weeks (=lines)
-    for(int weekInMonth=1; weekInMonth<=numberWeeksToPrint; weekInMonth++){
-    
-      //Do for each print month
-      for(printedMonth=month; printedMonth<lastMonthToPrint; printedMonth++){
-                
-        daysInMonth=getDaysPerMonth(printedMonth, year, opts);
-
-        //Found the offset days in the month
-        offset=getOffsetMonth(-1, printedMonth, year, opts);
-          
-        //Set the day
-        day=1+(7*(weekInMonth-1))-offset;
-        //If start with days from previous month, 
-        if(day<1){
-          if(opts[OPT_IDX_COMPACT]==OPT_YES 
-              && weekInMonth==1 && printedMonth!=monthStart){
-            //compact mode, the 1st days already printed previously, escape 
-            weekInMonth++;
-            day=1+(7*(weekInMonth-1))-offset;
-          }else{
-            //set it '1' for printing info (weeknumber...)
-            day=1;
+    ordinal=0;
+    for(idx=0; idx<rule->nbByDay; idx++){
+      ordinal=ordinal || (rule->byDayOrdinal[idx]!=0);
+    }
+    if(rule->byMonth==0 && ordinal){
+      //n-th weekdays of the year, and every weekday without ordinal
+      firstDay=getJulianDayNumber(1, JANUARY, year, opts);
+      lastDay=firstDay+getDaysInfYear(year, opts)-1;
+      memset(yearDays, 0, sizeof(yearDays));
+      for(idx=0; idx<rule->nbByDay; idx++){
+        weekday=rule->byDayWeekday[idx];
+        if(rule->byDayOrdinal[idx]==0){
+          for(dayNumber=firstDay+(weekday-getWeekDayOfDayNumber(firstDay)+7)%7; 
+              dayNumber<=lastDay; dayNumber=dayNumber+7){
+            yearDays[dayNumber-firstDay]=1;
           }
+          continue;
         }
-        
-        if(opts[OPT_IDX_COMPACT]==OPT_YES){
-          if(day<=1){
-            //Print month name
-            printMonthName(printedMonth, 3);
-          }else if(weekInMonth<=numberWeeksMonth && day>(daysInMonth-6)){
-            //Print the NEXT month name (compact)
-            printMonthName(changeMonth(printedMonth, 1), 3);
-          }else{
-            //Escape the month (same)
-            printf("   ");
-          }
-          printf(" ");
+        if(rule->byDayOrdinal[idx]>0){
+          dayNumber=firstDay+(weekday-getWeekDayOfDayNumber(firstDay)+7)%7
+                    +7*(rule->byDayOrdinal[idx]-1);
+        }else{
+          dayNumber=lastDay-(getWeekDayOfDayNumber(lastDay)-weekday+7)%7
+                    +7*(rule->byDayOrdinal[idx]+1);
         }
-        
-        //Set empty day, if week printed exceed number of week month
-        numberWeeksMonth=getNumberWeeksMonth(printedMonth, year, opts);
-        if(weekInMonth>numberWeeksMonth){
-          day=-1;
+        if(dayNumber>=firstDay && dayNumber<=lastDay){
+          yearDays[dayNumber-firstDay]=1;
         }
-        
-        //print the left columns
-        printInfos(day, printedMonth, year, -1, opts);
-
-        //Print the 7 days
-        for(dayCount=0; dayCount<7; dayCount++){
-         
-          //Set the day
-          day=1+(7*(weekInMonth-1))+dayCount-offset;
-          
-          if(day>0 && day<=daysInMonth){
-            //Print the day
-            printDayNumber(day, 2, ' ');
-          }else{
-            if(numberWeeksMonth<=numberWeeksToPrint && opts[OPT_IDX_COMPACT]==OPT_YES){
-              if(day<1){
-                //get the number days of previous month
-                daysInPreviousMonth=getDaysPerMonth(changeMonth(printedMonth, -1), year, opts);
-                day=1+daysInPreviousMonth+dayCount-offset;
-              }else{
-                //(day>daysInMonth)
-                day=day-daysInMonth;
-              }
-              //Print the day number
-              printDayNumber(day, 2, ' ');
-            }else{
-              //Escape the day number
-              printf("  ");
-            }
-          }
-           
-          //Add a space between day numbers
-          if(dayCount<6){
-            printf(" ");
+      }
+      
+      //In the order of the days, BYMONTHDAY filters them
+      for(dayNumber=firstDay; dayNumber<=lastDay; dayNumber++){
+        if(!yearDays[dayNumber-firstDay]){
+          continue;
+        }
+        if(rule->byMonthDay!=0 || rule->byMonthDayLast!=0){
+          getDateOfDayNumber(dayNumber, &day, &month, &year, opts);
+          daysInMonth=getDaysPerMonth(month, year, opts);
+          if(!(rule->byMonthDay&(1u<<day)) 
+             && !(rule->byMonthDayLast&(1u<<(daysInMonth-day+1)))){
+            continue;
           }
         }
-        
-        //Print right columns
-        printInfos(day, printedMonth, year, 1, opts);
-        
-        if(printedMonth==lastMonthToPrint-1){
-          //End of the line
-          printf("%s", endLine);
-        }else{
-          //Escape months
-          printf("  ");
+        iterator->candidates[iterator->nbCandidates++]=dayNumber;
+      }
+    }else{
+      //The months of BYMONTH (or the month of DTSTART, or all months 
+      //with BYDAY/BYMONTHDAY)
+      for(month=JANUARY; month<=DECEMBER; month++){
+        if(rule->byMonth!=0){
+          if(!(rule->byMonth&(1u<<month))){
+            continue;
+          }
+        }else if(rule->nbByDay==0 && rule->byMonthDay==0 && rule->byMonthDayLast==0
+                 && month!=rule->startMonth){
+          continue;
         }
+        firstDay=getJulianDayNumber(1, month, year, opts);
+        daysInMonth=getDaysPerMonth(month, year, opts);
+        addRRuleMonthDays(iterator, getRRuleMonthDays(rule, getWeekDayOfDayNumber(firstDay), 
+                                                      daysInMonth), firstDay);
       }
     }
-    
-    if(lastMonthToPrint<=DECEMBER && opts[OPT_IDX_COMPACT]!=OPT_YES){
-      //Print a line separator between group of months
-      printf("%s", endLine);
+  }
+  
+  //BYSETPOS : positions in the days of the period
+  if(rule->nbBySetPos>0){
+    nb=0;
+    for(idx=0; idx<rule->nbBySetPos; idx++){
+      position=rule->bySetPos[idx];
+      position=(position>0) ? position-1 : iterator->nbCandidates+position;
+      if(position>=0 && position<iterator->nbCandidates){
+        selected[nb++]=iterator->candidates[position];
+      }
+    }
+    //Sorted, without duplicates
+    for(idx=1; idx<nb; idx++){
+      for(position=idx; position>0 && selected[position-1]>selected[position]; position--){
+        dayNumber=selected[position];
+        selected[position]=selected[position-1];
+        selected[position-1]=dayNumber;
+      }
+    }
+    iterator->nbCandidates=0;
+    for(idx=0; idx<nb; idx++){
+      if(idx==0 || selected[idx]!=selected[idx-1]){
+        iterator->candidates[iterator->nbCandidates++]=selected[idx];
+      }
     }
   }
 }
 
-//print a Linear calendar (=purely Horizontal)
-static void printHCal(int monthStart, int monthEnd, int year, char* opts){
-
-  int day;      //1-31, the day of the month
-  int month, lastMonthToPrint;
-  int weekday;        //0-7 : sunday to saturday
-  int dayCount;   //increment to print all days
-  int dayMaxToPrint, dayMaxMonth, dayPosition;
-  int firstWDMonth;   //get 1st day 
-  int daysInMonth;
-  int firstWD=opts[OPT_IDX_FIRSTWD]-'0';
-  int monthsToPrint=opts[OPT_IDX_NBCOL]-'A'; //nb of month to print
-  int offset;
+//Start the iterator on the occurrences from a day number
+static void initRRuleIterator(RRuleIterator* iterator, const RRule* rule, 
+                              long long from, char* opts){
+  long long firstDay;
+  int day, month, year;
   
-  //Check the last month to print
-  if(monthStart+monthsToPrint>DECEMBER){
-    lastMonthToPrint=DECEMBER+1;
-  }else{
-    lastMonthToPrint=monthStart+monthsToPrint;
-  }
+  iterator->rule=rule;
+  iterator->period=0;
+  iterator->emitted=0;
+  iterator->from=from;
+  iterator->done=0;
   
-  //Calculate the number of days to print 
-  dayMaxToPrint=0;
-  //Print all the months
-  for(month=monthStart; month<lastMonthToPrint; month++){
-    //Calculate the offset of the first Week
-    offset=getOffsetMonth(1, month, year, opts);
+  //Without COUNT : jump directly to the period of the 1st day
+  if(rule->count==0 && from>rule->start){
+    if(rule->freq==RRULE_DAILY){
+      iterator->period=(from-rule->start)/rule->interval;
+    }else if(rule->freq==RRULE_WEEKLY){
+      firstDay=rule->start-(rule->startWeekday-rule->weekStart+7)%7;
+      iterator->period=(from-firstDay)/(7LL*rule->interval);
+    }else{
+      getDateOfDayNumber(from, &day, &month, &year, opts);
+      if(rule->freq==RRULE_MONTHLY){
+        iterator->period=((long long)(year-rule->startYear)*12+month-rule->startMonth)/rule->interval;
+      }else{
+        iterator->period=(long long)(year-rule->startYear)/rule->interval;
+      }
+    }
+  }
+  expandRRulePeriod(iterator, opts);
+}
 
-    //Calculate the maximum of days to print
-    dayMaxMonth=0;
-    //If not a full week for the 1st week, add 1 week
-    if(offset>0){
-      dayMaxMonth=7;
+//Return the next occurrence (day number), -1 if no more occurrences
+static long long nextRRule(RRuleIterator* iterator, char* opts){
+  const RRule* rule=iterator->rule;
+  long long dayNumber;
+  int emptyPeriods=0;
+  
+  while(!iterator->done){
+    if(iterator->next>=iterator->nbCandidates){
+      //Next period
+      emptyPeriods=(iterator->nbCandidates==0) ? emptyPeriods+1 : 0;
+      if(emptyPeriods>RRULE_EMPTY_PERIODS){
+        iterator->done=1;
+        break;
+      }
+      iterator->period++;
+      expandRRulePeriod(iterator, opts);
+      continue;
     }
-    //Remove the offset
-    dayMaxMonth=dayMaxMonth+getDaysPerMonth(month, year, opts)-offset;
     
-    if(dayMaxToPrint<dayMaxMonth){
-      dayMaxToPrint=dayMaxMonth;
+    dayNumber=iterator->candidates[iterator->next++];
+    if(dayNumber<rule->start){
+      continue;
+    }
+    if(dayNumber>rule->until || (rule->count>0 && iterator->emitted>=rule->count)){
+      iterator->done=1;
+      break;
+    }
+    iterator->emitted++;
+    if(dayNumber>=iterator->from){
+      return dayNumber;
     }
   }
-  
-  //Print all the months
-  for(month=monthStart; month<lastMonthToPrint; month++){
-
-    //set values
-    day=1;
-    daysInMonth=getDaysPerMonth(month, year, opts);
-    firstWDMonth=getFirstWDMonth(month, year, opts);
+  return -1;
+}
 
-    //HEADER : if not compact view : print the Month name
-    if(opts[OPT_IDX_COMPACT]!=OPT_YES){
-      printMonthName(month, 0);
-      printf(" ");
+//Check the occurrences of some rules (from the 1st January 2024)
+//Return the number of failures
+static int checkRRules(char* opts){
+  static const struct {
+    const char* rule;
+    int dates[6];           //YYYYMMDD, then 0
+  } rules[]={
+    {"FREQ=YEARLY;BYDAY=1MO,FR;COUNT=5", {20240101, 20240105, 20240112, 20240119, 20240126}},
+    {"FREQ=YEARLY;BYDAY=20MO;BYMONTHDAY=13;COUNT=3", {20240513, 20520513, 20800513}},
+    {"FREQ=YEARLY;BYDAY=-1SU,1SU;COUNT=4", {20240107, 20241229, 20250105, 20251228}}
+  };
+  static RRuleIterator iterator;
+  RRule rule;
+  long long start=getJulianDayNumber(1, JANUARY, 2024, opts), dayNumber, expected;
+  int idx, date, failures=0;
+  
+  for(idx=0; idx<(int)(sizeof(rules)/sizeof(rules[0])); idx++){
+    if(parseRRule(rules[idx].rule, start, &rule, opts)!=0){
+      fprintf(stderr, "check: rrule %s : invalid%s", rules[idx].rule, endLine);
+      failures++;
+      continue;
     }
-      
-    //HEADERS
-    if(month==monthStart || opts[OPT_IDX_COMPACT]!=OPT_YES){
-
-      //print the year
-      printf("%d:%s", year, endLine);
-      
-      //Compact views : print a month column
-      if(opts[OPT_IDX_COMPACT]==OPT_YES){
-        printHeader(OPT_IDX_MONTH, -2, opts);
-      }
-      
-      //print Left HEADER columns
-      printHeaders(-1, opts);
-
-      //HEADER : print weekDay names
-      if(opts[OPT_IDX_FIXED]==OPT_YES){
-        //Restart with the 1st day of week
-        weekday=firstWD;
-      }else{
-        //print only the days in the month
-        dayMaxToPrint=daysInMonth;
-        //start with the 1st WD of the month
-        weekday=firstWDMonth;
+    initRRuleIterator(&iterator, &rule, start, opts);
+    for(date=0; date<6; date++){
+      dayNumber=nextRRule(&iterator, opts);
+      expected=(rules[idx].dates[date]==0) ? -1 
+               : getJulianDayNumber(rules[idx].dates[date]%100, 
+                                    rules[idx].dates[date]/100%100-1,
+                                    rules[idx].dates[date]/10000, opts);
+      if(dayNumber!=expected){
+        fprintf(stderr, "check: rrule %s : occurrence %d%s", rules[idx].rule, date+1, 
+                endLine);
+        failures++;
+        break;
       }
-      
-      for(dayCount=0; dayCount<dayMaxToPrint; dayCount++){
-        //print the day names (short : 2 characters)
-        printWeekDayName(weekday, 2);
-        //Add a space between days
-        if(dayCount<dayMaxToPrint-1){
-          printf(" ");
-        }
-        //Go to the next day
-        weekday=changeWeekDay(weekday, 1);
+      if(expected<0){
+        break;
       }
-      
-      //HEADER : right columns
-      printHeaders(1, opts);
-      
-      //HEADER : END
-      printf("%s", endLine);
     }
-    
-    //reset dayPosition
-    dayPosition=0;
-    //Reset the weekday depending on Fixed mode
-    if(opts[OPT_IDX_FIXED]==OPT_YES){
-      weekday=firstWD;
-    }else{
-      weekday=firstWDMonth;
+  }
+  return failures;
+}
+
+//Easter (computus) and the moveable feasts, in the calendar of the year
+//(Gregorian or Julian, as isLeapYear) : the dates of Easter are computed
+//by century, stored as days after the 21 March (1-35)
+#define EASTER_CACHE_SIZE   4       //centuries kept
+#define EASTER_MARCH_DAY    21
+
+typedef struct {
+  int ready;
+  int century;
+  char lyc;
+  unsigned char days[100];  //days after the 21 March, by year of the century
+} EasterCentury;
+
+//A moveable feast : days from Easter
+typedef struct {
+  const char* name;
+  int offset;
+} Feast;
+
+static EasterCentury easterCenturies[EASTER_CACHE_SIZE];
+static int feastsEnabled=0;   //-feasts : feasts marked as events
+
+static const Feast feasts[]={
+  {"Septuagesima", -63}, {"Shrove Tuesday", -47}, {"Ash Wednesday", -46},
+  {"Palm Sunday", -7}, {"Maundy Thursday", -3}, {"Good Friday", -2},
+  {"Easter", 0}, {"Easter Monday", 1}, {"Ascension", 39}, 
+  {"Pentecost", 49}, {"Whit Monday", 50}, {"Trinity Sunday", 56},
+  {"Corpus Christi", 60}
+};
+#define FEASTS_NB ((int)(sizeof(feasts)/sizeof(feasts[0])))
+
+//Return the days of Easter after the 21 March, computed (the Gregorian
+//algorithm of the "New York correspondent", or the Julian one of Meeus)
+static int computeEasterDays(int year, int gregorian){
+  int golden=year%19;
+  int century, yearOfCentury, epact, weekday, correction;
+  
+  if(!gregorian){
+    epact=(19*golden+15)%30;
+    weekday=(2*(year%4)+4*(year%7)-epact+34)%7;
+    return epact+weekday+114-31*3-EASTER_MARCH_DAY+1;
+  }
+  century=year/100;
+  yearOfCentury=year%100;
+  epact=(19*golden+century-century/4-(century-(century+8)/25+1)/3+15)%30;
+  weekday=(32+2*(century%4)+2*(yearOfCentury/4)-epact-yearOfCentury%4)%7;
+  correction=(golden+11*epact+22*weekday)/451;
+  return epact+weekday-7*correction+114-31*3-EASTER_MARCH_DAY+1;
+}
+
+//Return the days of Easter after the 21 March (the century is computed
+//once, for the calendar option), 0 if the year is before 1
+static int getEasterDays(int year, char* opts){
+  EasterCentury* table;
+  int century, idx;
+  
+  if(year<1){
+    return 0;
+  }
+  century=year/100;
+  table=&easterCenturies[century%EASTER_CACHE_SIZE];
+  if(!table->ready || table->century!=century || table->lyc!=opts[OPT_IDX_LYC]){
+    for(idx=0; idx<100; idx++){
+      table->days[idx]=(unsigned char)computeEasterDays(century*100+idx, 
+                                          isGregorianYear(century*100+idx, opts));
     }
+    table->century=century;
+    table->lyc=opts[OPT_IDX_LYC];
+    table->ready=1;
+  }
+  return table->days[year%100];
+}
 
-    if(opts[OPT_IDX_COMPACT]==OPT_YES && dayPosition==0 && day==1){
-        //Print month name (compact, 1st day)
-        printMonthName(month, 3);
-        printf(" ");
+//Return the day number of Easter (-1 if the year is before 1)
+static long long getEasterDayNumber(int year, char* opts){
+  int days=getEasterDays(year, opts);
+  
+  if(days==0){
+    return -1;
+  }
+  return getJulianDayNumber(EASTER_MARCH_DAY, MARCH, year, opts)+days;
+}
+
+//Return the feast of a day (-1 if none)
+static int getDayFeast(int day, int month, int year, char* opts){
+  long long offset;
+  int idx;
+  
+  if(year<1){
+    return -1;
+  }
+  offset=getJulianDayNumber(day, month, year, opts)-getEasterDayNumber(year, opts);
+  for(idx=0; idx<FEASTS_NB && feasts[idx].offset<=offset; idx++){
+    if(feasts[idx].offset==offset){
+      return idx;
     }
-    
-    //print the left columns
-    printInfos(day, month, year, -1, opts);
+  }
+  return -1;
+}
 
-    //Escape the 1st missing days before the 1st day printed
-    while(firstWDMonth!=weekday){
-      //add spaces
-      printf("   ");
-      
-      dayPosition++;
-      weekday=changeWeekDay(weekday, 1);
+//Print the moveable feasts of the years : "YYYY-MM-DD,Weekday,Feast"
+static void printFeasts(int yearFrom, int yearTo, char* opts){
+  long long easter;
+  int year, idx, day, month, dateYear;
+  
+  for(year=(yearFrom<1) ? 1 : yearFrom; year<=yearTo; year++){
+    easter=getEasterDayNumber(year, opts);
+    for(idx=0; idx<FEASTS_NB; idx++){
+      getDateOfDayNumber(easter+feasts[idx].offset, &day, &month, &dateYear, opts);
+      outPrintf("%04d-%02d-%02d,%s,%s%s", dateYear, month+1, day, 
+                weekdays[getWeekDayOfDayNumber(easter+feasts[idx].offset)],
+                feasts[idx].name, endLine);
     }
+  }
+}
 
-    //Main loop : print days
-    while(day<=daysInMonth){
+//Fiscal calendars (-fiscal=<445|454|544>/<month>/<weekday>[/last]) : the
+//fiscal year ends on the weekday nearest the end of the month (or the last
+//one in the month), so it has 52 or 53 weeks; the weeks are grouped by 
+//quarters of 13 weeks (4-4-5, 4-5-4 or 5-4-4), the 53rd week is added to
+//the last period. The fiscal year is named by the year of its end.
+#define FISCAL_RULES_MAX  8
+#define FISCAL_PERIODS    12
+#define FISCAL_NAME_SIZE  32
 
-      //Print the day
-      printDayNumber(day, 2, ' ');
-      
-      //increment values
-      day++;
-      dayPosition++;
-      weekday=changeWeekDay(weekday, 1);
-      
-      //add a space between days printed
-      if(dayPosition<dayMaxToPrint){
-        printf(" ");
-      }
-    }
-      
-    //Add spaces after the last day printed, to finish the line
-    while(dayPosition<dayMaxToPrint){
-      printf("  "); //an empty day number
-      dayPosition++;
-      weekday=changeWeekDay(weekday, 1);
+typedef struct {
+  char name[FISCAL_NAME_SIZE];    //the rule, as given
+  int weeks[FISCAL_PERIODS];      //weeks of the periods (52-week year)
+  int month;                      //month of the end
+  int weekday;                    //weekday of the end
+  int nearest;                    //1 : nearest the end of the month
+} FiscalRule;
 
-      if(dayPosition<dayMaxToPrint){
-        //add a space between day numbers
-        printf(" ");
+//A fiscal year : its days and the start of its periods
+typedef struct {
+  int year;
+  long long start;
+  long long end;
+  int nbWeeks;
+  long long periodStart[FISCAL_PERIODS+1];
+} FiscalYear;
+
+static FiscalRule fiscalRules[FISCAL_RULES_MAX];
+static int nbFiscalRules=0;
+
+//Parse a fiscal rule, return 0 if valid
+static int parseFiscalRule(const char* str, FiscalRule* rule){
+  char buffer[FISCAL_NAME_SIZE];
+  char* item;
+  char* end;
+  int idx;
+  
+  snprintf(rule->name, sizeof(rule->name), "%s", str);
+  snprintf(buffer, sizeof(buffer), "%s", str);
+  
+  //Pattern : weeks of the 3 periods of a quarter
+  item=strtok(buffer, "/");
+  if(item==NULL || strlen(item)!=3 || (strcmp(item, "445")!=0 
+     && strcmp(item, "454")!=0 && strcmp(item, "544")!=0)){
+    return -1;
+  }
+  for(idx=0; idx<FISCAL_PERIODS; idx++){
+    rule->weeks[idx]=item[idx%3]-'0';
+  }
+  
+  //Month of the end : number or name
+  item=strtok(NULL, "/");
+  if(item==NULL){
+    return -1;
+  }
+  rule->month=(int)strtol(item, &end, 10)-1;
+  if(end==item){
+    for(rule->month=JANUARY; rule->month<=DECEMBER; rule->month++){
+      if(strncasecmp(item, months[rule->month], 3)==0){
+        break;
       }
     }
-      
-    //print the right columns
-    printInfos(daysInMonth, month, year, 1, opts);
-    
-    //End the line
-    printf("%s", endLine);
-    
-    if(opts[OPT_IDX_COMPACT]!=OPT_YES 
-        && monthStart!=lastMonthToPrint && month!=lastMonthToPrint){
-      //Print a line separator between months
-      printf("%s", endLine);
+  }else if(*end!='\0'){
+    return -1;
+  }
+  if(rule->month<JANUARY || rule->month>DECEMBER){
+    return -1;
+  }
+  
+  //Weekday of the end
+  item=strtok(NULL, "/");
+  if(item==NULL){
+    return -1;
+  }
+  for(rule->weekday=SUNDAY; rule->weekday<=SATURDAY; rule->weekday++){
+    if(strncasecmp(item, weekdays[rule->weekday], 3)==0){
+      break;
     }
   }
+  if(rule->weekday>SATURDAY){
+    return -1;
+  }
+  
+  //Nearest (default) or last weekday of the month
+  item=strtok(NULL, "/");
+  rule->nearest=(item==NULL);
+  if(item!=NULL && (strcmp(item, "last")!=0 || strtok(NULL, "/")!=NULL)){
+    return -1;
+  }
+  return 0;
 }
 
-//print a column (or vertical) calendar 
-static void printVCal(int monthStart, int monthEnd, int year, char* opts){
-  int month;
-  int day, dayPrinted;
-  int weekNumber;
-  int firstWD=opts[OPT_IDX_FIRSTWD]-'0';
-  int weekday, weekdayRow;
-  int offset;
-  int dayMaxToPrint,dayMaxMonth,  daysForPrintedMonth;
-  int monthsToPrint=opts[OPT_IDX_NBCOL]-'A'; //nb of month to print
-  int printedMonth;
-  int lastMonthToPrint;
-  int rowSize;  //for month printing
-  
-  //Check the WD columns in fixed mode.
-  int checkFixedOpt, tmpCheck;
-  checkFixedOpt=(opts[OPT_IDX_FIXED]==OPT_YES);
-  tmpCheck=(opts[OPT_IDX_WD]==(OPT_BOTH-'a'+'A'));
-  int checkBothFixedWD=(checkFixedOpt && tmpCheck);
-  tmpCheck=(checkFixedOpt && opts[OPT_IDX_WD]==(OPT_LEFT-'a'+'A'));
-  int checkFixedWDLeft=(checkBothFixedWD || tmpCheck);
-  tmpCheck=(checkFixedOpt && opts[OPT_IDX_WD]==(OPT_RIGHT-'a'+'A'));
-  int checkFixedWDRight=(checkBothFixedWD || tmpCheck);
+//Return the day number of the end of the fiscal year
+static long long getFiscalYearEnd(const FiscalRule* rule, int year, char* opts){
+  long long lastDay=getJulianDayNumber(getDaysPerMonth(rule->month, year, opts), 
+                                       rule->month, year, opts);
+  int daysAfter=(getWeekDayOfDayNumber(lastDay)-rule->weekday+7)%7;
   
-  //Header : for multiples months, print the year in 1st line
-  if(monthsToPrint>1){
-    printf("%d:%s", year, endLine);
+  if(rule->nearest && daysAfter>3){
+    return lastDay+7-daysAfter;
   }
+  return lastDay-daysAfter;
+}
+
+//Set the fiscal year (its days and periods)
+static void initFiscalYear(const FiscalRule* rule, int year, char* opts, FiscalYear* fiscal){
+  int period;
   
-  //Print all months
-  for(month=monthStart; month<=monthEnd; month=month+monthsToPrint){
-    day=1;
-    
-    //Check the last month to print
-    if(month+monthsToPrint>DECEMBER){
-      lastMonthToPrint=DECEMBER+1;
-    }else{
-      lastMonthToPrint=month+monthsToPrint;
+  fiscal->year=year;
+  fiscal->start=getFiscalYearEnd(rule, year-1, opts)+1;
+  fiscal->end=getFiscalYearEnd(rule, year, opts);
+  fiscal->nbWeeks=(int)((fiscal->end-fiscal->start+1)/7);
+  fiscal->periodStart[0]=fiscal->start;
+  for(period=0; period<FISCAL_PERIODS; period++){
+    fiscal->periodStart[period+1]=fiscal->periodStart[period]+7*rule->weeks[period];
+  }
+  //53rd week : in the last period
+  fiscal->periodStart[FISCAL_PERIODS]=fiscal->end+1;
+}
+
+//Set the fiscal year of a day number, return its period (0-11)
+static int getFiscalPeriod(const FiscalRule* rule, long long dayNumber, 
+                           char* opts, FiscalYear* fiscal){
+  int day, month, year, period;
+  
+  getDateOfDayNumber(dayNumber, &day, &month, &year, opts);
+  if(fiscal->year!=year || dayNumber<fiscal->start || dayNumber>fiscal->end){
+    //(the fiscal year may start in the previous year, or end in the next)
+    initFiscalYear(rule, year, opts, fiscal);
+    if(dayNumber<fiscal->start){
+      initFiscalYear(rule, year-1, opts, fiscal);
+    }else if(dayNumber>fiscal->end){
+      initFiscalYear(rule, year+1, opts, fiscal);
     }
-    
-    //Check the number of days to print
-    if(opts[OPT_IDX_FIXED]==OPT_YES){
-      //Calculate the number of days to print 
-      dayMaxToPrint=0;
-      //Print all the months
-      for(printedMonth=month; printedMonth<lastMonthToPrint; printedMonth++){
-        //Calculate the offset of the first Week
-        offset=getOffsetMonth(1, printedMonth, year, opts);
+  }
+  for(period=0; dayNumber>=fiscal->periodStart[period+1]; period++){
+  }
+  return period;
+}
 
-        //If not a full week for the 1st week, add 1 week
-        if(offset>0){
-          dayMaxMonth=7;
-        }else{
-          dayMaxMonth=0;
-        }
-        //Add days of the months
-        dayMaxMonth=dayMaxMonth+getDaysPerMonth(printedMonth, year, opts);
-        //Remove the offset
-        dayMaxMonth=dayMaxMonth-offset;
-        
-        if(dayMaxToPrint<dayMaxMonth){
-          dayMaxToPrint=dayMaxMonth;
-        }
+//Print the days of a fiscal period (grid : a week by line, vertical : a
+//weekday by line), -WkN : the fiscal weeks
+static void printFiscalPeriod(const FiscalYear* fiscal, int period, char* opts){
+  long long first=fiscal->periodStart[period];
+  int nbWeeks=(int)((fiscal->periodStart[period+1]-first)/7);
+  int startWeek=(int)((first-fiscal->start)/7)+1;
+  int week, weekday, day, month, year;
+  int vertical=(opts[OPT_IDX_VIEW]==OPT_VIEW_VERTICAL);
+  int weekNumbers=(opts[OPT_IDX_WKN]!=OPT_NONE);
+  int nbRows=(vertical) ? 7 : nbWeeks;
+  int nbCols=(vertical) ? nbWeeks : 7;
+  int row, col;
+  
+  getDateOfDayNumber(first, &day, &month, &year, opts);
+  outPrintf("FY%d P%02d (%04d-%02d-%02d, %d weeks):%s", fiscal->year, period+1,
+            year, month+1, day, nbWeeks, endLine);
+  
+  //Header : the weekdays, or the weeks
+  if(vertical){
+    if(weekNumbers){
+      outPrintf("  ");
+      for(week=0; week<nbWeeks; week++){
+        outPrintf(" %02d", startWeek+week);
       }
-      weekdayRow=firstWD;
-    }else if(monthsToPrint>1){
-      dayMaxToPrint=31;
-    }else{
-      dayMaxToPrint=getDaysPerMonth(month, year, opts);
+      outPrintf("%s", endLine);
     }
-    
-    if(monthsToPrint>1){
-      rowSize=2+getSizeHeader(opts);
-    }else{
-      rowSize=0;
+  }else{
+    if(weekNumbers){
+      outPrintf("WkN ");
     }
-    
-    
-    //Print HEADER for subset months
-    for(printedMonth=month; printedMonth<lastMonthToPrint; printedMonth++){
-      
-      //header : Escape the weekday name
-      if(monthsToPrint>1 && printedMonth==month && checkFixedWDLeft){
-        printf("   ");
-      }
-      
-      //HEADER : print Month(s)
-      printMonthName(printedMonth, rowSize);
-      if(monthsToPrint==1){
-        //Print the year, next to the month (if not multiple months)
-        printf(" %d:", year);
-      }else{
-        //escape months
-        if(printedMonth<(lastMonthToPrint-1)){
-          printf("  ");
-        }
+    for(weekday=0; weekday<7; weekday++){
+      printWeekDayName(getWeekDayOfDayNumber(first+weekday), 2);
+      outPrintf(" ");
+    }
+    outPrintf("%s", endLine);
+  }
+  
+  for(row=0; row<nbRows; row++){
+    if(vertical){
+      printWeekDayName(getWeekDayOfDayNumber(first+row), 2);
+    }else if(weekNumbers){
+      outPrintf("W%02d ", startWeek+row);
+    }
+    for(col=0; col<nbCols; col++){
+      week=(vertical) ? col : row;
+      weekday=(vertical) ? row : col;
+      getDateOfDayNumber(first+7*week+weekday, &day, &month, &year, opts);
+      if(vertical){
+        outPrintf(" ");
       }
-      
-      //header : Escape the weekday name
-      if(printedMonth==(lastMonthToPrint-1) && checkFixedWDRight){
-        printf("   ");
+      printDayNumber(day, 2, ' ');
+      if(!vertical){
+        outPrintf(" ");
       }
     }
-    //HEADER (months) : End the line
-    printf("%s", endLine);
+    outPrintf("%s", endLine);
+  }
+  outPrintf("%s", endLine);
+}
 
-   
-    //Print Headers for current month(s)
-    for(printedMonth=month; printedMonth<lastMonthToPrint; printedMonth++){
-      
-      if(printedMonth==month && checkFixedWDLeft){
-        //force-print the weekday name
-        printHeader(OPT_IDX_WD, -2, opts);
-      }
-      
-      //Header : print left columns
-      printHeaders(-1, opts);
-      //HEADER : force-print the day number (centered)
-      printHeader(OPT_IDX_DN, 0, opts);
-      //HEADER : right columns
-      printHeaders(1, opts);
-      
+//Print the periods of a fiscal year (1st rule)
+static void printFiscalYear(int year, char* opts){
+  FiscalYear fiscal;
+  int period;
+  
+  initFiscalYear(&fiscalRules[0], year, opts, &fiscal);
+  for(period=0; period<FISCAL_PERIODS; period++){
+    printFiscalPeriod(&fiscal, period, opts);
+  }
+}
 
-      if(printedMonth==lastMonthToPrint-1){
-        if(checkFixedWDRight){
-          //force-print the weekday name
-          printHeader(OPT_IDX_WD, 2, opts);
-        }
-      }else{
-        if(monthsToPrint>1){
-          //Print space between multiples  months
-          printf("  ");
+//Print the periods of the fiscal years, for all rules :
+//"rule,year,period,YYYY-MM-DD,YYYY-MM-DD,weeks"
+static void printFiscalPeriods(int yearFrom, int yearTo, char* opts){
+  FiscalYear fiscal;
+  int idx, year, period, side, day[2], month[2], dateYear[2];
+  
+  outPrintf("rule,year,period,start,end,weeks%s", endLine);
+  for(idx=0; idx<nbFiscalRules; idx++){
+    for(year=(yearFrom<2) ? 2 : yearFrom; year<=yearTo; year++){
+      initFiscalYear(&fiscalRules[idx], year, opts, &fiscal);
+      for(period=0; period<FISCAL_PERIODS; period++){
+        for(side=0; side<2; side++){
+          getDateOfDayNumber(fiscal.periodStart[period+side]-side, &day[side], 
+                             &month[side], &dateYear[side], opts);
         }
+        outPrintf("%s,%d,%d,%04d-%02d-%02d,%04d-%02d-%02d,%d%s", fiscalRules[idx].name, 
+                  year, period+1, dateYear[0], month[0]+1, day[0], 
+                  dateYear[1], month[1]+1, day[1], (int)((fiscal.periodStart[period+1]-fiscal.periodStart[period])/7),
+                  endLine);
       }
     }
-    //HEADER : ENDline
-    printf("%s", endLine);
+  }
+}
 
-    //Main loop : print days
-    while(day<=dayMaxToPrint){
-      
-      if(checkFixedWDLeft){
-        //print the day names (short : 2 characters) at left
-        printWeekDayName(weekdayRow, 2);
-        printf(" ");
+//Check the fiscal year and period of each day (getFiscalPeriod) against
+//the periods of the fiscal years (printFiscalPeriods), with some rules
+//Return the number of failures
+static int checkFiscalPeriods(int yearFrom, int yearTo, char* opts){
+  static const char* rules[]={"445/12/Sat", "454/sep/sat/last", "544/jan/mon"};
+  FiscalRule rule;
+  FiscalYear expected, fiscal;
+  long long dayNumber;
+  int idx, year, period, failures=0;
+  
+  for(idx=0; idx<(int)(sizeof(rules)/sizeof(rules[0])); idx++){
+    parseFiscalRule(rules[idx], &rule);
+    memset(&fiscal, 0, sizeof(fiscal));
+    for(year=(yearFrom<2) ? 2 : yearFrom; year<=yearTo; year++){
+      initFiscalYear(&rule, year, opts, &expected);
+      for(dayNumber=expected.start; dayNumber<=expected.end; dayNumber++){
+        period=getFiscalPeriod(&rule, dayNumber, opts, &fiscal);
+        if(fiscal.year!=year || dayNumber<expected.periodStart[period] 
+           || dayNumber>=expected.periodStart[period+1]){
+          fprintf(stderr, "check: fiscal %s %lld : FY%d P%02d%s", rules[idx], 
+                  dayNumber, fiscal.year, period+1, endLine);
+          failures++;
+        }
       }
-    
-      //Do for each print month
-      for(printedMonth=month; printedMonth<lastMonthToPrint; printedMonth++){
-      
-        //check the number of days for the printed month
-        daysForPrintedMonth=getDaysPerMonth(printedMonth, year, opts);
+    }
+  }
+  return failures;
+}
 
-        //check the correct day number to print
-        if(opts[OPT_IDX_FIXED]==OPT_YES){
-          //Subtract the daysOnset
-          dayPrinted=day-getOffsetMonth(-1, printedMonth, year, opts);
-        }else{
-          dayPrinted=day;
-        }
-        
-        //Check value of the dayPrinted
-        if(dayPrinted<0 || dayPrinted>daysForPrintedMonth){
-          dayPrinted=0;
-        }
-        
-        // Calculate the 1st day of the printed month...
-        weekday=getFirstWDMonth(printedMonth, year, opts);
+//Time zones (-tz=<zone>) : the TZif files of the system ($TZDIR, or 
+///usr/share/zoneinfo) are mapped once and read in place, the offsets are
+//found by binary search in the transitions (after the last one : the rule
+//of the footer, e.g. "CET-1CEST,M3.5.0,M10.5.0/3"). Today (in the zone) 
+//and the days of the offset changes are marked as events.
+#define ZONES_MAX         16
+#define ZONE_NAME_SIZE    64
+#define ZONE_ABBR_SIZE    16
+#define ZONE_PATH_SIZE    4096
+#define ZONE_DIR          "/usr/share/zoneinfo"
+#define EPOCH_JDN         2440588    //Julian Day Number of 01/01/1970
 
-        //Found the WeekDay by adding the number of days passed
-        weekday=changeWeekDay(weekday, dayPrinted-1);
-      
-        //PRINT INFO (ON THE LEFT)
-        if(dayPrinted>0 && (weekday==firstWD || (dayPrinted==1 && monthsToPrint==1))){
-          //A new week : Print the week number
-          printInfo(dayPrinted, printedMonth, year, -1, OPT_IDX_WKN, opts, 0);
-        }else{
-          //Not a new week, escape the week number (day=0)
-          printInfo(0, printedMonth, year, -1, OPT_IDX_WKN, opts, 0);
-        }
-        printInfo(dayPrinted, printedMonth, year, -1, OPT_IDX_LEFT, opts, 0);
-        printInfo(dayPrinted, printedMonth, year, -1, OPT_IDX_DOY, opts, 0);
-        if(dayPrinted>0 && dayPrinted<=dayMaxToPrint){
-          //Print Weekday name (before the Day number)
-          printInfo(dayPrinted, printedMonth, year, -1, OPT_IDX_WD, opts, 2);
-        }else{
-          //Escape the weekday name
-          printInfo(-1, printedMonth, year, -1, OPT_IDX_WD, opts, 2);
-        }
+//A day of change of the footer rule ("Mm.w.d", "Jn" or "n", then "/time")
+typedef struct {
+  char kind;          //'M' month/week/day, 'J' 1-365 (no 29/02), 'n' 0-365
+  int month;          //1-12
+  int week;           //1-5 (5 : the last)
+  int day;            //0-6, or the day of the year
+  int time;           //seconds after midnight (local time)
+} ZoneRuleDay;
 
+//Footer rule (POSIX TZ), for the times after the last transition
+typedef struct {
+  int valid;
+  int stdOffset;      //seconds east of UTC
+  int dstOffset;
+  int hasDst;
+  char stdAbbr[ZONE_ABBR_SIZE];
+  char dstAbbr[ZONE_ABBR_SIZE];
+  ZoneRuleDay start;  //start of the DST
+  ZoneRuleDay end;
+} ZoneRule;
 
-        //Print the day number
-        if(dayPrinted>0 && dayPrinted<=dayMaxToPrint){
-          printDayNumber(dayPrinted, 2, ' ');
-        }else{
-          printf("  ");
-        }
-        
-        //PRINT INFO (ON THE RIGHT)
-        if(dayPrinted>0 && dayPrinted<=dayMaxToPrint){
-          //Print the Weekday name (after the day number)
-          printInfo(weekday, printedMonth, year, 1, OPT_IDX_WD, opts, 2);
-        }else{
-          //Escape the weekday name
-          printInfo(-1, printedMonth, year, 1, OPT_IDX_WD, opts, 2);
-        }
-        if(dayPrinted>0 && weekday==firstWD){
-          //A new week, print the number
-          printInfo(dayPrinted, printedMonth, year, 1, OPT_IDX_WKN, opts, 0);
-        }else{
-          //Not a new week, escape the week number (day=0) -RIGHT column-
-          printInfo(0, printedMonth, year, 1, OPT_IDX_WKN, opts, 0);
-        }
-        printInfo(dayPrinted, printedMonth, year, 1, OPT_IDX_LEFT, opts, 0);
-        printInfo(dayPrinted, printedMonth, year, 1, OPT_IDX_DOY, opts, 0);
-        
+typedef struct {
+  char name[ZONE_NAME_SIZE];
+  const unsigned char* map;
+  size_t mapSize;
+  const unsigned char* times;     //transitions (big endian, timeSize bytes)
+  const unsigned char* typeIdx;   //type after each transition
+  const unsigned char* types;     //6 bytes : offset (4), DST (1), abbreviation (1)
+  const char* abbrs;
+  int timeSize;                   //4 (version 1) or 8
+  long long nbTimes;
+  long long nbTypes;
+  long long nbChars;
+  ZoneRule rule;
+} Zone;
 
-        if(printedMonth==lastMonthToPrint-1){
-          if(checkFixedWDRight){
-            //print the day names (short : 2 characters)
-            printInfo(dayPrinted, printedMonth, year, 1, OPT_IDX_WD, opts, 2);
-          }
-        }else{
-          if(monthsToPrint>1){
-            //Escape the months
-            printf("  ");
-          }
-        }
+//Offset of a time
+typedef struct {
+  int offset;         //seconds east of UTC
+  int dst;
+  const char* abbr;
+  size_t abbrSize;
+} ZoneOffset;
+
+static Zone zones[ZONES_MAX];
+static int nbZones=0;
+static Zone* currentZone=NULL;          //-tz
+static long long zoneToday=-1;          //day number of today, in the zone
+
+//Read big endian values
+static long long readZoneValue(const unsigned char* bytes, int size){
+  unsigned long long value=0;
+  int idx;
+  
+  for(idx=0; idx<size; idx++){
+    value=(value<<8)|bytes[idx];
+  }
+  //Sign extension
+  if(size<8 && (value>>(size*8-1))){
+    value=value|(~0ULL<<(size*8));
+  }
+  return (long long)value;
+}
+
+//Parse a time "[+-]hh[:mm[:ss]]" of the footer, return the position after
+static const char* parseZoneTime(const char* str, int* seconds){
+  int sign=1, part, value=0;
+  
+  if(*str=='+' || *str=='-'){
+    sign=(*str=='-') ? -1 : 1;
+    str++;
+  }
+  if(*str<'0' || *str>'9'){
+    return NULL;
+  }
+  for(part=0; part<3; part++){
+    int number=0;
+    while(*str>='0' && *str<='9' && number<1000){
+      number=number*10+(*str++-'0');
+    }
+    value=value*60+number;
+    if(*str!=':' || part==2){
+      for(part++; part<3; part++){
+        value=value*60;
       }
-      
-      //Increment values
-      day++;
-      weekdayRow=changeWeekDay(weekdayRow, 1);
+      break;
+    }
+    str++;
+  }
+  *seconds=sign*value;
+  return str;
+}
 
-      if(day<=dayMaxToPrint){
-        //End of the line
-        printf("%s", endLine);
+//Parse an abbreviation ("CET", or "<+03>") of the footer
+static const char* parseZoneAbbr(const char* str, char* abbr){
+  size_t size=0;
+  char end=(*str=='<') ? '>' : '\0';
+  
+  str=str+(end=='>');
+  while(*str!='\0' && ((end=='>' && *str!='>') 
+                       || (end=='\0' && ((*str>='A' && *str<='Z') || (*str>='a' && *str<='z'))))){
+    if(size<ZONE_ABBR_SIZE-1){
+      abbr[size++]=*str;
+    }
+    str++;
+  }
+  abbr[size]='\0';
+  if(end=='>'){
+    return (*str=='>') ? str+1 : NULL;
+  }
+  return (size>=3) ? str : NULL;
+}
+
+//Parse a day of change of the footer rule
+static const char* parseZoneRuleDay(const char* str, ZoneRuleDay* ruleDay){
+  char* end;
+  
+  ruleDay->time=2*3600;
+  if(*str=='M'){
+    ruleDay->kind='M';
+    ruleDay->month=(int)strtol(str+1, &end, 10);
+    if(*end!='.'){
+      return NULL;
+    }
+    ruleDay->week=(int)strtol(end+1, &end, 10);
+    if(*end!='.'){
+      return NULL;
+    }
+    ruleDay->day=(int)strtol(end+1, &end, 10);
+    if(ruleDay->month<1 || ruleDay->month>12 || ruleDay->week<1 || ruleDay->week>5
+       || ruleDay->day<0 || ruleDay->day>6){
+      return NULL;
+    }
+  }else{
+    ruleDay->kind=(*str=='J') ? 'J' : 'n';
+    ruleDay->day=(int)strtol(str+(*str=='J'), &end, 10);
+    if(end==str+(*str=='J') || ruleDay->day<0 || ruleDay->day>365){
+      return NULL;
+    }
+  }
+  if(*end=='/'){
+    //(hours from -167 to 167 : the time can be the next days)
+    return parseZoneTime(end+1, &ruleDay->time);
+  }
+  return end;
+}
+
+//Parse the footer rule, e.g. "EST5EDT,M3.2.0,M11.1.0"
+static void parseZoneRule(const char* str, size_t size, ZoneRule* rule){
+  char tz[128];
+  const char* c=tz;
+  int seconds;
+  
+  memset(rule, 0, sizeof(ZoneRule));
+  if(size==0 || size>=sizeof(tz)){
+    return;
+  }
+  memcpy(tz, str, size);
+  tz[size]='\0';
+  
+  //Standard time (POSIX offsets are west of UTC)
+  c=parseZoneAbbr(c, rule->stdAbbr);
+  if(c==NULL || (c=parseZoneTime(c, &seconds))==NULL){
+    return;
+  }
+  rule->stdOffset=-seconds;
+  rule->dstOffset=rule->stdOffset;
+  if(*c=='\0'){
+    rule->valid=1;
+    return;
+  }
+  
+  //DST : 1 hour more by default
+  c=parseZoneAbbr(c, rule->dstAbbr);
+  if(c==NULL){
+    return;
+  }
+  rule->dstOffset=rule->stdOffset+3600;
+  if(*c!=',' && *c!='\0'){
+    if((c=parseZoneTime(c, &seconds))==NULL){
+      return;
+    }
+    rule->dstOffset=-seconds;
+  }
+  if(*c!=',' || (c=parseZoneRuleDay(c+1, &rule->start))==NULL
+     || *c!=',' || (c=parseZoneRuleDay(c+1, &rule->end))==NULL || *c!='\0'){
+    return;
+  }
+  rule->hasDst=1;
+  rule->valid=1;
+}
+
+//Return the local time (seconds since 1970) of a day of change of a year
+static long long getZoneRuleTime(const ZoneRuleDay* ruleDay, int year){
+  long long dayNumber;
+  int weekday, days, leap=((year%4==0 && year%100!=0) || year%400==0);
+  char gregorian[OPTS_NB];
+  
+  //(the rules are Gregorian)
+  memset(gregorian, OPT_NONE, sizeof(gregorian));
+  gregorian[OPT_IDX_LYC]=OPT_LYC_GREGORIAN;
+  dayNumber=getJulianDayNumber(1, JANUARY, year, gregorian);
+  if(ruleDay->kind=='M'){
+    days=getDaysPerMonth(ruleDay->month-1, year, gregorian);
+    dayNumber=getJulianDayNumber(1, ruleDay->month-1, year, gregorian);
+    weekday=getWeekDayOfDayNumber(dayNumber);
+    dayNumber=dayNumber+(ruleDay->day-weekday+7)%7+7*(ruleDay->week-1);
+    while(dayNumber>=getJulianDayNumber(1, ruleDay->month-1, year, gregorian)+days){
+      dayNumber=dayNumber-7;
+    }
+  }else if(ruleDay->kind=='J'){
+    //1-365, the 29th February is not counted
+    dayNumber=dayNumber+ruleDay->day-1+(leap && ruleDay->day>59);
+  }else{
+    dayNumber=dayNumber+ruleDay->day;
+  }
+  return (dayNumber-EPOCH_JDN)*86400+ruleDay->time;
+}
+
+//Return the offset of the footer rule at a time (UTC)
+static ZoneOffset getZoneRuleOffset(const ZoneRule* rule, long long utc){
+  ZoneOffset result;
+  long long start, end;
+  int day, month, year;
+  char gregorian[OPTS_NB];
+  
+  result.offset=rule->stdOffset;
+  result.dst=0;
+  result.abbr=rule->stdAbbr;
+  if(rule->hasDst){
+    memset(gregorian, OPT_NONE, sizeof(gregorian));
+    gregorian[OPT_IDX_LYC]=OPT_LYC_GREGORIAN;
+    getDateOfDayNumber(EPOCH_JDN+(utc+rule->stdOffset)/86400-(utc+rule->stdOffset<0), 
+                       &day, &month, &year, gregorian);
+    //Start : in standard time, end : in DST (UTC times)
+    start=getZoneRuleTime(&rule->start, year)-rule->stdOffset;
+    end=getZoneRuleTime(&rule->end, year)-rule->dstOffset;
+    if((start<end && utc>=start && utc<end) || (start>end && (utc>=start || utc<end))){
+      result.offset=rule->dstOffset;
+      result.dst=1;
+      result.abbr=rule->dstAbbr;
+    }
+  }
+  result.abbrSize=strlen(result.abbr);
+  return result;
+}
+
+//Return the offset of a zone at a time (UTC)
+static ZoneOffset getZoneOffset(const Zone* zone, long long utc){
+  ZoneOffset result;
+  const unsigned char* type;
+  long long low=0, high=zone->nbTimes, middle, idx;
+  
+  //After the last transition : the rule
+  if(zone->rule.valid && (zone->nbTimes==0 
+     || utc>=readZoneValue(zone->times+(zone->nbTimes-1)*zone->timeSize, zone->timeSize))){
+    return getZoneRuleOffset(&zone->rule, utc);
+  }
+  
+  //Last transition before the time (before the 1st one : the 1st type)
+  while(low<high){
+    middle=low+(high-low)/2;
+    if(readZoneValue(zone->times+middle*zone->timeSize, zone->timeSize)<=utc){
+      low=middle+1;
+    }else{
+      high=middle;
+    }
+  }
+  idx=(low>0) ? zone->typeIdx[low-1] : 0;
+  type=zone->types+idx*6;
+  result.offset=(int)readZoneValue(type, 4);
+  result.dst=type[4];
+  result.abbr=zone->abbrs+type[5];
+  result.abbrSize=strnlen(result.abbr, zone->nbChars-type[5]);
+  return result;
+}
+
+//Read the header of a data block, return the size of the block (0 : invalid)
+//(the zone is changed only if the block is valid)
+static size_t readZoneHeader(const unsigned char* header, size_t size, int timeSize, 
+                             Zone* zone){
+  long long isUt, isStd, nbLeaps, nbTimes, nbTypes, nbChars;
+  size_t blockSize;
+  
+  if(size<44 || memcmp(header, "TZif", 4)!=0){
+    return 0;
+  }
+  isUt=readZoneValue(header+20, 4);
+  isStd=readZoneValue(header+24, 4);
+  nbLeaps=readZoneValue(header+28, 4);
+  nbTimes=readZoneValue(header+32, 4);
+  nbTypes=readZoneValue(header+36, 4);
+  nbChars=readZoneValue(header+40, 4);
+  if(isUt<0 || isStd<0 || nbLeaps<0 || nbTimes<0 || nbTypes<1 || nbTypes>256 
+     || nbChars<1 || nbTimes>(1<<20) || isUt>256 || isStd>256 || nbLeaps>(1<<16) 
+     || nbChars>(1<<16)){
+    return 0;
+  }
+  blockSize=44+nbTimes*(timeSize+1)+nbTypes*6+nbChars+nbLeaps*(timeSize+4)+isStd+isUt;
+  if(blockSize>size){
+    return 0;
+  }
+  zone->nbTimes=nbTimes;
+  zone->nbTypes=nbTypes;
+  zone->nbChars=nbChars;
+  zone->timeSize=timeSize;
+  zone->times=header+44;
+  zone->typeIdx=zone->times+nbTimes*timeSize;
+  zone->types=zone->typeIdx+nbTimes;
+  zone->abbrs=(const char*)(zone->types+nbTypes*6);
+  return blockSize;
+}
+
+//Return a zone (mapped once), NULL if not found or not valid
+static Zone* getZone(const char* name){
+  char path[ZONE_PATH_SIZE];
+  const char* dir=getenv("TZDIR");
+  const unsigned char* footer;
+  const unsigned char* footerEnd;
+  struct stat fileStat;
+  size_t blockSize, dataSize;
+  long long idx;
+  Zone* zone;
+  int fd;
+  
+  for(idx=0; idx<nbZones; idx++){
+    if(strcmp(zones[idx].name, name)==0){
+      return &zones[idx];
+    }
+  }
+  //Names of the zones folder only
+  if(nbZones>=ZONES_MAX || name[0]=='\0' || name[0]=='/' || strstr(name, "..")!=NULL
+     || strlen(name)>=ZONE_NAME_SIZE){
+    return NULL;
+  }
+  snprintf(path, sizeof(path), "%s/%s", (dir!=NULL && dir[0]!='\0') ? dir : ZONE_DIR, name);
+  fd=open(path, O_RDONLY);
+  if(fd<0 || fstat(fd, &fileStat)!=0 || !S_ISREG(fileStat.st_mode) || fileStat.st_size<44){
+    if(fd>=0){
+      close(fd);
+    }
+    return NULL;
+  }
+  zone=&zones[nbZones];
+  memset(zone, 0, sizeof(Zone));
+  zone->mapSize=fileStat.st_size;
+  zone->map=mmap(NULL, zone->mapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(zone->map==MAP_FAILED){
+    return NULL;
+  }
+  
+  //Version 1 data, then (version 2+) the 64-bit data and the footer rule
+  //(a file with invalid 64-bit data is not used)
+  blockSize=readZoneHeader(zone->map, zone->mapSize, 4, zone);
+  if(blockSize>0 && zone->map[4]>='2'){
+    dataSize=readZoneHeader(zone->map+blockSize, zone->mapSize-blockSize, 8, zone);
+    blockSize=(dataSize>0) ? blockSize+dataSize : 0;
+    footer=zone->map+blockSize;
+    if(blockSize>0 && footer<zone->map+zone->mapSize && *footer=='\n'){
+      footerEnd=memchr(footer+1, '\n', zone->map+zone->mapSize-footer-1);
+      if(footerEnd!=NULL){
+        parseZoneRule((const char*)footer+1, footerEnd-footer-1, &zone->rule);
+      }
+    }
+  }
+  
+  //The types of the transitions and the abbreviations must exist
+  for(idx=0; blockSize>0 && idx<zone->nbTimes; idx++){
+    if(zone->typeIdx[idx]>=zone->nbTypes){
+      blockSize=0;
+    }
+  }
+  for(idx=0; blockSize>0 && idx<zone->nbTypes; idx++){
+    if(zone->types[idx*6+5]>=zone->nbChars){
+      blockSize=0;
+    }
+  }
+  if(blockSize==0){
+    munmap((void*)zone->map, zone->mapSize);
+    return NULL;
+  }
+  snprintf(zone->name, sizeof(zone->name), "%s", name);
+  nbZones++;
+  return zone;
+}
+
+//Return the UTC time of the start of a day (day number) in a zone
+static long long getZoneDayStart(const Zone* zone, long long dayNumber){
+  long long local=(dayNumber-EPOCH_JDN)*86400;
+  
+  //(the offset of the day before : the changes are not at midnight)
+  return local-getZoneOffset(zone, local-86400).offset;
+}
+
+//Return 1 if the offset of the zone changes during a day (day number)
+static int isZoneChangeDay(const Zone* zone, long long dayNumber){
+  return getZoneOffset(zone, getZoneDayStart(zone, dayNumber)).offset
+         !=getZoneOffset(zone, getZoneDayStart(zone, dayNumber+1)).offset;
+}
+
+//Set the zone and today (in the zone), return 0 if OK
+static int setZone(const char* name){
+  long long now=(long long)time(NULL);
+  long long local;
+  
+  currentZone=getZone(name);
+  if(currentZone==NULL){
+    return -1;
+  }
+  local=now+getZoneOffset(currentZone, now).offset;
+  zoneToday=EPOCH_JDN+local/86400-(local<0 && local%86400!=0);
+  return 0;
+}
+
+//Events (-events <file>) : lines "YYYY-MM-DD[/YYYY-MM-DD] summary",
+//indexed once by day numbers (sorted by start, with the maximum end of the
+//previous events for the overlaps), the index is kept in "<file>.idx" (used
+//while the size and the FNV-1a hash of the file are the same)
+//Recurrent events : "YYYY-MM-DD RRULE:<rule> summary" (DTSTART : the date)
+#define EVENTS_MAGIC        "CALEVT3"
+#define EVENTS_MARK         '*'
+#define EVENTS_PATH_SIZE    4096
+#define EVENTS_COLUMNS_SIZE 4           //"  Ev"
+#define EVENTS_YEAR_DAYS    (31+366+31) //December before, year, January after
+#define EVENTS_LINE_SIZE    512
+#define RRULE_ARGS_MAX      16          //-rrule options
+
+//An event (or a period), in Julian Day Numbers
+typedef struct {
+  long long start;
+  long long end;
+  long long maxEnd;  //maximum end of this event and the events before
+} EventRecord;
+
+//Continue a FNV-1a hash with the bytes of a string
+static unsigned long long addHash(unsigned long long hash, const char* str, size_t size){
+  size_t c;
+  
+  for(c=0; c<size; c++){
+    hash=(hash^(unsigned char)str[c])*1099511628211ULL;
+  }
+  return hash;
+}
+
+//Return the FNV-1a hash of a chunk
+static unsigned long long hashChunk(const char* str, size_t size){
+  return addHash(14695981039346656037ULL, str, size);
+}
+
+//Header of the index file
+typedef struct {
+  char magic[7];
+  char lyc;                //leap year calculation used for the dates
+  long long sourceSize;    //the index is used only for the same file
+  unsigned long long sourceHash; //(FNV-1a : a rewrite keeps the size and the time)
+  long long count;
+  long long ruleCount;     //the rules are after the records
+} EventsHeader;
+
+typedef struct {
+  int enabled;             //events or rules (-events, -rrule)
+  long long count;
+  const EventRecord* records;
+  long long ruleCount;
+  const RRule* rules;
+  EventRecord* allocated;  //records parsed (no index file mapped)
+  RRule* allocatedRules;
+  void* map;               //index file mapped
+  size_t mapSize;
+} EventsIndex;
+
+static EventsIndex eventsIndex={0, 0, NULL, 0, NULL, NULL, NULL, NULL, 0};
+
+//Rules of the options (-rrule)
+static RRule argsRules[RRULE_ARGS_MAX];
+static int nbArgsRules=0;
+static RRuleIterator rruleIterator;
+
+//Number of events of the days of a year (and of the months around)
+typedef struct {
+  int year;
+  char lyc;
+  int ready;
+  int daysInYear;
+  int firstDayMonth[12];   //index of the 1st day of the months
+  unsigned short counts[EVENTS_YEAR_DAYS];
+} YearEvents;
+
+static YearEvents yearEvents;
+
+//Sort the events by start (then end)
+static int compareEvents(const void* a, const void* b){
+  const EventRecord* eventA=(const EventRecord*)a;
+  const EventRecord* eventB=(const EventRecord*)b;
+  if(eventA->start!=eventB->start){
+    return (eventA->start<eventB->start) ? -1 : 1;
+  }
+  return (eventA->end>eventB->end)-(eventA->end<eventB->end);
+}
+
+//Read a date "YYYY-MM-DD" as a Julian Day Number, return the end of the date
+//or NULL if not a valid date
+static const char* parseEventDate(const char* str, long long* dayNumber, char* opts){
+  char* end;
+  long year, month, day;
+  
+  year=strtol(str, &end, 10);
+  if(end==str || *end!='-' || year<1 || year>999999){
+    return NULL;
+  }
+  str=end+1;
+  month=strtol(str, &end, 10);
+  if(end==str || *end!='-' || month<1 || month>12){
+    return NULL;
+  }
+  str=end+1;
+  day=strtol(str, &end, 10);
+  if(end==str || day<1 || day>getDaysPerMonth(month-1, (int)year, opts)){
+    return NULL;
+  }
+  
+  *dayNumber=getJulianDayNumber((int)day, (int)month-1, (int)year, opts);
+  return end;
+}
+
+//Add a value to a growing array, return 0 if OK
+static int appendValue(void** values, long long* count, long long* capacity, 
+                       const void* value, size_t size){
+  void* newValues;
+  
+  if(*count==*capacity){
+    *capacity=(*capacity==0) ? 1024 : *capacity*2;
+    newValues=realloc(*values, *capacity*size);
+    if(newValues==NULL){
+      return -1;
+    }
+    *values=newValues;
+  }
+  memcpy((char*)*values+(*count)*size, value, size);
+  (*count)++;
+  return 0;
+}
+
+//Parse the events (and rules) of a text
+//Return 0 if OK, -1 if not enough memory
+static int parseEvents(const char* text, size_t size, char* opts){
+  char line[EVENTS_LINE_SIZE];
+  const char* str;
+  size_t c=0, length;
+  long long count=0, capacity=0, ruleCount=0, ruleCapacity=0, lineNumber=0;
+  EventRecord* records=NULL;
+  RRule* rules=NULL;
+  EventRecord event;
+  RRule rule;
+  int result=0;
+  
+  while(c<size && result==0){
+    //Copy the start of the line (the dates, the rule)
+    lineNumber++;
+    for(length=0; c+length<size && text[c+length]!='\n'; length++){
+    }
+    snprintf(line, sizeof(line), "%.*s", (int)((length<sizeof(line)) ? length : sizeof(line)-1), text+c);
+    c=c+length+1;
+    
+    //Empty lines and comments
+    if(line[0]=='\0' || line[0]=='#' || line[0]=='\r'){
+      continue;
+    }
+    
+    str=parseEventDate(line, &event.start, opts);
+    event.end=event.start;
+    if(str!=NULL && strncmp(str, " RRULE:", 7)==0){
+      //A recurrent event
+      if(parseRRule(str+1, event.start, &rule, opts)!=0){
+        fprintf(stderr, "Invalid rule, line %lld%s", lineNumber, endLine);
+        continue;
+      }
+      result=appendValue((void**)&rules, &ruleCount, &ruleCapacity, &rule, sizeof(RRule));
+      continue;
+    }
+    if(str!=NULL && *str=='/'){
+      str=parseEventDate(str+1, &event.end, opts);
+    }
+    if(str==NULL || event.end<event.start){
+      fprintf(stderr, "Invalid event, line %lld%s", lineNumber, endLine);
+      continue;
+    }
+    result=appendValue((void**)&records, &count, &capacity, &event, sizeof(EventRecord));
+  }
+  
+  if(result!=0){
+    free(records);
+    free(rules);
+    return -1;
+  }
+  
+  //Sort, and set the maximum end for the overlaps
+  if(count>0){
+    qsort(records, count, sizeof(EventRecord), compareEvents);
+    records[0].maxEnd=records[0].end;
+    for(c=1; c<(size_t)count; c++){
+      records[c].maxEnd=records[c].end;
+      if(records[c].maxEnd<records[c-1].maxEnd){
+        records[c].maxEnd=records[c-1].maxEnd;
+      }
+    }
+  }
+  
+  eventsIndex.allocated=records;
+  eventsIndex.records=records;
+  eventsIndex.count=count;
+  eventsIndex.allocatedRules=rules;
+  eventsIndex.rules=rules;
+  eventsIndex.ruleCount=ruleCount;
+  return 0;
+}
+
+//Map the index file, if it's the index of the source
+//Return 0 if mapped
+static int mapEventsIndex(const char* indexName, struct stat* sourceStat, 
+                          unsigned long long sourceHash, char* opts){
+  struct stat indexStat;
+  const EventsHeader* header;
+  void* map;
+  int fd=open(indexName, O_RDONLY);
+  
+  if(fd<0){
+    return -1;
+  }
+  if(fstat(fd, &indexStat)!=0 || (size_t)indexStat.st_size<sizeof(EventsHeader)){
+    close(fd);
+    return -1;
+  }
+  map=mmap(NULL, indexStat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if(map==MAP_FAILED){
+    return -1;
+  }
+  
+  header=(const EventsHeader*)map;
+  if(memcmp(header->magic, EVENTS_MAGIC, sizeof(header->magic))!=0
+     || header->lyc!=opts[OPT_IDX_LYC]
+     || header->sourceSize!=(long long)sourceStat->st_size
+     || header->sourceHash!=sourceHash
+     || header->count<0 || header->ruleCount<0
+     || (size_t)indexStat.st_size!=sizeof(EventsHeader)+header->count*sizeof(EventRecord)
+                                   +header->ruleCount*sizeof(RRule)){
+    munmap(map, indexStat.st_size);
+    return -1;
+  }
+  
+  eventsIndex.map=map;
+  eventsIndex.mapSize=indexStat.st_size;
+  eventsIndex.count=header->count;
+  eventsIndex.records=(const EventRecord*)((const char*)map+sizeof(EventsHeader));
+  eventsIndex.ruleCount=header->ruleCount;
+  eventsIndex.rules=(const RRule*)(eventsIndex.records+header->count);
+  return 0;
+}
+
+//Write the index file (not an error if not possible)
+static void writeEventsIndex(const char* indexName, struct stat* sourceStat, 
+                             unsigned long long sourceHash, char* opts){
+  EventsHeader header;
+  struct iovec fragments[3];
+  char tmpName[EVENTS_PATH_SIZE+32];
+  int fd;
+  
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, EVENTS_MAGIC, sizeof(header.magic));
+  header.lyc=opts[OPT_IDX_LYC];
+  header.sourceSize=(long long)sourceStat->st_size;
+  header.sourceHash=sourceHash;
+  header.count=eventsIndex.count;
+  header.ruleCount=eventsIndex.ruleCount;
+  
+  //Written in a temporary file, then renamed (never a partial index)
+  snprintf(tmpName, sizeof(tmpName), "%s.%ld", indexName, (long)getpid());
+  fd=open(tmpName, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+  if(fd<0){
+    return;
+  }
+  fragments[0].iov_base=&header;
+  fragments[0].iov_len=sizeof(header);
+  fragments[1].iov_base=(void*)eventsIndex.records;
+  fragments[1].iov_len=eventsIndex.count*sizeof(EventRecord);
+  fragments[2].iov_base=(void*)eventsIndex.rules;
+  fragments[2].iov_len=eventsIndex.ruleCount*sizeof(RRule);
+  if(writeFragments(fd, fragments, 3)!=0 || close(fd)!=0 || rename(tmpName, indexName)!=0){
+    unlink(tmpName);
+  }
+}
+
+//Load the events of a file (from its index if up to date)
+//Return 0 if OK
+static int loadEvents(const char* fileName, char* opts){
+  char indexName[EVENTS_PATH_SIZE];
+  struct stat sourceStat;
+  const char* text=NULL;
+  unsigned long long sourceHash;
+  int result;
+  int fd;
+  
+  fd=open(fileName, O_RDONLY);
+  if(fd<0 || fstat(fd, &sourceStat)!=0){
+    if(fd>=0){
+      close(fd);
+    }
+    fprintf(stderr, "Cannot read %s%s", fileName, endLine);
+    return -1;
+  }
+  if(sourceStat.st_size>0){
+    text=mmap(NULL, sourceStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(text==MAP_FAILED){
+      close(fd);
+      fprintf(stderr, "Cannot read %s%s", fileName, endLine);
+      return -1;
+    }
+  }
+  close(fd);
+  eventsIndex.enabled=1;
+  yearEvents.ready=0;
+  sourceHash=hashChunk(text, (text!=NULL) ? (size_t)sourceStat.st_size : 0);
+  
+  //(no index for a too long name : it would be the index of another file)
+  indexName[0]='\0';
+  if(strlen(fileName)+4<sizeof(indexName)){
+    snprintf(indexName, sizeof(indexName), "%s.idx", fileName);
+  }
+  if(indexName[0]!='\0' && mapEventsIndex(indexName, &sourceStat, sourceHash, opts)==0){
+    result=0;
+  }else{
+    //Parse the file, then write its index
+    result=(text!=NULL) ? parseEvents(text, sourceStat.st_size, opts) : 0;
+    if(result==0 && indexName[0]!='\0'){
+      writeEventsIndex(indexName, &sourceStat, sourceHash, opts);
+    }
+  }
+  if(text!=NULL){
+    munmap((void*)text, sourceStat.st_size);
+  }
+  if(result!=0){
+    fprintf(stderr, "Not enough memory for the events%s", endLine);
+    return -1;
+  }
+  return 0;
+}
+
+//Count the events of each day of the year (and of the months around)
+static YearEvents* getYearEvents(int year, char* opts){
+  YearEvents* counts=&yearEvents;
+  const EventRecord* records=eventsIndex.records;
+  long long first, last, start, end, low, high, middle, idx;
+  int month, day, total;
+  int diff[EVENTS_YEAR_DAYS+1];
+  
+  if(counts->ready && counts->year==year && counts->lyc==opts[OPT_IDX_LYC]){
+    return counts;
+  }
+  counts->year=year;
+  counts->lyc=opts[OPT_IDX_LYC];
+  counts->daysInYear=getDaysInfYear(year, opts);
+  for(month=JANUARY; month<=DECEMBER; month++){
+    counts->firstDayMonth[month]=31+getDayOfYear(0, month, year, opts);
+  }
+  
+  //Days of the year : from the 1st December before to the 31 January after
+  first=getJulianDayNumber(1, JANUARY, year, opts)-31;
+  last=first+31+counts->daysInYear+31-1;
+  memset(diff, 0, sizeof(diff));
+  
+  //1st event ending in the days (the maximum ends are sorted)
+  low=0;
+  high=eventsIndex.count;
+  while(low<high){
+    middle=low+(high-low)/2;
+    if(records[middle].maxEnd<first){
+      low=middle+1;
+    }else{
+      high=middle;
+    }
+  }
+  
+  //Events until the last day
+  for(idx=low; idx<eventsIndex.count && records[idx].start<=last; idx++){
+    if(records[idx].end>=first){
+      start=(records[idx].start<first) ? first : records[idx].start;
+      end=(records[idx].end>last) ? last : records[idx].end;
+      diff[start-first]++;
+      diff[end-first+1]--;
+    }
+  }
+  
+  //Occurrences of the rules (of the events file, then of the options)
+  for(idx=0; idx<eventsIndex.ruleCount+nbArgsRules; idx++){
+    if(idx<eventsIndex.ruleCount){
+      initRRuleIterator(&rruleIterator, &eventsIndex.rules[idx], first, opts);
+    }else{
+      initRRuleIterator(&rruleIterator, &argsRules[idx-eventsIndex.ruleCount], first, opts);
+    }
+    for(start=nextRRule(&rruleIterator, opts); start>=0 && start<=last; 
+        start=nextRRule(&rruleIterator, opts)){
+      diff[start-first]++;
+      diff[start-first+1]--;
+    }
+  }
+  
+  //Moveable feasts of the year
+  if(feastsEnabled && year>0){
+    start=getEasterDayNumber(year, opts)-first;
+    for(idx=0; idx<FEASTS_NB; idx++){
+      diff[start+feasts[idx].offset]++;
+      diff[start+feasts[idx].offset+1]--;
+    }
+  }
+  
+  //Today and the changes of offset of the zone
+  if(currentZone!=NULL && year>0){
+    if(zoneToday>=first && zoneToday<=last){
+      diff[zoneToday-first]++;
+      diff[zoneToday-first+1]--;
+    }
+    for(start=first; start<=last; start++){
+      if(isZoneChangeDay(currentZone, start)){
+        diff[start-first]++;
+        diff[start-first+1]--;
+      }
+    }
+  }
+  
+  //Sum the differences
+  total=0;
+  for(day=0; day<EVENTS_YEAR_DAYS; day++){
+    total=total+diff[day];
+    counts->counts[day]=(total>65535) ? 65535 : (unsigned short)total;
+  }
+  
+  counts->ready=1;
+  return counts;
+}
+
+//Return the number of events of a day
+//(yearShift : -1 December before the year, 1 January after the year)
+static int getDayEvents(YearEvents* counts, int day, int month, int yearShift){
+  if(yearShift<0){
+    return counts->counts[day-1];
+  }
+  if(yearShift>0){
+    return counts->counts[31+counts->daysInYear+day-1];
+  }
+  return counts->counts[counts->firstDayMonth[month]+day-1];
+}
+
+//Print the occurrences of the rules (events file, then options) between
+//two day numbers : "YYYY-MM-DD,Weekday"
+static void printOccurrences(long long from, long long to, char* opts){
+  long long idx, dayNumber;
+  int day, month, year;
+  
+  for(idx=0; idx<eventsIndex.ruleCount+nbArgsRules; idx++){
+    if(idx<eventsIndex.ruleCount){
+      initRRuleIterator(&rruleIterator, &eventsIndex.rules[idx], from, opts);
+    }else{
+      initRRuleIterator(&rruleIterator, &argsRules[idx-eventsIndex.ruleCount], from, opts);
+    }
+    for(dayNumber=nextRRule(&rruleIterator, opts); dayNumber>=0 && dayNumber<=to; 
+        dayNumber=nextRRule(&rruleIterator, opts)){
+      getDateOfDayNumber(dayNumber, &day, &month, &year, opts);
+      outPrintf("%04d-%02d-%02d,%s%s", year, month+1, day, 
+                weekdays[getWeekDayOfDayNumber(dayNumber)], endLine);
+    }
+  }
+}
+
+//Print the number of events of a day (escaped if day=0 or no events)
+static void printEventsInfo(YearEvents* counts, int day, int month){
+  int count=(day>0) ? getDayEvents(counts, day, month, 0) : 0;
+  if(count>0){
+    outPrintf(" %3d", (count>999) ? 999 : count);
+  }else{
+    outPrintf("    ");
+  }
+}
+
+//Return the number of characters used for headers (computed)
+static int computeSizeHeader(char* opts){
+  int cPos, headerIdx;
+  int tmpCheckOpt, checkLeft, checkRight;
+  int sizeResult=0;
+  
+  for(cPos=-1; cPos<2; cPos++){
+    for(headerIdx=0; headerIdx<OPTS_IDX_PRINTED; headerIdx++){
+      tmpCheckOpt=(opts[headerIdx]==OPT_LEFT || opts[headerIdx]==OPT_BOTH);
+      checkLeft=(cPos<0 && tmpCheckOpt);
+      tmpCheckOpt=(opts[headerIdx]==OPT_RIGHT || opts[headerIdx]==OPT_BOTH);
+      checkRight=(cPos>0 && tmpCheckOpt);
+        
+      if(opts[headerIdx]!=OPT_NONE){
+        //Right Column : add a space BEFORE writing the week header
+        if(checkRight){
+          sizeResult++;
+        }
+
+        if(checkLeft || checkRight){
+          sizeResult=sizeResult+strlen(headerStr[headerIdx]);
+        }
+        
+        //Left Column: Add a space AFTER writing the week header
+        if(checkLeft){
+          sizeResult++;
+        }
+      }
+    }
+  }
+
+  return sizeResult;
+}
+
+//print the headerIdx header
+//cPos=-1 : a left column, cPos=1 : a right column
+//cPos=-2 : Force left column, 
+// cPos=0 : force centered
+// cPos=2 : Force right column
+static void printHeader(int headerIdx, int cPos, char* opts){
+  int checkLeft=(cPos<0);
+  int checkRight=(cPos>0);
+  if(cPos==-1){
+    checkLeft=(opts[headerIdx]==OPT_LEFT || opts[headerIdx]==OPT_BOTH);
+  }
+  if(cPos==1){
+    checkRight=(opts[headerIdx]==OPT_RIGHT || opts[headerIdx]==OPT_BOTH);
+  }
+  
+  if(cPos!=-1 || cPos!=1 || opts[headerIdx]!=OPT_NONE){
+    //Right Column : add a space BEFORE writing the week header
+    if(checkRight){
+      outPrintf(" ");
+    }
+
+    if(cPos==0 || checkLeft || checkRight){
+      //Print the header
+      outPrintf("%s", headerStr[headerIdx]);
+    }
+    
+    //Left Column: Add a space AFTER writing the week header
+    if(checkLeft){
+      outPrintf(" ");
+    }
+  }
+}
+
+//print the week number
+//if day=0 : escape the field (=same week than before)
+static void printWeekNumber(int day, int month, int year, char* opts){
+  if(day>0){
+    //Get the week number
+    int weekNumber=getWeekNumber(day, month, year, opts);
+    
+    //Print the week number ("W01", "W02"...)
+    outPrintf("W");
+    printDayNumber(weekNumber, strlen(headerStr[OPT_IDX_WKN])-1, '0');
+  }else{
+    //space the week number
+    outPrintf("   ");
+  }
+}
+
+//print the number of days left
+//if day=0 : escape the field
+static void printDaysLeft(int day, int month, int year, char* opts){    
+  if(day>0){
+    //Calculate the days passed
+    int daysInYear=getDaysInfYear(year, opts);
+    int daysPassed=getDayOfYear(day, month, year, opts);
+    int daysLeft=daysInYear-daysPassed;
+    
+    //Print the days left
+    printDayNumber(daysLeft, strlen(headerStr[OPT_IDX_LEFT]), ' ');
+  }else{
+    //space the days left
+    outPrintf("   ");
+  }
+}
+
+//Print the day of the year
+//if day=0 : escape the field
+static void printDayOfYear(int day, int month, int year, char* opts){
+  if(day>0){
+    //get the day of the year
+    int dayOfYear=getDayOfYear(day, month, year, opts);
+      
+    //Print the day
+    printDayNumber(dayOfYear, strlen(headerStr[OPT_IDX_DOY]), ' ');
+  }else{
+    //space the day of the year
+    outPrintf("   ");
+  }
+}
+
+//Print the WeekDay (name)
+//if day=-1 : escape the field
+static void printWeekDay(int dayWeek, int numLetters){    
+  if(dayWeek>-1){
+    //Print the weekday
+    printWeekDayName(dayWeek, numLetters);
+  }else{
+    //Escape the numLetters
+    for(int c=0;c<numLetters;c++){
+      outPrintf(" ");
+    }
+  }
+}
+
+//print headers, depending of opts
+//cPos=-1 : a left column, cPos=1 : a right column
+static void printHeaders(int cPos, char* opts){
+  int i;
+  if(cPos<0){
+    //print the headers
+    for(i=0; i<OPTS_IDX_PRINTED; i++){
+      printHeader(i, cPos, opts);
+    }
+  }else{
+    //print the header (inverted)
+    for(i=OPTS_IDX_PRINTED-1; i>-1; i--){
+      printHeader(i, cPos, opts);
+    }
+  }
+}
+
+//print info
+//cPos=-1 : a left column, cPos=1 : a right column
+static int printInfo(int day, int month, int year, int cPos, 
+                      int optsIdx, char* opts, int numLetters){
+  int printed=0;
+  int checkLeft=(cPos<0);
+  int checkRight=(cPos>0);
+  int weekday;
+  if(cPos==-1){
+    checkLeft=(opts[optsIdx]==OPT_LEFT || opts[optsIdx]==OPT_BOTH);
+  }
+  if(cPos==1){
+    checkRight=(opts[optsIdx]==OPT_RIGHT || opts[optsIdx]==OPT_BOTH);
+  }
+  
+  if(cPos!=-1 || cPos!=1 || opts[optsIdx]!=OPT_NONE){
+    //Right Column : add a space BEFORE writing the info
+    if(checkRight){
+      outPrintf(" ");
+      printed++;
+    }
+
+    if(opts[optsIdx]!=OPT_NONE && (cPos==0 || checkLeft || checkRight)){
+      if(optsIdx==OPT_IDX_WKN){
+        printWeekNumber(day, month, year, opts);
+        printed=printed+3;
+      }else if(optsIdx==OPT_IDX_LEFT){
+        printDaysLeft(day, month, year, opts);
+        printed=printed+3;
+      }else if(optsIdx==OPT_IDX_DOY){
+        printDayOfYear(day, month, year, opts);
+        printed=printed+3;
+      }else if(optsIdx==OPT_IDX_WD){
+        weekday=getWeekDay(day, month, year, opts);
+        printWeekDay(weekday, numLetters);
+        printed=printed+numLetters;
+      }else if(optsIdx==OPT_IDX_LYD){
+        outPrintf("%d", isLeapYear(year, opts));
+        printed++; //Only 0 or 1
+      }
+    }
+    
+    //Left Column: Add a space AFTER writing the info
+    if(checkLeft){
+      outPrintf(" ");
+      printed++;
+    }
+  }
+  
+  return printed;
+}
+
+//Render plan : the options resolved once (the informations printed on the
+//left/right of the rows, with their printing function, the headers size,
+//the variants), used by the renderers instead of the options
+typedef void (*InfoKernel)(int day, int month, int year, char* opts);
+
+typedef struct {
+  InfoKernel print;
+  char spaceBefore;
+  char spaceAfter;
+} InfoColumn;
+
+typedef struct {
+  int ready;
+  char opts[OPTS_NB];
+  int nbColumns[2];                             //left, right
+  InfoColumn columns[2][OPTS_IDX_PRINTED+1];
+  int headerSize;
+  int compact;
+  int fixed;
+} RenderPlan;
+
+static RenderPlan renderPlan;
+
+//Print the weekday of a day (2 letters)
+static void printWeekDayInfo(int day, int month, int year, char* opts){
+  printWeekDay(getWeekDay(day, month, year, opts), 2);
+}
+
+//Print the leap year information
+static void printLeapYearInfo(int day, int month, int year, char* opts){
+  (void)day;
+  (void)month;
+  outPrintf("%d", isLeapYear(year, opts));
+}
+
+//Return the render plan of the options (same columns than printInfo)
+static const RenderPlan* getRenderPlan(char* opts){
+  static const InfoKernel kernels[OPTS_IDX_PRINTED+1]={printWeekNumber, 
+    printDayOfYear, printDaysLeft, printWeekDayInfo, printLeapYearInfo};
+  static const int columnsIdx[OPTS_IDX_PRINTED+1]={OPT_IDX_WKN, OPT_IDX_DOY,
+    OPT_IDX_LEFT, OPT_IDX_WD, OPT_IDX_LYD};
+  RenderPlan* plan=&renderPlan;
+  InfoColumn* column;
+  int side, idx, value;
+  
+  if(plan->ready && memcmp(plan->opts, opts, OPTS_NB)==0){
+    return plan;
+  }
+  memcpy(plan->opts, opts, OPTS_NB);
+  for(side=0; side<2; side++){
+    plan->nbColumns[side]=0;
+    for(idx=0; idx<=OPTS_IDX_PRINTED; idx++){
+      value=opts[columnsIdx[idx]];
+      if(value==OPT_BOTH || value==((side==0) ? OPT_LEFT : OPT_RIGHT)){
+        column=&plan->columns[side][plan->nbColumns[side]++];
+        column->print=kernels[idx];
+        column->spaceBefore=(side==1);
+        column->spaceAfter=(side==0);
+      }
+    }
+  }
+  plan->headerSize=computeSizeHeader(opts);
+  plan->compact=(opts[OPT_IDX_COMPACT]==OPT_YES);
+  plan->fixed=(opts[OPT_IDX_FIXED]==OPT_YES);
+  plan->ready=1;
+  return plan;
+}
+
+//Return the number of characters used for headers
+static int getSizeHeader(char* opts){
+  return getRenderPlan(opts)->headerSize;
+}
+
+//print information, depending of opts (cPos=-1 : left, cPos=1 : right)
+static void printInfos(int day, int month, int year, int cPos, char* opts){
+  const RenderPlan* plan=getRenderPlan(opts);
+  const InfoColumn* column=plan->columns[cPos>0];
+  const InfoColumn* end=column+plan->nbColumns[cPos>0];
+  
+  for(; column<end; column++){
+    if(column->spaceBefore){
+      outWrite(" ", 1);
+    }
+    column->print(day, month, year, opts);
+    if(column->spaceAfter){
+      outWrite(" ", 1);
+    }
+  }
+}
+
+//
+static void printDayInfos(int day, int month, int year, int cPos, char* opts){
+  int escapeCol=0;
+  int printResult, feast, period;
+  long long dayNumber;
+  FiscalYear fiscal={0};
+  for(int idx=0; idx<OPTS_IDX_PRINTED; idx++){
+    printResult=printInfo(day, month, year, escapeCol, idx, opts, 0);
+    if(printResult>0){
+      //escape the next col (use checkRight)
+      escapeCol=1;
+    }
+  }
+  //print the Leap Year information
+  printResult=printInfo(day, month, year, escapeCol, OPT_IDX_LYD, opts, 0);
+  //(the full weekday name is not counted)
+  if(printResult>0 || opts[OPT_IDX_WD]!=OPT_NONE){
+    escapeCol=1;
+  }
+  
+  //print the sunrise, sunset and day length
+  if(sunLocation.enabled && day>0){
+    computeSunMonth(month, year, opts, &sunMonths[month]);
+    if(escapeCol){
+      outPrintf(" ");
+    }
+    printSunTime(sunMonths[month].rise[day-1], sunMonths[month].polar[day-1]==0, 1);
+    outPrintf(" ");
+    printSunTime(sunMonths[month].set[day-1], sunMonths[month].polar[day-1]==0, 1);
+    outPrintf(" ");
+    printSunTime(sunMonths[month].length[day-1], 1, 0);
+    escapeCol=1;
+  }
+  
+  //print the number of events
+  if(eventsIndex.enabled && day>0){
+    if(escapeCol){
+      outPrintf(" ");
+    }
+    outPrintf("%d", getDayEvents(getYearEvents(year, opts), day, month, 0));
+    escapeCol=1;
+  }
+  
+  //print the fiscal year, period and week (1st rule)
+  if(nbFiscalRules>0 && day>0){
+    dayNumber=getJulianDayNumber(day, month, year, opts);
+    period=getFiscalPeriod(&fiscalRules[0], dayNumber, opts, &fiscal);
+    outPrintf("%sFY%d P%02d W%02d", (escapeCol) ? " " : "", fiscal.year, period+1,
+              (int)((dayNumber-fiscal.start)/7)+1);
+    escapeCol=1;
+  }
+  
+  //print the moveable feast
+  feast=(feastsEnabled && day>0) ? getDayFeast(day, month, year, opts) : -1;
+  if(feast>=0){
+    outPrintf("%s%s", (escapeCol) ? " " : "", feasts[feast].name);
+    escapeCol=1;
+  }
+  
+  //print today and the new offset of the zone (at the end of the day)
+  if(currentZone!=NULL && day>0 && year>0){
+    dayNumber=getJulianDayNumber(day, month, year, opts);
+    if(dayNumber==zoneToday){
+      outPrintf("%sToday", (escapeCol) ? " " : "");
+      escapeCol=1;
+    }
+    if(isZoneChangeDay(currentZone, dayNumber)){
+      ZoneOffset zoneOffset=getZoneOffset(currentZone, getZoneDayStart(currentZone, 
+                                                                       dayNumber+1));
+      int minutes=(zoneOffset.offset<0) ? -zoneOffset.offset/60 : zoneOffset.offset/60;
+      
+      outPrintf("%s%.*s UTC%c%02d:%02d", (escapeCol) ? " " : "", (int)zoneOffset.abbrSize,
+                zoneOffset.abbr, (zoneOffset.offset<0) ? '-' : '+', minutes/60, minutes%60);
+    }
+  }
+}
+
+//print a Grid calendar
+//- use a full-week/line print technique, NEEDED for printing multiples cols
+//for 1 month print, the linear approach is better :
+//     (print all days, add an endline when last day of the week)
+static void printGCal(int monthStart, int monthEnd, int year, char* opts){
+  const RenderPlan* plan=getRenderPlan(opts);
+
+  int month;
+  int weekday;        //0-7 : sunday to saturday
+  int dayCount;     //increment to print all days
+  int firstWD=opts[OPT_IDX_FIRSTWD]-'0';
+  int monthsToPrint=opts[OPT_IDX_NBCOL]-'A'; //nb of month to print
+  int printedMonth;
+  int lastMonthToPrint;
+  int rowSize;
+  int numberWeeksMonth, numberWeeksToPrint;
+  int weekRow, weekInMonth, emptyWeek;
+  int skipWeeks[12];
+  GridCell* row;
+  GridCell* lastCell;
+  YearLayout* layout=getYearLayout(year, opts);
+  YearEvents* events=(eventsIndex.enabled) ? getYearEvents(year, opts) : NULL;
+  char mark;
+  
+  //Header : for multiples months, print the year in 1st line
+  if(monthsToPrint>1){
+    outPrintf("%d:%s", year, endLine);
+    rowSize=(7*3-1)+getSizeHeader(opts)+2+eventsIndex.enabled;
+  }else{
+    rowSize=0;
+  }
+  
+  //Print all months
+  for(month=monthStart; month<=monthEnd; month=month+monthsToPrint){
+    
+    //Check the last month to print
+    if(month+monthsToPrint>DECEMBER){
+      lastMonthToPrint=DECEMBER+1;
+    }else{
+      lastMonthToPrint=month+monthsToPrint;
+    }
+    
+    //HEADER : if not compact view : print the full Month name
+    if(!plan->compact){
+      //Do for each print month
+      for(printedMonth=month; printedMonth<lastMonthToPrint; printedMonth++){
+        printMonthName(printedMonth, rowSize);
+      }
+    }
+      
+    //HEADERS
+    if(month==monthStart || !plan->compact){
+
+      if(monthsToPrint==1){
+        //print the year
+        outPrintf(" %d:", year);
+      }
+      
+      //Escape the line (months)
+      outPrintf("%s", endLine);
+      
+      //Compact views : print a month column
+      if(plan->compact){
+        printHeader(OPT_IDX_MONTH, -2, opts);
+      }
+      
+      //Do for each print month
+      for(printedMonth=month; printedMonth<lastMonthToPrint; printedMonth++){
+        //print Left HEADER columns
+        printHeaders(-1, opts);
+
+        //HEADER : Day names
+        weekday=firstWD;
+        
+        for(dayCount=0; dayCount<7; dayCount++){
+          //print the day names (short : 2 characters)
+          printWeekDayName(weekday, 2);
+          //Add a space between days
+          if(dayCount<6){
+            outPrintf(" ");
+          }
+          //Go to the next day and increment the number days
+          weekday=changeWeekDay(weekday, 1);
+        }
+        //Escape the events mark of the last day
+        if(eventsIndex.enabled){
+          outPrintf(" ");
+        }
+        
+        //HEADER : right columns
+        printHeaders(1, opts);
+        
+        if(printedMonth<lastMonthToPrint-1){
+          //escape months
+          outPrintf("  ");
+        }
+      }
+      
+      //HEADER : END 
+      outPrintf("%s", endLine);
+    }
+    
+    //Found the number of weeks (= lines) to print
+    //Compact view : the 1st week is already printed with the previous month
+    numberWeeksToPrint=0;
+    for(printedMonth=month; printedMonth<lastMonthToPrint; printedMonth++){
+      skipWeeks[printedMonth]=(plan->compact && printedMonth!=monthStart 
+                               && layout->offset[printedMonth]>0);
+      numberWeeksMonth=layout->nbWeeks[printedMonth]-skipWeeks[printedMonth];
+      if(numberWeeksToPrint<numberWeeksMonth){
+        numberWeeksToPrint=numberWeeksMonth;
+      }
+    }
+    
+    //Printing each weeks (=lines)
+    for(weekRow=0; weekRow<numberWeeksToPrint; weekRow++){
+    
+      //Do for each print month
+      for(printedMonth=month; printedMonth<lastMonthToPrint; printedMonth++){
+        weekInMonth=weekRow+skipWeeks[printedMonth];
+        row=layout->cells[printedMonth][weekInMonth];
+        lastCell=&row[6];
+        //Set empty week, if week printed exceed number of week month
+        emptyWeek=(weekInMonth>=layout->nbWeeks[printedMonth]);
+        
+        if(plan->compact){
+          if(!emptyWeek && weekInMonth==0){
+            //Print month name
+            printMonthName(printedMonth, 3);
+          }else if(!emptyWeek && !lastCell->inMonth){
+            //Print the NEXT month name (compact)
+            printMonthName(lastCell->month, 3);
+          }else{
+            //Escape the month (same)
+            outPrintf("   ");
+          }
+          outPrintf(" ");
+        }
+        
+        //print the left columns (1st day of the month in the row)
+        if(emptyWeek){
+          printInfos(-1, printedMonth, year, -1, opts);
+        }else{
+          printInfos(getFirstDayRow(row), printedMonth, year, -1, opts);
+        }
+
+        //Print the 7 days
+        for(dayCount=0; dayCount<7; dayCount++){
+          mark=' ';
+          if(!emptyWeek && (row[dayCount].inMonth || plan->compact)){
+            //Print the day (compact : also the days of previous/next month)
+            printDayNumber(row[dayCount].day, 2, ' ');
+            if(events!=NULL && getDayEvents(events, row[dayCount].day, 
+                                  row[dayCount].month, row[dayCount].yearShift)>0){
+              mark=EVENTS_MARK;
+            }
+          }else{
+            //Escape the day number
+            outPrintf("  ");
+          }
+           
+          //Add a space between day numbers (or the events mark)
+          if(dayCount<6 || events!=NULL){
+            outWrite(&mark, 1);
+          }
+        }
+        
+        //Print right columns (last day of the row)
+        if(emptyWeek){
+          printInfos(-1, printedMonth, year, 1, opts);
+        }else{
+          printInfos(lastCell->day, lastCell->month, year+lastCell->yearShift, 1, opts);
+        }
+        
+        if(printedMonth==lastMonthToPrint-1){
+          //End of the line
+          outPrintf("%s", endLine);
+        }else{
+          //Escape months
+          outPrintf("  ");
+        }
+      }
+    }
+    
+    if(lastMonthToPrint<=DECEMBER && !plan->compact){
+      //Print a line separator between group of months
+      outPrintf("%s", endLine);
+    }
+  }
+}
+
+//print a Linear calendar (=purely Horizontal)
+static void printHCal(int monthStart, int monthEnd, int year, char* opts){
+  const RenderPlan* plan=getRenderPlan(opts);
+
+  int day;      //1-31, the day of the month
+  int month, lastMonthToPrint;
+  int weekday;        //0-7 : sunday to saturday
+  int dayCount;   //increment to print all days
+  int dayMaxToPrint, dayMaxMonth, dayPosition;
+  int firstWDMonth;   //get 1st day 
+  int daysInMonth;
+  int firstWD=opts[OPT_IDX_FIRSTWD]-'0';
+  int monthsToPrint=opts[OPT_IDX_NBCOL]-'A'; //nb of month to print
+  int offset;
+  YearEvents* events=(eventsIndex.enabled) ? getYearEvents(year, opts) : NULL;
+  char mark;
+  
+  //Check the last month to print
+  if(monthStart+monthsToPrint>DECEMBER){
+    lastMonthToPrint=DECEMBER+1;
+  }else{
+    lastMonthToPrint=monthStart+monthsToPrint;
+  }
+  
+  //Calculate the number of days to print 
+  dayMaxToPrint=0;
+  //Print all the months
+  for(month=monthStart; month<lastMonthToPrint; month++){
+    //Calculate the offset of the first Week
+    offset=getOffsetMonth(1, month, year, opts);
+
+    //Calculate the maximum of days to print
+    dayMaxMonth=0;
+    //If not a full week for the 1st week, add 1 week
+    if(offset>0){
+      dayMaxMonth=7;
+    }
+    //Remove the offset
+    dayMaxMonth=dayMaxMonth+getDaysPerMonth(month, year, opts)-offset;
+    
+    if(dayMaxToPrint<dayMaxMonth){
+      dayMaxToPrint=dayMaxMonth;
+    }
+  }
+  
+  //Print all the months
+  for(month=monthStart; month<lastMonthToPrint; month++){
+
+    //set values
+    day=1;
+    daysInMonth=getDaysPerMonth(month, year, opts);
+    firstWDMonth=getFirstWDMonth(month, year, opts);
+
+    //HEADER : if not compact view : print the Month name
+    if(!plan->compact){
+      printMonthName(month, 0);
+      outPrintf(" ");
+    }
+      
+    //HEADERS
+    if(month==monthStart || !plan->compact){
+
+      //print the year
+      outPrintf("%d:%s", year, endLine);
+      
+      //Compact views : print a month column
+      if(plan->compact){
+        printHeader(OPT_IDX_MONTH, -2, opts);
+      }
+      
+      //print Left HEADER columns
+      printHeaders(-1, opts);
+
+      //HEADER : print weekDay names
+      if(plan->fixed){
+        //Restart with the 1st day of week
+        weekday=firstWD;
+      }else{
+        //print only the days in the month
+        dayMaxToPrint=daysInMonth;
+        //start with the 1st WD of the month
+        weekday=firstWDMonth;
+      }
+      
+      for(dayCount=0; dayCount<dayMaxToPrint; dayCount++){
+        //print the day names (short : 2 characters)
+        printWeekDayName(weekday, 2);
+        //Add a space between days
+        if(dayCount<dayMaxToPrint-1){
+          outPrintf(" ");
+        }
+        //Go to the next day
+        weekday=changeWeekDay(weekday, 1);
+      }
+      //Escape the events mark of the last day
+      if(events!=NULL){
+        outPrintf(" ");
+      }
+      
+      //HEADER : right columns
+      printHeaders(1, opts);
+      
+      //HEADER : END
+      outPrintf("%s", endLine);
+    }
+    
+    //reset dayPosition
+    dayPosition=0;
+    //Reset the weekday depending on Fixed mode
+    if(plan->fixed){
+      weekday=firstWD;
+    }else{
+      weekday=firstWDMonth;
+    }
+
+    if(plan->compact && dayPosition==0 && day==1){
+        //Print month name (compact, 1st day)
+        printMonthName(month, 3);
+        outPrintf(" ");
+    }
+    
+    //print the left columns
+    printInfos(day, month, year, -1, opts);
+
+    //Escape the 1st missing days before the 1st day printed
+    while(firstWDMonth!=weekday){
+      //add spaces
+      outPrintf("   ");
+      
+      dayPosition++;
+      weekday=changeWeekDay(weekday, 1);
+    }
+
+    //Main loop : print days
+    while(day<=daysInMonth){
+
+      //Print the day
+      printDayNumber(day, 2, ' ');
+      mark=' ';
+      if(events!=NULL && getDayEvents(events, day, month, 0)>0){
+        mark=EVENTS_MARK;
+      }
+      
+      //increment values
+      day++;
+      dayPosition++;
+      weekday=changeWeekDay(weekday, 1);
+      
+      //add a space between days printed (or the events mark)
+      if(dayPosition<dayMaxToPrint || events!=NULL){
+        outWrite(&mark, 1);
+      }
+    }
+      
+    //Add spaces after the last day printed, to finish the line
+    while(dayPosition<dayMaxToPrint){
+      outPrintf("  "); //an empty day number
+      dayPosition++;
+      weekday=changeWeekDay(weekday, 1);
+
+      if(dayPosition<dayMaxToPrint || events!=NULL){
+        //add a space between day numbers
+        outPrintf(" ");
+      }
+    }
+      
+    //print the right columns
+    printInfos(daysInMonth, month, year, 1, opts);
+    
+    //End the line
+    outPrintf("%s", endLine);
+    
+    if(!plan->compact 
+        && monthStart!=lastMonthToPrint && month!=lastMonthToPrint){
+      //Print a line separator between months
+      outPrintf("%s", endLine);
+    }
+  }
+}
+
+//print a column (or vertical) calendar 
+static void printVCal(int monthStart, int monthEnd, int year, char* opts){
+  const RenderPlan* plan=getRenderPlan(opts);
+  int month;
+  int day, dayPrinted;
+  int weekNumber;
+  int firstWD=opts[OPT_IDX_FIRSTWD]-'0';
+  int weekday, weekdayRow;
+  int offset;
+  int dayMaxToPrint,dayMaxMonth,  daysForPrintedMonth;
+  int monthsToPrint=opts[OPT_IDX_NBCOL]-'A'; //nb of month to print
+  int printedMonth;
+  int lastMonthToPrint;
+  int rowSize;  //for month printing
+  YearLayout* layout=getYearLayout(year, opts);
+  YearEvents* events=(eventsIndex.enabled) ? getYearEvents(year, opts) : NULL;
+  
+  //Check the WD columns in fixed mode.
+  int checkFixedOpt, tmpCheck;
+  checkFixedOpt=(plan->fixed);
+  tmpCheck=(opts[OPT_IDX_WD]==(OPT_BOTH-'a'+'A'));
+  int checkBothFixedWD=(checkFixedOpt && tmpCheck);
+  tmpCheck=(checkFixedOpt && opts[OPT_IDX_WD]==(OPT_LEFT-'a'+'A'));
+  int checkFixedWDLeft=(checkBothFixedWD || tmpCheck);
+  tmpCheck=(checkFixedOpt && opts[OPT_IDX_WD]==(OPT_RIGHT-'a'+'A'));
+  int checkFixedWDRight=(checkBothFixedWD || tmpCheck);
+  
+  //Header : for multiples months, print the year in 1st line
+  if(monthsToPrint>1){
+    outPrintf("%d:%s", year, endLine);
+  }
+  
+  //Print all months
+  for(month=monthStart; month<=monthEnd; month=month+monthsToPrint){
+    day=1;
+    
+    //Check the last month to print
+    if(month+monthsToPrint>DECEMBER){
+      lastMonthToPrint=DECEMBER+1;
+    }else{
+      lastMonthToPrint=month+monthsToPrint;
+    }
+    
+    //Check the number of days to print
+    if(plan->fixed){
+      //Calculate the number of days to print 
+      dayMaxToPrint=0;
+      //Print all the months
+      for(printedMonth=month; printedMonth<lastMonthToPrint; printedMonth++){
+        //Calculate the offset of the first Week
+        offset=getOffsetMonth(1, printedMonth, year, opts);
+
+        //If not a full week for the 1st week, add 1 week
+        if(offset>0){
+          dayMaxMonth=7;
+        }else{
+          dayMaxMonth=0;
+        }
+        //Add days of the months
+        dayMaxMonth=dayMaxMonth+getDaysPerMonth(printedMonth, year, opts);
+        //Remove the offset
+        dayMaxMonth=dayMaxMonth-offset;
+        
+        if(dayMaxToPrint<dayMaxMonth){
+          dayMaxToPrint=dayMaxMonth;
+        }
+      }
+      weekdayRow=firstWD;
+    }else if(monthsToPrint>1){
+      dayMaxToPrint=31;
+    }else{
+      dayMaxToPrint=getDaysPerMonth(month, year, opts);
+    }
+    
+    if(monthsToPrint>1){
+      rowSize=2+getSizeHeader(opts);
+      if(sunLocation.enabled){
+        rowSize=rowSize+SUN_COLUMNS_SIZE;
+      }
+      if(eventsIndex.enabled){
+        rowSize=rowSize+EVENTS_COLUMNS_SIZE;
+      }
+    }else{
+      rowSize=0;
+    }
+    
+    //Sunrise/sunset of the months printed
+    if(sunLocation.enabled){
+      for(printedMonth=month; printedMonth<lastMonthToPrint; printedMonth++){
+        computeSunMonth(printedMonth, year, opts, &sunMonths[printedMonth]);
+      }
+    }
+    
+    
+    //Print HEADER for subset months
+    for(printedMonth=month; printedMonth<lastMonthToPrint; printedMonth++){
+      
+      //header : Escape the weekday name
+      if(monthsToPrint>1 && printedMonth==month && checkFixedWDLeft){
+        outPrintf("   ");
+      }
+      
+      //HEADER : print Month(s)
+      printMonthName(printedMonth, rowSize);
+      if(monthsToPrint==1){
+        //Print the year, next to the month (if not multiple months)
+        outPrintf(" %d:", year);
+      }else{
+        //escape months
+        if(printedMonth<(lastMonthToPrint-1)){
+          outPrintf("  ");
+        }
+      }
+      
+      //header : Escape the weekday name
+      if(printedMonth==(lastMonthToPrint-1) && checkFixedWDRight){
+        outPrintf("   ");
+      }
+    }
+    //HEADER (months) : End the line
+    outPrintf("%s", endLine);
+
+   
+    //Print Headers for current month(s)
+    for(printedMonth=month; printedMonth<lastMonthToPrint; printedMonth++){
+      
+      if(printedMonth==month && checkFixedWDLeft){
+        //force-print the weekday name
+        printHeader(OPT_IDX_WD, -2, opts);
+      }
+      
+      //Header : print left columns
+      printHeaders(-1, opts);
+      //HEADER : force-print the day number (centered)
+      printHeader(OPT_IDX_DN, 0, opts);
+      //HEADER : right columns
+      printHeaders(1, opts);
+      if(sunLocation.enabled){
+        outPrintf("  Rise   Set   Day");
+      }
+      if(eventsIndex.enabled){
+        outPrintf("  Ev");
+      }
+      
+
+      if(printedMonth==lastMonthToPrint-1){
+        if(checkFixedWDRight){
+          //force-print the weekday name
+          printHeader(OPT_IDX_WD, 2, opts);
+        }
+      }else{
+        if(monthsToPrint>1){
+          //Print space between multiples  months
+          outPrintf("  ");
+        }
+      }
+    }
+    //HEADER : ENDline
+    outPrintf("%s", endLine);
+
+    //Main loop : print days
+    while(day<=dayMaxToPrint){
+      
+      if(checkFixedWDLeft){
+        //print the day names (short : 2 characters) at left
+        printWeekDayName(weekdayRow, 2);
+        outPrintf(" ");
+      }
+    
+      //Do for each print month
+      for(printedMonth=month; printedMonth<lastMonthToPrint; printedMonth++){
+      
+        //check the number of days for the printed month
+        daysForPrintedMonth=layout->daysInMonth[printedMonth];
+
+        //check the correct day number to print
+        if(plan->fixed){
+          //Subtract the daysOnset
+          dayPrinted=day-layout->offset[printedMonth];
+        }else{
+          dayPrinted=day;
+        }
+        
+        //Check value of the dayPrinted
+        if(dayPrinted<0 || dayPrinted>daysForPrintedMonth){
+          dayPrinted=0;
+        }
+        
+        // Calculate the 1st day of the printed month...
+        weekday=layout->firstWDMonth[printedMonth];
+
+        //Found the WeekDay by adding the number of days passed
+        weekday=changeWeekDay(weekday, dayPrinted-1);
+      
+        //PRINT INFO (ON THE LEFT)
+        if(dayPrinted>0 && (weekday==firstWD || (dayPrinted==1 && monthsToPrint==1))){
+          //A new week : Print the week number
+          printInfo(dayPrinted, printedMonth, year, -1, OPT_IDX_WKN, opts, 0);
+        }else{
+          //Not a new week, escape the week number (day=0)
+          printInfo(0, printedMonth, year, -1, OPT_IDX_WKN, opts, 0);
+        }
+        printInfo(dayPrinted, printedMonth, year, -1, OPT_IDX_LEFT, opts, 0);
+        printInfo(dayPrinted, printedMonth, year, -1, OPT_IDX_DOY, opts, 0);
+        if(dayPrinted>0 && dayPrinted<=dayMaxToPrint){
+          //Print Weekday name (before the Day number)
+          printInfo(dayPrinted, printedMonth, year, -1, OPT_IDX_WD, opts, 2);
+        }else{
+          //Escape the weekday name
+          printInfo(-1, printedMonth, year, -1, OPT_IDX_WD, opts, 2);
+        }
+
+
+        //Print the day number
+        if(dayPrinted>0 && dayPrinted<=dayMaxToPrint){
+          printDayNumber(dayPrinted, 2, ' ');
+        }else{
+          outPrintf("  ");
+        }
+        
+        //PRINT INFO (ON THE RIGHT)
+        if(dayPrinted>0 && dayPrinted<=dayMaxToPrint){
+          //Print the Weekday name (after the day number)
+          printInfo(weekday, printedMonth, year, 1, OPT_IDX_WD, opts, 2);
+        }else{
+          //Escape the weekday name
+          printInfo(-1, printedMonth, year, 1, OPT_IDX_WD, opts, 2);
+        }
+        if(dayPrinted>0 && weekday==firstWD){
+          //A new week, print the number
+          printInfo(dayPrinted, printedMonth, year, 1, OPT_IDX_WKN, opts, 0);
+        }else{
+          //Not a new week, escape the week number (day=0) -RIGHT column-
+          printInfo(0, printedMonth, year, 1, OPT_IDX_WKN, opts, 0);
+        }
+        printInfo(dayPrinted, printedMonth, year, 1, OPT_IDX_LEFT, opts, 0);
+        printInfo(dayPrinted, printedMonth, year, 1, OPT_IDX_DOY, opts, 0);
+        if(sunLocation.enabled){
+          printSunInfos(&sunMonths[printedMonth], dayPrinted);
+        }
+        if(events!=NULL){
+          printEventsInfo(events, dayPrinted, printedMonth);
+        }
+        
+
+        if(printedMonth==lastMonthToPrint-1){
+          if(checkFixedWDRight){
+            //print the day names (short : 2 characters)
+            printInfo(dayPrinted, printedMonth, year, 1, OPT_IDX_WD, opts, 2);
+          }
+        }else{
+          if(monthsToPrint>1){
+            //Escape the months
+            outPrintf("  ");
+          }
+        }
+      }
+      
+      //Increment values
+      day++;
+      weekdayRow=changeWeekDay(weekdayRow, 1);
+
+      if(day<=dayMaxToPrint){
+        //End of the line
+        outPrintf("%s", endLine);
+      }
+    }
+    
+    //End the line
+    outPrintf("%s", endLine);
+    
+    if(printedMonth<=monthEnd){
+      //Add another newline for multiples months
+      outPrintf("%s", endLine);
+    }
+  }
+}
+
+//Set a date in the correct month/year, if day is out of the month
+static void normalizeDate(int* day, int* month, int* year, char* opts){
+  int daysInMonth;
+  
+  //Before the 1st day : go to the previous month(s)
+  while(*day<1){
+    if(*month==JANUARY){
+      *year=*year-1;
+    }
+    *month=changeMonth(*month, -1);
+    *day=*day+getDaysPerMonth(*month, *year, opts);
+  }
+  
+  //After the last day : go to the next month(s)
+  daysInMonth=getDaysPerMonth(*month, *year, opts);
+  while(*day>daysInMonth){
+    *day=*day-daysInMonth;
+    if(*month==DECEMBER){
+      *year=*year+1;
+    }
+    *month=changeMonth(*month, 1);
+    daysInMonth=getDaysPerMonth(*month, *year, opts);
+  }
+}
+
+//Return the day printed in a cell of the month grid (the same layout
+//than printGCal) : day<1 or day>daysInMonth if not in the month
+static int getGridDay(int weekInMonth, int dayCount, int offset){
+  return 1+(7*(weekInMonth-1))+dayCount-offset;
+}
+
+//Print a line of a Markdown (grid) table : "+---+--+--+...+"
+static void printMdBorder(char border, int withWeekNumber, int mergedDays){
+  int dayCount;
+  
+  outStr("+");
+  if(withWeekNumber){
+    for(dayCount=0; dayCount<3; dayCount++){
+      outWrite(&border, 1);
+    }
+    outStr("+");
+  }
+  for(dayCount=0; dayCount<7; dayCount++){
+    outWrite(&border, 1);
+    outWrite(&border, 1);
+    //Merged days : only 1 cell (for the month name)
+    if(dayCount<6 && mergedDays){
+      outWrite(&border, 1);
+    }else{
+      outStr("+");
+    }
+  }
+  outStr(endLine);
+}
+
+//print a Markdown (grid table) calendar, 1 table per month
+static void printMdCal(int monthStart, int monthEnd, int year, char* opts){
+  int month, weekInMonth, dayCount;
+  int day, daysInMonth, offset, numberWeeksMonth;
+  int weekday;
+  int firstWD=opts[OPT_IDX_FIRSTWD]-'0';
+  int withWeekNumber=(opts[OPT_IDX_WKN]!=OPT_NONE);
+  
+  for(month=monthStart; month<=monthEnd; month++){
+    daysInMonth=getDaysPerMonth(month, year, opts);
+    offset=getOffsetMonth(-1, month, year, opts);
+    numberWeeksMonth=getNumberWeeksMonth(month, year, opts);
+    
+    //HEADER : the month name
+    printMdBorder('-', withWeekNumber, 1);
+    outStr("|");
+    if(withWeekNumber){
+      outStr("   |");
+    }
+    printMonthName(month, 7*3-1);
+    outStr("|");
+    outStr(endLine);
+    printMdBorder('-', withWeekNumber, 0);
+    
+    //HEADER : day names
+    outStr("|");
+    if(withWeekNumber){
+      outStr(headerStr[OPT_IDX_WKN]);
+      outStr("|");
+    }
+    weekday=firstWD;
+    for(dayCount=0; dayCount<7; dayCount++){
+      printWeekDayName(weekday, 2);
+      outStr("|");
+      weekday=changeWeekDay(weekday, 1);
+    }
+    outStr(endLine);
+    printMdBorder('=', withWeekNumber, 0);
+    
+    //Weeks
+    for(weekInMonth=1; weekInMonth<=numberWeeksMonth; weekInMonth++){
+      outStr("|");
+      if(withWeekNumber){
+        day=getGridDay(weekInMonth, 0, offset);
+        if(day<1){
+          day=1;
+        }
+        printWeekNumber(day, month, year, opts);
+        outStr("|");
+      }
+      for(dayCount=0; dayCount<7; dayCount++){
+        day=getGridDay(weekInMonth, dayCount, offset);
+        if(day>0 && day<=daysInMonth){
+          printDayNumber(day, 2, ' ');
+        }else{
+          outStr("  ");
+        }
+        outStr("|");
+      }
+      outStr(endLine);
+      printMdBorder('-', withWeekNumber, 0);
+    }
+    
+    //Same separator than the grid view
+    if(month<DECEMBER){
+      outStr(endLine);
+    }
+  }
+}
+
+//print a JSON calendar : months, with weeks (null : not in the month)
+static void printJsonCal(int monthStart, int monthEnd, int year, char* opts){
+  int month, weekInMonth, dayCount;
+  int day, daysInMonth, offset, numberWeeksMonth;
+  int firstWD=opts[OPT_IDX_FIRSTWD]-'0';
+  
+  outPrintf("{\"year\": %d, \"leapYear\": %s, \"firstWeekDay\": \"%s\", \"months\": [",
+            year, (isLeapYear(year, opts) ? "true" : "false"), weekdays[firstWD]);
+  
+  for(month=monthStart; month<=monthEnd; month++){
+    daysInMonth=getDaysPerMonth(month, year, opts);
+    offset=getOffsetMonth(-1, month, year, opts);
+    numberWeeksMonth=getNumberWeeksMonth(month, year, opts);
+    
+    outPrintf("%s  {\"month\": %d, \"name\": \"%s\", \"days\": %d, \"weeks\": [",
+              endLine, month+1, months[month], daysInMonth);
+    
+    for(weekInMonth=1; weekInMonth<=numberWeeksMonth; weekInMonth++){
+      day=getGridDay(weekInMonth, 0, offset);
+      if(day<1){
+        day=1;
+      }
+      outPrintf("%s    {\"week\": %d, \"days\": [", 
+                endLine, getWeekNumber(day, month, year, opts));
+      
+      for(dayCount=0; dayCount<7; dayCount++){
+        day=getGridDay(weekInMonth, dayCount, offset);
+        if(day>0 && day<=daysInMonth){
+          outPrintf("%d", day);
+        }else{
+          outStr("null");
+        }
+        if(dayCount<6){
+          outStr(", ");
+        }
+      }
+      outStr("]}");
+      if(weekInMonth<numberWeeksMonth){
+        outStr(",");
+      }
+    }
+    outPrintf("%s  ]}", endLine);
+    if(month<monthEnd){
+      outStr(",");
+    }
+  }
+  outPrintf("%s]}%s", endLine, endLine);
+}
+
+//print a CSV calendar : 1 line per day
+static void printCsvCal(int monthStart, int monthEnd, int year, char* opts){
+  int month, day, daysInMonth;
+  int weekday, dayOfYear;
+  int daysInYear=getDaysInfYear(year, opts);
+  
+  outPrintf("year,month,day,weekday,week,dayOfYear,daysLeft");
+  if(sunLocation.enabled){
+    outPrintf(",sunrise,sunset,dayLength");
+  }
+  outPrintf("%s", endLine);
+  for(month=monthStart; month<=monthEnd; month++){
+    daysInMonth=getDaysPerMonth(month, year, opts);
+    weekday=getFirstWDMonth(month, year, opts);
+    dayOfYear=getDayOfYear(0, month, year, opts);
+    if(sunLocation.enabled){
+      computeSunMonth(month, year, opts, &sunMonths[month]);
+    }
+    
+    for(day=1; day<=daysInMonth; day++){
+      dayOfYear++;
+      outPrintf("%d,%d,%d,%s,%d,%d,%d", year, month+1, day, weekdays[weekday],
+                getWeekNumber(day, month, year, opts), dayOfYear, 
+                daysInYear-dayOfYear);
+      if(sunLocation.enabled){
+        outPrintf(",");
+        printSunTime(sunMonths[month].rise[day-1], sunMonths[month].polar[day-1]==0, 1);
+        outPrintf(",");
+        printSunTime(sunMonths[month].set[day-1], sunMonths[month].polar[day-1]==0, 1);
+        outPrintf(",");
+        printSunTime(sunMonths[month].length[day-1], 1, 0);
+      }
+      outPrintf("%s", endLine);
+      weekday=changeWeekDay(weekday, 1);
+    }
+  }
+}
+
+//print an iCalendar date (YYYYMMDD), for a day maybe out of the month
+static void printIcsDate(const char* name, int day, int month, int year, char* opts){
+  normalizeDate(&day, &month, &year, opts);
+  outPrintf("%s;VALUE=DATE:%04d%02d%02d%s", name, year, month+1, day, icsEndLine);
+}
+
+//print an iCalendar all-day event
+static void printIcsEvent(const char* uid, const char* summary, int day, 
+                          int month, int year, int nbDays, char* opts){
+  int stampDay=day, stampMonth=month, stampYear=year;
+  
+  normalizeDate(&stampDay, &stampMonth, &stampYear, opts);
+  outPrintf("BEGIN:VEVENT%s", icsEndLine);
+  outPrintf("UID:%s-%04d%02d%02d@humancommons%s", uid, stampYear, stampMonth+1, 
+            stampDay, icsEndLine);
+  outPrintf("DTSTAMP:%04d%02d%02dT000000Z%s", stampYear, stampMonth+1, stampDay, 
+            icsEndLine);
+  printIcsDate("DTSTART", day, month, year, opts);
+  printIcsDate("DTEND", day+nbDays, month, year, opts);
+  outPrintf("SUMMARY:%s%s", summary, icsEndLine);
+  outPrintf("TRANSP:TRANSPARENT%s", icsEndLine);
+  outPrintf("END:VEVENT%s", icsEndLine);
+}
+
+//print an iCalendar : 1 event per month, 1 event per week
+static void printIcsCal(int monthStart, int monthEnd, int year, char* opts){
+  int month, weekInMonth;
+  int day, offset, numberWeeksMonth, weekNumber;
+  char summary[40];
+  
+  outPrintf("BEGIN:VCALENDAR%s", icsEndLine);
+  outPrintf("VERSION:2.0%s", icsEndLine);
+  outPrintf("PRODID:-//HumanCommonsSpaceTime//calendar//EN%s", icsEndLine);
+  
+  for(month=monthStart; month<=monthEnd; month++){
+    offset=getOffsetMonth(-1, month, year, opts);
+    numberWeeksMonth=getNumberWeeksMonth(month, year, opts);
+    
+    //The month
+    snprintf(summary, sizeof(summary), "%s %d", months[month], year);
+    printIcsEvent("month", summary, 1, month, year, 
+                  getDaysPerMonth(month, year, opts), opts);
+    
+    //The weeks (a week starting in the previous month is already done)
+    for(weekInMonth=1; weekInMonth<=numberWeeksMonth; weekInMonth++){
+      day=getGridDay(weekInMonth, 0, offset);
+      if(day<1 && month!=monthStart){
+        continue;
+      }
+      if(day<1){
+        weekNumber=getWeekNumber(1, month, year, opts);
+      }else{
+        weekNumber=getWeekNumber(day, month, year, opts);
+      }
+      snprintf(summary, sizeof(summary), "Week %02d", weekNumber);
+      printIcsEvent("week", summary, day, month, year, 7, opts);
+    }
+  }
+  
+  outPrintf("END:VCALENDAR%s", icsEndLine);
+}
+
+//print a calendar in a structured format (markdown, json, csv, icalendar)
+static void printFormatCal(int monthStart, int monthEnd, int year, char* opts){
+  if(opts[OPT_IDX_FORMAT]==OPT_FORMAT_MD){
+    printMdCal(monthStart, monthEnd, year, opts);
+  }else if(opts[OPT_IDX_FORMAT]==OPT_FORMAT_JSON){
+    printJsonCal(monthStart, monthEnd, year, opts);
+  }else if(opts[OPT_IDX_FORMAT]==OPT_FORMAT_CSV){
+    printCsvCal(monthStart, monthEnd, year, opts);
+  }else if(opts[OPT_IDX_FORMAT]==OPT_FORMAT_ICS){
+    printIcsCal(monthStart, monthEnd, year, opts);
+  }
+}
+
+//print a cal 
+static void printCal(int monthStart, int monthEnd, int year, char* opts){
+  STATS_START(cycles);
+  if(opts[OPT_IDX_FORMAT]!=OPT_FORMAT_TEXT){
+    printFormatCal(monthStart, monthEnd, year, opts);
+    STATS_STOP(STAT_IDX_CYCLES_FORMAT, cycles);
+  }else if(opts[OPT_IDX_VIEW]==OPT_VIEW_VERTICAL){
+    printVCal(monthStart, monthEnd, year, opts);
+    STATS_STOP(STAT_IDX_CYCLES_VERTICAL, cycles);
+  }else if(opts[OPT_IDX_VIEW]==OPT_VIEW_GRID){
+    printGCal(monthStart, monthEnd, year, opts);
+    STATS_STOP(STAT_IDX_CYCLES_GRID, cycles);
+  }else if(opts[OPT_IDX_VIEW]==OPT_VIEW_LINEAR){
+    printHCal(monthStart, monthEnd, year, opts);
+    STATS_STOP(STAT_IDX_CYCLES_LINEAR, cycles);
+  }
+}
+
+//Posters of several years (-poster <from> <to>), streamed line by line :
+//only the line printed is computed, whatever the number of years
+//- grid view : a line by week, the years one after the other, in -col 
+//  columns side by side (each column continues the previous one)
+//- linear view : a line by year, the 12 months side by side (the days 
+//  aligned on the weekdays, like the fixed linear view)
+#define POSTER_LINEAR_SLOTS 37    //6 days of offset + 31 days
+
+//Print a day number of 2 characters (0 : an empty cell)
+static void printPosterDay(int day){
+  char cell[2];
+  
+  cell[0]=(day>=10) ? (char)('0'+day/10) : ' ';
+  cell[1]=(day>0) ? (char)('0'+day%10) : ' ';
+  outWrite(cell, 2);
+}
+
+//Return the width of the year labels (4 digits or more)
+static int getPosterYearWidth(int yearTo){
+  int width=1;
+  
+  for(; yearTo>=10; yearTo=yearTo/10){
+    width++;
+  }
+  return (width<4) ? 4 : width;
+}
+
+//Print the weekday names of a week (2 characters)
+static void printPosterWeekDays(int firstWD){
+  int idx;
+  
+  for(idx=0; idx<7; idx++){
+    printWeekDayName(changeWeekDay(firstWD, idx), 2);
+    if(idx<6){
+      outWrite(" ", 1);
+    }
+  }
+}
+
+//Print nbWeeks weeks from the day number start (a 1st weekday), in 
+//nbColumns columns : each line is computed from its day numbers only
+static void printPosterWeeks(long long start, long long nbWeeks, int nbColumns,
+                             int yearWidth, char* opts){
+  int firstWD=opts[OPT_IDX_FIRSTWD]-'0';
+  int column, idx, labelIdx;
+  int dayOf[7], monthOf[7], yearOf[7];
+  long long nbRows=(nbWeeks+nbColumns-1)/nbColumns;
+  long long row, week;
+  
+  //Header of each column
+  for(column=0; column<nbColumns && column*nbRows<nbWeeks; column++){
+    outPrintf("%s%-*s Mon ", (column>0) ? "  " : "", yearWidth, "Year");
+    if(opts[OPT_IDX_WKN]!=OPT_NONE){
+      outStr("WkN ");
+    }
+    printPosterWeekDays(firstWD);
+  }
+  outStr(endLine);
+  
+  for(row=0; row<nbRows; row++){
+    for(column=0; column<nbColumns; column++){
+      week=column*nbRows+row;
+      if(week>=nbWeeks){
+        break;
+      }
+      if(column>0){
+        outWrite("  ", 2);
+      }
+      
+      //Labels : the month starting in the week (and the year, for January), 
+      //or the 1st day of a column
+      labelIdx=-1;
+      for(idx=0; idx<7; idx++){
+        getDateOfDayNumber(start+week*7+idx, &dayOf[idx], &monthOf[idx], &yearOf[idx], opts);
+        if(dayOf[idx]==1 && labelIdx<0){
+          labelIdx=idx;
+        }
+      }
+      if(row==0 && labelIdx<0){
+        labelIdx=0;
+      }
+      if(labelIdx>=0 && (row==0 || monthOf[labelIdx]==JANUARY)){
+        outPrintf("%*d ", yearWidth, yearOf[labelIdx]);
+      }else{
+        outPrintf("%*s ", yearWidth, "");
+      }
+      if(labelIdx>=0){
+        printMonthName(monthOf[labelIdx], 3);
+        outWrite(" ", 1);
+      }else{
+        outWrite("    ", 4);
+      }
+      
+      if(opts[OPT_IDX_WKN]!=OPT_NONE){
+        printWeekNumber(dayOf[6], monthOf[6], yearOf[6], opts);
+        outWrite(" ", 1);
+      }
+      for(idx=0; idx<7; idx++){
+        printPosterDay(dayOf[idx]);
+        if(idx<6){
+          outWrite(" ", 1);
+        }
+      }
+    }
+    outStr(endLine);
+  }
+}
+
+//Return the 1st day (day number) of the week of a day
+static long long getWeekStartDayNumber(long long dayNumber, char* opts){
+  return dayNumber-(getWeekDayOfDayNumber(dayNumber)-(opts[OPT_IDX_FIRSTWD]-'0')+7)%7;
+}
+
+//Poster of weeks : a line by week, -col columns
+static void printGridPoster(int yearFrom, int yearTo, char* opts){
+  long long start=getJulianDayNumber(1, JANUARY, yearFrom, opts);
+  long long end=getJulianDayNumber(31, DECEMBER, yearTo, opts);
+  
+  //1st week : from the 1st weekday before the 1st January
+  start=getWeekStartDayNumber(start, opts);
+  printPosterWeeks(start, (end-start)/7+1, opts[OPT_IDX_NBCOL]-'A', 
+                   getPosterYearWidth(yearTo), opts);
+}
+
+//Pages of the continuous calendar (-page <week> <count>) : the week 0 is 
+//the week of the 1st January of the year 1, so the 1st day of any week 
+//is known directly (no need to go through the previous weeks)
+//<week> : "W<index>", or a date "YYYYMMDD" (its week)
+
+//Return the 1st day (day number) of a week of the continuous calendar
+static long long getPageWeekStart(long long week, char* opts){
+  return getWeekStartDayNumber(getJulianDayNumber(1, JANUARY, 1, opts), opts)+week*7;
+}
+
+//Return the week of the continuous calendar of a day number
+static long long getPageWeek(long long dayNumber, char* opts){
+  return (dayNumber-getPageWeekStart(0, opts))/7;
+}
+
+//Return the number of weeks of the continuous calendar (to the last year)
+static long long getPageMaxWeeks(char* opts){
+  return getPageWeek(getJulianDayNumber(31, DECEMBER, RRULE_MAX_YEAR, opts), opts)+1;
+}
+
+//Return the 1st week of a page ("W<index>" or "YYYYMMDD"), -1 if not valid
+static long long parsePageWeek(const char* str, char* opts){
+  long long dayNumber;
+  char* end;
+  
+  if(str[0]=='W' || str[0]=='w'){
+    dayNumber=strtoll(str+1, &end, 10);
+    return (end>str+1 && *end=='\0' && dayNumber>=0 && dayNumber<getPageMaxWeeks(opts)) 
+           ? dayNumber : -1;
+  }
+  dayNumber=parseRRuleDate(str, opts);
+  return (dayNumber<0) ? -1 : getPageWeek(dayNumber, opts);
+}
+
+//Print a page of the continuous calendar : nbWeeks weeks from the week asked
+static void printPage(long long week, long long nbWeeks, char* opts){
+  long long start=getPageWeekStart(week, opts);
+  int day, month, year;
+  
+  if(week+nbWeeks>getPageMaxWeeks(opts)){
+    nbWeeks=getPageMaxWeeks(opts)-week;
+  }
+  getDateOfDayNumber(start+nbWeeks*7-1, &day, &month, &year, opts);
+  printPosterWeeks(start, nbWeeks, 1, getPosterYearWidth(year), opts);
+}
+
+//Poster of years : a line by year, the months side by side
+static void printLinearPoster(int yearFrom, int yearTo, char* opts){
+  int firstWD=opts[OPT_IDX_FIRSTWD]-'0';
+  int yearWidth=getPosterYearWidth(yearTo);
+  int year, month, slot, offset, daysInMonth, day;
+  
+  //Header : the months, then the weekdays (the same for all months)
+  outPrintf("%*s", yearWidth, "");
+  for(month=JANUARY; month<=DECEMBER; month++){
+    outWrite("|", 1);
+    printMonthName(month, 12);
+    for(slot=12; slot<POSTER_LINEAR_SLOTS*3-1; slot++){
+      outWrite(" ", 1);
+    }
+  }
+  outStr(endLine);
+  outPrintf("%-*s", yearWidth, "Year");
+  for(month=JANUARY; month<=DECEMBER; month++){
+    for(slot=0; slot<POSTER_LINEAR_SLOTS; slot++){
+      outWrite((slot==0) ? "|" : " ", 1);
+      printWeekDayName(changeWeekDay(firstWD, slot), 2);
+    }
+  }
+  outStr(endLine);
+  
+  for(year=yearFrom; year<=yearTo; year++){
+    outPrintf("%*d", yearWidth, year);
+    for(month=JANUARY; month<=DECEMBER; month++){
+      offset=(getFirstWDMonth(month, year, opts)-firstWD+7)%7;
+      daysInMonth=getDaysPerMonth(month, year, opts);
+      for(slot=0; slot<POSTER_LINEAR_SLOTS; slot++){
+        day=slot-offset+1;
+        outWrite((slot==0) ? "|" : " ", 1);
+        printPosterDay((day>=1 && day<=daysInMonth) ? day : 0);
+      }
+    }
+    outStr(endLine);
+  }
+}
+
+//Print a poster of the years (linear view : a line by year)
+static void printPoster(int yearFrom, int yearTo, char* opts){
+  if(opts[OPT_IDX_VIEW]==OPT_VIEW_LINEAR){
+    printLinearPoster(yearFrom, yearTo, opts);
+  }else{
+    printGridPoster(yearFrom, yearTo, opts);
+  }
+}
+
+//Years used for the generated pages : 1 year per calendar type
+//Common-Sunday to Common-Saturday + Common-Saturday-W53 + Leap-Sunday to Leap-Saturday
+#define NB_ARCHETYPES 15
+static const int archetypeYears[NB_ARCHETYPES]={
+  2006, 2001, 2002, 2003, 2009, 2010, 2011, 2005, 2012, 2024, 2008, 2020, 2004, 2016, 2000
+};
+
+static const char* yearTypes[2]={"Common", "Leap"};
+static const char* yearTypesLower[2]={"common", "leap"};
+
+//Fragments of a page, computed once (navigation graph)
+#define PAGE_FRAGMENT_SIZE 512
+typedef struct {
+  char folder[PAGE_FRAGMENT_SIZE];   //path of the archetype folder
+  char current[PAGE_FRAGMENT_SIZE];  //"year:" block of the current section
+  char previous[PAGE_FRAGMENT_SIZE]; //"previous:" block, for January
+  char next[PAGE_FRAGMENT_SIZE];     //"next:" block, for December
+} PageArchetype;
+
+static PageArchetype pageArchetypes[NB_ARCHETYPES];
+static char pageFileNames[12][32];         //"m01-january.txt"
+static char pageMonthLinks[12][PAGE_FRAGMENT_SIZE]; //"  month: January..."
+
+//Copy a string in lower case
+static void copyLower(char* dest, const char* src, size_t size){
+  size_t c;
+  for(c=0; c+1<size && src[c]!='\0'; c++){
+    dest[c]=(src[c]>='A' && src[c]<='Z') ? src[c]-'A'+'a' : src[c];
+  }
+  dest[c]='\0';
+}
+
+//Create a folder and its parents (like mkdir -p)
+static int makeDirs(const char* path){
+  char tmp[PAGE_FRAGMENT_SIZE];
+  size_t c;
+  
+  snprintf(tmp, sizeof(tmp), "%s", path);
+  for(c=1; tmp[c]!='\0'; c++){
+    if(tmp[c]=='/'){
+      tmp[c]='\0';
+      if(mkdir(tmp, 0755)!=0 && errno!=EEXIST){
+        return -1;
+      }
+      tmp[c]='/';
+    }
+  }
+  if(mkdir(tmp, 0755)!=0 && errno!=EEXIST){
+    return -1;
+  }
+  return 0;
+}
+
+//Set a fragment
+static void setFragment(struct iovec* fragment, const char* str){
+  fragment->iov_base=(void*)str;
+  fragment->iov_len=strlen(str);
+}
+
+//Compute the navigation graph between archetypes (same links than genFiles.sh)
+static void initPageArchetypes(const char* baseDir, char* opts){
+  int idx, month, year, isLeap, firstDay, nextDay;
+  int hasW53, nextHasW53;
+  char startLower[16], dayLower[16], prevCommon[16], prevLeap[16];
+  char folderDay[32], nextFolderDay[32];
+  PageArchetype* archetype;
+  
+  copyLower(startLower, weekdays[opts[OPT_IDX_FIRSTWD]-'0'], sizeof(startLower));
+  
+  //Fragments shared by all archetypes
+  for(month=JANUARY; month<=DECEMBER; month++){
+    copyLower(dayLower, months[month], sizeof(dayLower));
+    snprintf(pageFileNames[month], sizeof(pageFileNames[month]), 
+             "m%02d-%s.txt", month+1, dayLower);
+    snprintf(pageMonthLinks[month], PAGE_FRAGMENT_SIZE, 
+             "  month: %s\n  file: <./%s>\n", months[month], pageFileNames[month]);
+  }
+  
+  for(idx=0; idx<NB_ARCHETYPES; idx++){
+    archetype=&pageArchetypes[idx];
+    year=archetypeYears[idx];
+    isLeap=isLeapYear(year, opts);
+    firstDay=getFirstWDMonth(JANUARY, year, opts);
+    hasW53=(firstDay==SATURDAY && getWeekNumber(1, JANUARY, year, opts)==53);
+    
+    //Folder : Saturday+W53 is an exception
+    copyLower(dayLower, weekdays[firstDay], sizeof(dayLower));
+    snprintf(folderDay, sizeof(folderDay), "%s%s", dayLower, (hasW53 ? "-w53" : ""));
+    snprintf(archetype->folder, PAGE_FRAGMENT_SIZE, "%s/%s/grid/%s/%s", 
+             baseDir, startLower, yearTypesLower[isLeap], folderDay);
+    
+    snprintf(archetype->current, PAGE_FRAGMENT_SIZE, 
+             "    starting: %s\n    type: %s\n    index: <./index.txt>\n",
+             weekdays[firstDay], yearTypes[isLeap]);
+    
+    //Previous year : 1st day of previous year, common (-1d) and leap (-2d)
+    copyLower(prevCommon, weekdays[changeWeekDay(firstDay, -1)], sizeof(prevCommon));
+    copyLower(prevLeap, weekdays[changeWeekDay(firstDay, -2)], sizeof(prevLeap));
+    if(!isLeap && hasW53){
+      //(NO list) Link to the previous Leap year
+      snprintf(archetype->previous, PAGE_FRAGMENT_SIZE,
+               "  month: December\n  year: \n"
+               "    type: Leap\n    starting: %s\n    file: <../../leap/%s/m12-december.txt>\n",
+               weekdays[changeWeekDay(firstDay, -2)], prevLeap);
+    }else if(!isLeap){
+      //(list) Link to the previous Common and Leap years
+      snprintf(archetype->previous, PAGE_FRAGMENT_SIZE,
+               "  month: December\n  year: \n"
+               "    - type: Common\n      starting: %s\n      file: <../../common/%s/m12-december.txt>\n"
+               "    - type: Leap\n      starting: %s\n      file: <../../leap/%s/m12-december.txt>\n",
+               weekdays[changeWeekDay(firstDay, -1)], prevCommon,
+               weekdays[changeWeekDay(firstDay, -2)], prevLeap);
+    }else{
+      //(No list) Link to the previous common year only
+      snprintf(archetype->previous, PAGE_FRAGMENT_SIZE,
+               "  month: December\n  year: \n"
+               "    type: Common\n    starting: %s\n    file: <../../common/%s/m12-december.txt>\n",
+               weekdays[changeWeekDay(firstDay, -1)], prevCommon);
+    }
+    
+    //Next year
+    nextDay=changeWeekDay(firstDay, 1+isLeap);
+    copyLower(dayLower, weekdays[nextDay], sizeof(dayLower));
+    if(!isLeap && hasW53){
+      //(NO list) link to the next common year (as leap was previous)
+      snprintf(archetype->next, PAGE_FRAGMENT_SIZE,
+               "  month: January\n  year: \n    starting: %s\n"
+               "    type: Common\n    file: <../../common/%s/m01-january.txt>\n",
+               weekdays[nextDay], dayLower);
+    }else if(!isLeap){
+      //(list) link to next common and leap years
+      snprintf(archetype->next, PAGE_FRAGMENT_SIZE,
+               "  month: January\n  year: \n    starting: %s\n"
+               "    - type: Common\n      file: <../../common/%s/m01-january.txt>\n"
+               "    - type: Leap\n      file: <../../leap/%s/m01-january.txt>\n",
+               weekdays[nextDay], dayLower, dayLower);
+    }else{
+      //link to the next Common year ONLY (Saturday+W53 is an exception)
+      nextHasW53=(nextDay==SATURDAY && getWeekNumber(1, JANUARY, year+1, opts)==53);
+      snprintf(nextFolderDay, sizeof(nextFolderDay), "%s%s", 
+               weekdays[nextDay], (nextHasW53 ? "-W53" : ""));
+      copyLower(dayLower, nextFolderDay, sizeof(dayLower));
+      snprintf(archetype->next, PAGE_FRAGMENT_SIZE,
+               "  month: January\n  year: \n    starting: %s\n"
+               "    type: Common\n    file: <../../common/%s/m01-january.txt>\n",
+               nextFolderDay, dayLower);
+    }
+  }
+}
+
+//Pages of an archetype : the 12 bodies are rendered in a batch, then the
+//files are created and written by the I/O stage (writePageBatch)
+typedef struct {
+  const PageArchetype* archetype;
+  char* body;                 //the bodies of the months, one after the other
+  size_t bodyEnd[12];
+  size_t capacity;
+} PageBatch;
+
+//Render the bodies of the 12 pages of an archetype
+//Return 0 if OK, -1 if not enough memory
+static int renderPageBatch(PageBatch* batch, int idx, char* pageOpts){
+  int month;
+  size_t length=0;
+  char* newBody;
+  
+  batch->archetype=&pageArchetypes[idx];
+  for(month=JANUARY; month<=DECEMBER; month++){
+    //Render the body in the output buffer, then keep it
+    printMdCal(month, month, archetypeYears[idx], pageOpts);
+    if(length+outLength>batch->capacity){
+      batch->capacity=(length+outLength)*2;
+      newBody=realloc(batch->body, batch->capacity);
+      if(newBody==NULL){
+        outLength=0;
+        return -1;
+      }
+      batch->body=newBody;
+    }
+    memcpy(batch->body+length, outBuffer, outLength);
+    length=length+outLength;
+    batch->bodyEnd[month]=length;
+    outLength=0;
+  }
+  return 0;
+}
+
+//Create the missing pages of a batch, and add them to the index file
+//Return 0 if OK, -1 if a file cannot be written
+static int writePageBatch(const PageBatch* batch){
+  int month, fd, nbFragments, nbIndexFragments=0;
+  size_t bodyStart=0;
+  char path[PAGE_FRAGMENT_SIZE+32];
+  char indexLinks[12][64];
+  struct iovec fragments[16];
+  struct iovec indexFragments[13];
+  const PageArchetype* archetype=batch->archetype;
+  
+  if(makeDirs(archetype->folder)!=0){
+    fprintf(stderr, "Cannot create %s%s", archetype->folder, endLine);
+    return -1;
+  }
+  
+  setFragment(&indexFragments[nbIndexFragments++], "\n## Calendars\n\n");
+  for(month=JANUARY; month<=DECEMBER; bodyStart=batch->bodyEnd[month++]){
+    snprintf(path, sizeof(path), "%s/%s", archetype->folder, pageFileNames[month]);
+    fd=open(path, O_WRONLY|O_CREAT|O_EXCL, 0644);
+    if(fd<0){
+      if(errno==EEXIST){
+        //Continue only if the file doesn't exist
+        continue;
+      }
+      fprintf(stderr, "Cannot create %s%s", path, endLine);
+      return -1;
+    }
+    
+    nbFragments=0;
+    fragments[nbFragments].iov_base=batch->body+bodyStart;
+    fragments[nbFragments++].iov_len=batch->bodyEnd[month]-bodyStart;
+    setFragment(&fragments[nbFragments++], "\n---\ncurrent:\n  month: ");
+    setFragment(&fragments[nbFragments++], months[month]);
+    setFragment(&fragments[nbFragments++], "\n  year: \n");
+    setFragment(&fragments[nbFragments++], archetype->current);
+    setFragment(&fragments[nbFragments++], "  file: <./");
+    setFragment(&fragments[nbFragments++], pageFileNames[month]);
+    setFragment(&fragments[nbFragments++], ">\n    license: public domain\nprevious:\n");
+    if(month>JANUARY){
+      setFragment(&fragments[nbFragments++], pageMonthLinks[month-1]);
+    }else{
+      setFragment(&fragments[nbFragments++], archetype->previous);
+    }
+    setFragment(&fragments[nbFragments++], "next:\n");
+    if(month<DECEMBER){
+      setFragment(&fragments[nbFragments++], pageMonthLinks[month+1]);
+    }else{
+      setFragment(&fragments[nbFragments++], archetype->next);
+    }
+    setFragment(&fragments[nbFragments++], "...\n");
+    
+    if(writeFragments(fd, fragments, nbFragments)!=0){
+      fprintf(stderr, "Cannot write %s%s", path, endLine);
+      close(fd);
+      return -1;
+    }
+    close(fd);
+    
+    //Add the month to the index file
+    snprintf(indexLinks[month], sizeof(indexLinks[month]), "[%s](./%s)\n", 
+             months[month], pageFileNames[month]);
+    setFragment(&indexFragments[nbIndexFragments++], indexLinks[month]);
+  }
+  
+  //Add the new months to the index file
+  if(nbIndexFragments>1){
+    snprintf(path, sizeof(path), "%s/index.txt", archetype->folder);
+    fd=open(path, O_WRONLY|O_CREAT|O_APPEND, 0644);
+    if(fd<0 || writeFragments(fd, indexFragments, nbIndexFragments)!=0){
+      fprintf(stderr, "Cannot write %s%s", path, endLine);
+      if(fd>=0){
+        close(fd);
+      }
+      return -1;
+    }
+    close(fd);
+  }
+  return 0;
+}
+
+#ifdef CAL_THREADS
+//I/O stage of the pages (-DCAL_THREADS) : a thread writes the batches 
+//rendered, while the next ones are rendered
+#define PAGE_BATCHES 2
+
+typedef struct {
+  PageBatch batches[PAGE_BATCHES];
+  int first;                  //next batch written
+  int nbReady;                //batches rendered, not written
+  int done;                   //no more batches
+  int failed;
+  pthread_mutex_t lock;
+  pthread_cond_t changed;
+} PageWriter;
+
+//Write the batches, until the last one
+static void* runPageWriter(void* data){
+  PageWriter* writer=data;
+  int result;
+  
+  pthread_mutex_lock(&writer->lock);
+  for(;;){
+    while(writer->nbReady==0 && !writer->done){
+      pthread_cond_wait(&writer->changed, &writer->lock);
+    }
+    if(writer->nbReady==0){
+      break;
+    }
+    pthread_mutex_unlock(&writer->lock);
+    result=writePageBatch(&writer->batches[writer->first]);
+    pthread_mutex_lock(&writer->lock);
+    
+    writer->first=(writer->first+1)%PAGE_BATCHES;
+    writer->nbReady--;
+    writer->failed=writer->failed || (result!=0);
+    pthread_cond_signal(&writer->changed);
+  }
+  pthread_mutex_unlock(&writer->lock);
+  return NULL;
+}
+#endif
+
+//Generate the month pages (grid view, with YAML navigation) of all archetypes
+//Existing pages are kept
+static int printPages(const char* baseDir, char* opts){
+  int idx, result=0;
+  char pageOpts[OPTS_NB];
+#ifdef CAL_THREADS
+  static PageWriter writer;
+  pthread_t thread;
+  PageBatch* batch;
+#else
+  PageBatch batch={NULL, NULL, {0}, 0};
+#endif
+  
+  //Same options than the grid pages of genFiles.sh
+  memcpy(pageOpts, opts, OPTS_NB);
+  pageOpts[OPT_IDX_WKN]=OPT_LEFT;
+  pageOpts[OPT_IDX_FORMAT]=OPT_FORMAT_MD;
+  
+  initPageArchetypes(baseDir, pageOpts);
+  outFlush();
+  
+#ifdef CAL_THREADS
+  memset(&writer, 0, sizeof(writer));
+  pthread_mutex_init(&writer.lock, NULL);
+  pthread_cond_init(&writer.changed, NULL);
+  if(pthread_create(&thread, NULL, runPageWriter, &writer)!=0){
+    return -1;
+  }
+  
+  for(idx=0; idx<NB_ARCHETYPES && result==0; idx++){
+    //Wait for a free batch
+    pthread_mutex_lock(&writer.lock);
+    while(writer.nbReady==PAGE_BATCHES && !writer.failed){
+      pthread_cond_wait(&writer.changed, &writer.lock);
+    }
+    result=-writer.failed;
+    batch=&writer.batches[(writer.first+writer.nbReady)%PAGE_BATCHES];
+    pthread_mutex_unlock(&writer.lock);
+    
+    if(result==0){
+      result=renderPageBatch(batch, idx, pageOpts);
+    }
+    if(result==0){
+      pthread_mutex_lock(&writer.lock);
+      writer.nbReady++;
+      pthread_cond_signal(&writer.changed);
+      pthread_mutex_unlock(&writer.lock);
+    }
+  }
+  
+  //Wait for the last writes
+  pthread_mutex_lock(&writer.lock);
+  writer.done=1;
+  pthread_cond_signal(&writer.changed);
+  pthread_mutex_unlock(&writer.lock);
+  pthread_join(thread, NULL);
+  result=(result!=0 || writer.failed) ? -1 : 0;
+  
+  for(idx=0; idx<PAGE_BATCHES; idx++){
+    free(writer.batches[idx].body);
+  }
+  pthread_mutex_destroy(&writer.lock);
+  pthread_cond_destroy(&writer.changed);
+#else
+  for(idx=0; idx<NB_ARCHETYPES && result==0; idx++){
+    result=renderPageBatch(&batch, idx, pageOpts);
+    if(result==0){
+      result=writePageBatch(&batch);
+    }
+  }
+  free(batch.body);
+#endif
+  
+  return result;
+}
+
+//Pack of a generated tree (-pack <dir> <file>) : the files are split in
+//lines, each different line is stored once (a chunk, addressed by its 
+//hash), and each file is a list of chunk numbers (varints, the frequent 
+//chunks first). The pack is mapped as is : header, files sorted by path,
+//chunks (hash, offset), references, paths, data.
+//-unpack <file> <dir> : extract all files, -packcat <file> <path> : one file
+#define PACK_MAGIC        "CALPACK1"
+#define PACK_PATH_SIZE    4096
+#define PACK_CHUNK_MAX    4096      //longer lines are split
+#define PACK_FRAGMENTS    256       //chunks written at once
+
+typedef struct {
+  char magic[8];
+  unsigned long long nbFiles;
+  unsigned long long nbChunks;
+  unsigned long long refsSize;
+  unsigned long long namesSize;
+  unsigned long long dataSize;
+} PackHeader;
+
+typedef struct {
+  unsigned long long nameOffset;
+  unsigned long long refsOffset;
+  unsigned long long size;       //size of the file
+  unsigned int nameSize;
+  unsigned int nbRefs;
+} PackFile;
+
+typedef struct {
+  unsigned long long hash;
+  unsigned long long offset;     //offset in the data (+1 chunk : the end)
+} PackChunk;
+
+//Pack being built
+typedef struct {
+  char** paths;
+  long long nbPaths, pathsCapacity;
+  PackChunk* chunks;              //offsets : in the source data
+  long long nbChunks, chunksCapacity;
+  long long* uses;                //references of each chunk
+  long long usesCapacity;
+  unsigned int* refs;             //chunks of the files (build numbers)
+  long long nbRefs, refsCapacity;
+  PackFile* files;
+  long long nbFiles, filesCapacity;
+  char* data;                     //chunks data (build order)
+  long long dataSize, dataCapacity;
+  long long* table;               //hash table : chunk number+1 (0 : empty)
+  long long tableSize;
+} PackBuilder;
+
+//A mapped pack
+typedef struct {
+  const PackHeader* header;
+  const PackFile* files;
+  const PackChunk* chunks;
+  const unsigned char* refs;
+  const char* names;
+  const char* data;
+  size_t mapSize;
+} PackMap;
+
+//Add the paths of the files of a folder (recursive, relative paths)
+static int addPackPaths(PackBuilder* pack, const char* baseDir, const char* subDir){
+  char path[PACK_PATH_SIZE], name[PACK_PATH_SIZE];
+  struct dirent* entry;
+  struct stat fileStat;
+  char* copy;
+  DIR* dir;
+  int result=0;
+  
+  snprintf(path, sizeof(path), "%s%s%s", baseDir, (*subDir!='\0') ? "/" : "", subDir);
+  dir=opendir(path);
+  if(dir==NULL){
+    return -1;
+  }
+  while(result==0 && (entry=readdir(dir))!=NULL){
+    if(strcmp(entry->d_name, ".")==0 || strcmp(entry->d_name, "..")==0){
+      continue;
+    }
+    snprintf(name, sizeof(name), "%s%s%s", subDir, (*subDir!='\0') ? "/" : "", entry->d_name);
+    if(snprintf(path, sizeof(path), "%s/%s", baseDir, name)>=(int)sizeof(path)
+       || lstat(path, &fileStat)!=0){
+      result=-1;
+    }else if(S_ISDIR(fileStat.st_mode)){
+      result=addPackPaths(pack, baseDir, name);
+    }else if(S_ISREG(fileStat.st_mode)){
+      copy=strdup(name);
+      if(copy==NULL || appendValue((void**)&pack->paths, &pack->nbPaths, 
+                                   &pack->pathsCapacity, &copy, sizeof(copy))!=0){
+        free(copy);
+        result=-1;
+      }
+    }
+  }
+  closedir(dir);
+  return result;
+}
+
+//Return the build number of a chunk (added if new), -1 if no memory
+static long long addPackChunk(PackBuilder* pack, const char* str, size_t size){
+  unsigned long long hash=hashChunk(str, size);
+  long long slot, number, idx, count, uses;
+  PackChunk chunk;
+  long long* table;
+  
+  //Grow the table (load < 1/2)
+  if(2*(pack->nbChunks+1)>pack->tableSize){
+    table=calloc((pack->tableSize==0) ? 4096 : 2*pack->tableSize, sizeof(long long));
+    if(table==NULL){
+      return -1;
+    }
+    free(pack->table);
+    pack->table=table;
+    pack->tableSize=(pack->tableSize==0) ? 4096 : 2*pack->tableSize;
+    for(idx=0; idx<pack->nbChunks; idx++){
+      for(slot=pack->chunks[idx].hash&(pack->tableSize-1); pack->table[slot]!=0;
+          slot=(slot+1)&(pack->tableSize-1)){
+      }
+      pack->table[slot]=idx+1;
+    }
+  }
+  
+  //Same hash and same content : the chunk is known
+  for(slot=hash&(pack->tableSize-1); pack->table[slot]!=0; slot=(slot+1)&(pack->tableSize-1)){
+    number=pack->table[slot]-1;
+    if(pack->chunks[number].hash==hash 
+       && (size_t)(pack->chunks[number+1].offset-pack->chunks[number].offset)==size
+       && memcmp(pack->data+pack->chunks[number].offset, str, size)==0){
+      pack->uses[number]++;
+      return number;
+    }
+  }
+  
+  //New chunk : the end offset (the last chunk) becomes its start
+  number=pack->nbChunks;
+  count=number;
+  chunk.hash=0;
+  chunk.offset=0;
+  if(number==0 && appendValue((void**)&pack->chunks, &count, &pack->chunksCapacity,
+                              &chunk, sizeof(chunk))!=0){
+    return -1;
+  }
+  for(idx=0; idx<(long long)size; idx++){
+    if(appendValue((void**)&pack->data, &pack->dataSize, &pack->dataCapacity, 
+                   str+idx, 1)!=0){
+      return -1;
+    }
+  }
+  pack->chunks[number].hash=hash;
+  chunk.offset=pack->dataSize;
+  count=number+1;
+  if(appendValue((void**)&pack->chunks, &count, &pack->chunksCapacity, 
+                 &chunk, sizeof(chunk))!=0){
+    return -1;
+  }
+  uses=1;
+  count=number;
+  if(appendValue((void**)&pack->uses, &count, &pack->usesCapacity, &uses, sizeof(uses))!=0){
+    return -1;
+  }
+  pack->nbChunks=number+1;
+  pack->table[slot]=number+1;
+  return number;
+}
+
+//Add a file (its chunks), return 0 if OK
+static int addPackFile(PackBuilder* pack, const char* baseDir, const char* name){
+  char path[PACK_PATH_SIZE];
+  struct stat fileStat;
+  const char* text=NULL;
+  size_t start, end;
+  long long number;
+  unsigned int ref;
+  PackFile file;
+  int fd;
+  
+  snprintf(path, sizeof(path), "%s/%s", baseDir, name);
+  fd=open(path, O_RDONLY);
+  if(fd<0 || fstat(fd, &fileStat)!=0){
+    if(fd>=0){
+      close(fd);
+    }
+    return -1;
+  }
+  if(fileStat.st_size>0){
+    text=mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);
+  if(text==MAP_FAILED){
+    return -1;
+  }
+  
+  memset(&file, 0, sizeof(file));
+  file.refsOffset=pack->nbRefs;
+  file.size=fileStat.st_size;
+  for(start=0; start<(size_t)fileStat.st_size; start=end){
+    //A line (or a part of a long line)
+    for(end=start; end<(size_t)fileStat.st_size && end-start<PACK_CHUNK_MAX 
+                   && text[end]!='\n'; end++){
+    }
+    end=end+(end<(size_t)fileStat.st_size && text[end]=='\n');
+    number=addPackChunk(pack, text+start, end-start);
+    ref=(unsigned int)number;
+    if(number<0 || appendValue((void**)&pack->refs, &pack->nbRefs, &pack->refsCapacity, 
+                               &ref, sizeof(ref))!=0){
+      munmap((void*)text, fileStat.st_size);
+      return -1;
+    }
+    file.nbRefs++;
+  }
+  if(text!=NULL){
+    munmap((void*)text, fileStat.st_size);
+  }
+  return appendValue((void**)&pack->files, &pack->nbFiles, &pack->filesCapacity, 
+                     &file, sizeof(file));
+}
+
+//Compare the paths (sort)
+static int comparePaths(const void* pathA, const void* pathB){
+  return strcmp(*(char* const*)pathA, *(char* const*)pathB);
+}
+
+//Order of the chunks : the most used first (the smallest varints)
+static long long* packUses;
+static int compareChunkUses(const void* chunkA, const void* chunkB){
+  long long usesA=packUses[*(const unsigned int*)chunkA];
+  long long usesB=packUses[*(const unsigned int*)chunkB];
+  if(usesA!=usesB){
+    return (usesA>usesB) ? -1 : 1;
+  }
+  return (*(const unsigned int*)chunkA<*(const unsigned int*)chunkB) ? -1 : 1;
+}
+
+//Write the pack (numbers of the chunks : by uses), return 0 if OK
+static int writePack(PackBuilder* pack, const char* fileName){
+  PackHeader header;
+  char tmpName[PACK_PATH_SIZE];
+  unsigned int* order=malloc((pack->nbChunks+1)*sizeof(unsigned int));
+  unsigned int* numbers=malloc((pack->nbChunks+1)*sizeof(unsigned int));
+  PackChunk* chunks=malloc((pack->nbChunks+1)*sizeof(PackChunk));
+  unsigned char* refs=malloc(pack->nbRefs*5+1);
+  char* names=NULL;
+  char* data=malloc(pack->dataSize+1);
+  struct iovec fragments[7];
+  long long idx, refsSize=0, namesSize=0, namesCapacity=0, offset=0, size;
+  unsigned int value;
+  int fd, result=-1;
+  
+  if(order==NULL || numbers==NULL || chunks==NULL || refs==NULL || data==NULL){
+    goto end;
+  }
+  
+  //New numbers of the chunks, and their data in this order
+  for(idx=0; idx<pack->nbChunks; idx++){
+    order[idx]=(unsigned int)idx;
+  }
+  packUses=pack->uses;
+  qsort(order, pack->nbChunks, sizeof(unsigned int), compareChunkUses);
+  for(idx=0; idx<pack->nbChunks; idx++){
+    numbers[order[idx]]=(unsigned int)idx;
+    size=pack->chunks[order[idx]+1].offset-pack->chunks[order[idx]].offset;
+    memcpy(data+offset, pack->data+pack->chunks[order[idx]].offset, size);
+    chunks[idx].hash=pack->chunks[order[idx]].hash;
+    chunks[idx].offset=offset;
+    offset=offset+size;
+  }
+  chunks[pack->nbChunks].hash=0;
+  chunks[pack->nbChunks].offset=offset;
+  
+  //References of the files (varints), and the paths
+  for(idx=0; idx<pack->nbFiles; idx++){
+    pack->files[idx].nameOffset=namesSize;
+    pack->files[idx].nameSize=(unsigned int)strlen(pack->paths[idx]);
+    for(size=0; size<pack->files[idx].nameSize; size++){
+      if(appendValue((void**)&names, &namesSize, &namesCapacity, 
+                     pack->paths[idx]+size, 1)!=0){
+        goto end;
+      }
+    }
+  }
+  for(idx=0; idx<pack->nbFiles; idx++){
+    offset=pack->files[idx].refsOffset;
+    pack->files[idx].refsOffset=refsSize;
+    for(size=0; size<pack->files[idx].nbRefs; size++){
+      for(value=numbers[pack->refs[offset+size]]; value>=0x80; value=value>>7){
+        refs[refsSize++]=(unsigned char)(value|0x80);
+      }
+      refs[refsSize++]=(unsigned char)value;
+    }
+  }
+  
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, PACK_MAGIC, sizeof(header.magic));
+  header.nbFiles=pack->nbFiles;
+  header.nbChunks=pack->nbChunks;
+  header.refsSize=refsSize;
+  header.namesSize=namesSize;
+  header.dataSize=pack->dataSize;
+  
+  //Written in a temporary file, then renamed (never a partial pack)
+  snprintf(tmpName, sizeof(tmpName), "%s.%ld", fileName, (long)getpid());
+  fd=open(tmpName, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+  if(fd<0){
+    goto end;
+  }
+  fragments[0].iov_base=&header;
+  fragments[0].iov_len=sizeof(header);
+  fragments[1].iov_base=pack->files;
+  fragments[1].iov_len=pack->nbFiles*sizeof(PackFile);
+  fragments[2].iov_base=chunks;
+  fragments[2].iov_len=(pack->nbChunks+1)*sizeof(PackChunk);
+  fragments[3].iov_base=refs;
+  fragments[3].iov_len=refsSize;
+  fragments[4].iov_base=names;
+  fragments[4].iov_len=namesSize;
+  fragments[5].iov_base=data;
+  fragments[5].iov_len=pack->dataSize;
+  if(writeFragments(fd, fragments, 6)!=0 || close(fd)!=0 || rename(tmpName, fileName)!=0){
+    unlink(tmpName);
+    goto end;
+  }
+  fprintf(stderr, "pack: %lld files, %lld chunks, %lld bytes%s", pack->nbFiles, 
+          pack->nbChunks, (long long)(sizeof(header)+pack->nbFiles*sizeof(PackFile)
+          +(pack->nbChunks+1)*sizeof(PackChunk)+refsSize+namesSize+pack->dataSize), endLine);
+  result=0;
+  
+end:
+  free(order);
+  free(numbers);
+  free(chunks);
+  free(refs);
+  free(names);
+  free(data);
+  return result;
+}
+
+//Pack the files of a folder, return 0 if OK
+static int packTree(const char* baseDir, const char* fileName){
+  PackBuilder pack;
+  long long idx;
+  int result;
+  
+  memset(&pack, 0, sizeof(pack));
+  result=addPackPaths(&pack, baseDir, "");
+  if(result==0){
+    qsort(pack.paths, pack.nbPaths, sizeof(char*), comparePaths);
+  }
+  for(idx=0; idx<pack.nbPaths && result==0; idx++){
+    result=addPackFile(&pack, baseDir, pack.paths[idx]);
+  }
+  if(result==0){
+    result=writePack(&pack, fileName);
+  }
+  if(result!=0){
+    fprintf(stderr, "Cannot pack %s%s", baseDir, endLine);
+  }
+  
+  for(idx=0; idx<pack.nbPaths; idx++){
+    free(pack.paths[idx]);
+  }
+  free(pack.paths);
+  free(pack.chunks);
+  free(pack.uses);
+  free(pack.refs);
+  free(pack.files);
+  free(pack.data);
+  free(pack.table);
+  return result;
+}
+
+//Map a pack (checked : sizes, offsets, hashes), return 0 if OK
+static int mapPack(const char* fileName, PackMap* pack){
+  struct stat fileStat;
+  const PackHeader* header;
+  unsigned long long idx, expected;
+  const char* map;
+  int fd=open(fileName, O_RDONLY);
+  
+  if(fd<0 || fstat(fd, &fileStat)!=0 || (size_t)fileStat.st_size<sizeof(PackHeader)){
+    if(fd>=0){
+      close(fd);
+    }
+    return -1;
+  }
+  map=mmap(NULL, fileStat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if(map==MAP_FAILED){
+    return -1;
+  }
+  
+  header=(const PackHeader*)map;
+  pack->header=header;
+  pack->mapSize=fileStat.st_size;
+  expected=sizeof(PackHeader);
+  if(memcmp(header->magic, PACK_MAGIC, sizeof(header->magic))==0
+     && header->nbFiles<pack->mapSize/sizeof(PackFile)
+     && header->nbChunks<pack->mapSize/sizeof(PackChunk)
+     && header->refsSize<=pack->mapSize && header->namesSize<=pack->mapSize
+     && header->dataSize<=pack->mapSize){
+    expected=expected+header->nbFiles*sizeof(PackFile)+(header->nbChunks+1)*sizeof(PackChunk)
+             +header->refsSize+header->namesSize+header->dataSize;
+  }
+  if(expected!=pack->mapSize){
+    munmap((void*)map, pack->mapSize);
+    return -1;
+  }
+  pack->files=(const PackFile*)(map+sizeof(PackHeader));
+  pack->chunks=(const PackChunk*)(pack->files+header->nbFiles);
+  pack->refs=(const unsigned char*)(pack->chunks+header->nbChunks+1);
+  pack->names=(const char*)pack->refs+header->refsSize;
+  pack->data=pack->names+header->namesSize;
+  
+  //Chunks : in order, then with their hash
+  for(idx=0; idx<=header->nbChunks; idx++){
+    if(pack->chunks[idx].offset>header->dataSize 
+       || (idx>0 && pack->chunks[idx].offset<pack->chunks[idx-1].offset)){
+      munmap((void*)map, pack->mapSize);
+      return -1;
+    }
+  }
+  for(idx=0; idx<header->nbChunks; idx++){
+    if(pack->chunks[idx].hash!=hashChunk(pack->data+pack->chunks[idx].offset, 
+                                         pack->chunks[idx+1].offset-pack->chunks[idx].offset)){
+      munmap((void*)map, pack->mapSize);
+      return -1;
+    }
+  }
+  for(idx=0; idx<header->nbFiles; idx++){
+    if(pack->files[idx].nameOffset+pack->files[idx].nameSize>header->namesSize
+       || pack->files[idx].refsOffset>header->refsSize){
+      munmap((void*)map, pack->mapSize);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+//Write a file of the pack, return 0 if OK
+static int writePackFile(const PackMap* pack, const PackFile* file, int fd){
+  struct iovec fragments[PACK_FRAGMENTS];
+  unsigned long long offset=file->refsOffset;
+  unsigned long long number, written=0;
+  unsigned int ref;
+  int nbFragments=0, shift;
+  
+  for(ref=0; ref<file->nbRefs; ref++){
+    //Read the varint
+    number=0;
+    for(shift=0; offset<pack->header->refsSize && shift<35; shift=shift+7){
+      number=number|((unsigned long long)(pack->refs[offset]&0x7F)<<shift);
+      if((pack->refs[offset++]&0x80)==0){
+        break;
+      }
+    }
+    if(number>=pack->header->nbChunks){
+      return -1;
+    }
+    fragments[nbFragments].iov_base=(void*)(pack->data+pack->chunks[number].offset);
+    fragments[nbFragments].iov_len=pack->chunks[number+1].offset-pack->chunks[number].offset;
+    written=written+fragments[nbFragments].iov_len;
+    nbFragments++;
+    if(nbFragments==PACK_FRAGMENTS || ref+1==file->nbRefs){
+      if(writeFragments(fd, fragments, nbFragments)!=0){
+        return -1;
+      }
+      nbFragments=0;
+    }
+  }
+  return (written==file->size) ? 0 : -1;
+}
+
+//Extract the files of a pack (all files : path=NULL, in the folder), or
+//print a file (found by a binary search on the sorted paths)
+//Return 0 if OK
+static int unpackTree(const char* fileName, const char* baseDir, const char* path){
+  char name[PACK_PATH_SIZE];
+  PackMap pack;
+  const PackFile* file;
+  unsigned long long idx, low, high, middle;
+  size_t length;
+  int fd, result=0, compare;
+  
+  if(mapPack(fileName, &pack)!=0){
+    fprintf(stderr, "Invalid pack %s%s", fileName, endLine);
+    return -1;
+  }
+  
+  if(path!=NULL){
+    low=0;
+    high=pack.header->nbFiles;
+    length=strlen(path);
+    result=-1;
+    while(low<high && result!=0){
+      middle=low+(high-low)/2;
+      file=&pack.files[middle];
+      compare=strncmp(path, pack.names+file->nameOffset, file->nameSize);
+      if(compare==0 && length!=file->nameSize){
+        compare=(length<file->nameSize) ? -1 : 1;
+      }
+      if(compare==0){
+        outFlush();
+        result=writePackFile(&pack, file, STDOUT_FILENO);
+      }else if(compare<0){
+        high=middle;
+      }else{
+        low=middle+1;
+      }
+    }
+    if(result!=0){
+      fprintf(stderr, "Cannot read %s in %s%s", path, fileName, endLine);
+    }
+  }
+  
+  for(idx=0; path==NULL && idx<pack.header->nbFiles && result==0; idx++){
+    file=&pack.files[idx];
+    length=snprintf(name, sizeof(name), "%s/%.*s", baseDir, (int)file->nameSize, 
+                    pack.names+file->nameOffset);
+    while(length>0 && name[length-1]!='/'){
+      length--;
+    }
+    name[length-1]='\0';
+    if(strstr(name, "/../")!=NULL || makeDirs(name)!=0){
+      result=-1;
+      break;
+    }
+    name[length-1]='/';
+    fd=open(name, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+    if(fd<0 || writePackFile(&pack, file, fd)!=0){
+      result=-1;
+    }
+    if(fd>=0 && close(fd)!=0){
+      result=-1;
+    }
+    if(result!=0){
+      fprintf(stderr, "Cannot write %s%s", name, endLine);
+    }
+  }
+  
+  munmap((void*)pack.header, pack.mapSize);
+  return result;
+}
+
+//Search of years (-search <predicate> <from> <to>) : each year type 
+//(common/leap, weekday of the 1st January) is a set of 366-bit bitsets
+//(days of each weekday, of each day of month, of each month), the 
+//predicates are counts of AND-ed bitsets, evaluated once per year type
+#define SEARCH_WORDS      6     //366 bits
+#define SEARCH_TYPES      14    //2 types x 7 weekdays
+#define SEARCH_MAX_TERMS  16
+#define SEARCH_OP_EQ      '='
+#define SEARCH_OP_GE      'g'
+#define SEARCH_OP_LE      'l'
+
+typedef unsigned long long DayBits[SEARCH_WORDS];
+
+//Bitsets of the year types (day of the year 1-366 : bits 0-365)
+typedef struct {
+  int ready;
+  DayBits weekdays[SEARCH_TYPES][7];
+  DayBits monthDays[2][31];
+  DayBits months[2][12];
+} YearBits;
+
+static YearBits yearBits;
+
+//A term of the predicate : "all", "leap", "common", "start=<weekday>",
+//"type=<common|leap>-<weekday>[-w53]", "weeks=<52-54>", "like=<year>",
+//"<weekday><day><op><n>" (friday13=3), "<weekday>@<month><op><n>" (friday@3=5)
+typedef struct {
+  char kind;
+  int weekday;     //-1 : any
+  int leap;        //-1 : any
+  int w53;         //-1 : any, 0 or 1 (1st January in the week 53)
+  int value;       //day, month or number of weeks
+  char op;
+  int count;
+} SearchTerm;
+
+typedef struct {
+  int nbTerms;
+  SearchTerm terms[SEARCH_MAX_TERMS];
+  char match[SEARCH_TYPES];   //result of the bitsets terms, by year type
+} SearchPredicate;
+
+//Return the number of bits set
+static int countBits(unsigned long long value){
+#if defined(__GNUC__)
+  return __builtin_popcountll(value);
+#else
+  value=value-((value>>1)&0x5555555555555555ULL);
+  value=(value&0x3333333333333333ULL)+((value>>2)&0x3333333333333333ULL);
+  value=(value+(value>>4))&0x0F0F0F0F0F0F0F0FULL;
+  return (int)((value*0x0101010101010101ULL)>>56);
+#endif
+}
+
+//Return the number of days in the 2 bitsets (word-parallel)
+static int countCommonDays(const unsigned long long* bitsA, const unsigned long long* bitsB){
+  int count=0;
+  for(int word=0; word<SEARCH_WORDS; word++){
+    count=count+countBits(bitsA[word]&bitsB[word]);
+  }
+  return count;
+}
+
+//Build the bitsets of all year types
+static void initYearBits(void){
+  int leap, firstDay, month, day, dayOfYear, type;
+  
+  if(yearBits.ready){
+    return;
+  }
+  memset(&yearBits, 0, sizeof(yearBits));
+  for(leap=0; leap<2; leap++){
+    dayOfYear=0;
+    for(month=JANUARY; month<=DECEMBER; month++){
+      for(day=1; day<=daysPerMonth[month]+(leap && month==FEBRUARY); day++){
+        yearBits.monthDays[leap][day-1][dayOfYear/64]|=1ULL<<(dayOfYear%64);
+        yearBits.months[leap][month][dayOfYear/64]|=1ULL<<(dayOfYear%64);
+        for(firstDay=SUNDAY; firstDay<=SATURDAY; firstDay++){
+          type=leap*7+firstDay;
+          yearBits.weekdays[type][(firstDay+dayOfYear)%7][dayOfYear/64]|=1ULL<<(dayOfYear%64);
+        }
+        dayOfYear++;
+      }
+    }
+  }
+  yearBits.ready=1;
+}
+
+//Read a weekday name (full or 3 letters, any case), return the end or NULL
+static const char* parseSearchWeekday(const char* str, int* weekday){
+  char name[16];
+  size_t length;
+  
+  for(*weekday=SUNDAY; *weekday<=SATURDAY; (*weekday)++){
+    copyLower(name, weekdays[*weekday], sizeof(name));
+    length=strlen(name);
+    if(strncasecmp(str, name, length)==0){
+      return str+length;
+    }
+    if(strncasecmp(str, name, 3)==0){
+      return str+3;
+    }
+  }
+  return NULL;
+}
+
+//Read "<op><n>", return the end or NULL
+static const char* parseSearchCount(const char* str, SearchTerm* term){
+  char* end;
+  
+  if(strncmp(str, ">=", 2)==0){
+    term->op=SEARCH_OP_GE;
+    str=str+2;
+  }else if(strncmp(str, "<=", 2)==0){
+    term->op=SEARCH_OP_LE;
+    str=str+2;
+  }else if(*str=='='){
+    term->op=SEARCH_OP_EQ;
+    str++;
+  }else{
+    return NULL;
+  }
+  term->count=(int)strtol(str, &end, 10);
+  return (end==str) ? NULL : end;
+}
+
+//Parse the predicate (terms separated by ','), return 0 if valid
+static int parseSearchPredicate(const char* str, SearchPredicate* predicate, char* opts){
+  char buffer[256];
+  char* item;
+  const char* end;
+  char* number;
+  SearchTerm* term;
+  int year;
+  
+  snprintf(buffer, sizeof(buffer), "%s", str);
+  predicate->nbTerms=0;
+  for(item=strtok(buffer, ","); item!=NULL; item=strtok(NULL, ",")){
+    if(predicate->nbTerms>=SEARCH_MAX_TERMS){
+      return -1;
+    }
+    term=&predicate->terms[predicate->nbTerms++];
+    term->kind='t';
+    term->weekday=-1;
+    term->leap=-1;
+    term->w53=-1;
+    end=NULL;
+    
+    if(strcmp(item, "all")==0){
+      end=item+3;
+    }else if(strcmp(item, "leap")==0 || strcmp(item, "common")==0){
+      term->leap=(item[0]=='l');
+      end=item+strlen(item);
+    }else if(strncmp(item, "start=", 6)==0){
+      end=parseSearchWeekday(item+6, &term->weekday);
+    }else if(strncmp(item, "type=", 5)==0){
+      term->leap=(strncmp(item+5, "leap-", 5)==0);
+      if(term->leap || strncmp(item+5, "common-", 7)==0){
+        end=parseSearchWeekday(item+5+(term->leap ? 5 : 7), &term->weekday);
+        term->w53=0;
+        if(end!=NULL && strcasecmp(end, "-w53")==0){
+          term->w53=1;
+          end=end+4;
+        }
+      }
+    }else if(strncmp(item, "like=", 5)==0){
+      year=(int)strtol(item+5, &number, 10);
+      if(number!=item+5 && *number=='\0'){
+        term->leap=isLeapYear(year, opts);
+        term->weekday=getFirstWDMonth(JANUARY, year, opts);
+        end=number;
+      }
+    }else if(strncmp(item, "weeks=", 6)==0){
+      term->kind='w';
+      term->value=(int)strtol(item+6, &number, 10);
+      end=(term->value>=52 && term->value<=54) ? number : NULL;
+    }else{
+      //Counts : <weekday><day><op><n> or <weekday>@<month><op><n>
+      end=parseSearchWeekday(item, &term->weekday);
+      if(end!=NULL){
+        term->kind=(*end=='@') ? 'm' : 'd';
+        end=end+(*end=='@');
+        term->value=(int)strtol(end, &number, 10);
+        if(number==end || term->value<1 || term->value>((term->kind=='m') ? 12 : 31)){
+          end=NULL;
+        }else{
+          end=parseSearchCount(number, term);
+        }
+      }
+    }
+    
+    if(end==NULL || *end!='\0'){
+      return -1;
+    }
+  }
+  return (predicate->nbTerms>0) ? 0 : -1;
+}
+
+//Evaluate the terms which only depend of the year type
+static void evalSearchTypes(SearchPredicate* predicate){
+  SearchTerm* term;
+  int type, idx, count, leap, firstDay, result;
+  
+  initYearBits();
+  for(type=0; type<SEARCH_TYPES; type++){
+    leap=type/7;
+    firstDay=type%7;
+    result=1;
+    for(idx=0; idx<predicate->nbTerms && result; idx++){
+      term=&predicate->terms[idx];
+      if(term->kind=='t'){
+        result=(term->leap<0 || term->leap==leap) 
+               && (term->weekday<0 || term->weekday==firstDay);
+      }else if(term->kind=='w' && !weekRule.enabled){
+        //53 weeks : starting Thursday, or Wednesday for a leap year
+        //(week rule : depends of the previous and next years, see printSearch)
+        count=(firstDay==THURSDAY || (firstDay==WEDNESDAY && leap)) ? 53 : 52;
+        result=(count==term->value);
+      }else if(term->kind=='w'){
+        result=1;
+      }else{
+        if(term->kind=='d'){
+          count=countCommonDays(yearBits.weekdays[type][term->weekday], 
+                                yearBits.monthDays[leap][term->value-1]);
+        }else{
+          count=countCommonDays(yearBits.weekdays[type][term->weekday], 
+                                yearBits.months[leap][term->value-1]);
+        }
+        result=(term->op==SEARCH_OP_EQ && count==term->count)
+               || (term->op==SEARCH_OP_GE && count>=term->count)
+               || (term->op==SEARCH_OP_LE && count<=term->count);
+      }
+    }
+    predicate->match[type]=(char)result;
+  }
+}
+
+//Print the title of the years list (same than the years.txt files)
+static void printSearchTitle(const char* str, SearchPredicate* predicate){
+  SearchTerm* term=&predicate->terms[0];
+  
+  if(predicate->nbTerms==1 && term->kind=='t' && term->w53>=0){
+    outPrintf("| %s years starting %s%s |%s", yearTypes[term->leap], 
+              weekdays[term->weekday], (term->w53) ? "-W53" : "", endLine);
+  }else{
+    outPrintf("| Years : %s |%s", str, endLine);
+  }
+  outPrintf("| --- |%s", endLine);
+}
+
+//Print the years matching the predicate, return the number of years
+//(-format=md : the table of the years index, with the type of all years)
+static long long printSearch(const char* str, int yearFrom, int yearTo, char* opts){
+  SearchPredicate predicate;
+  YearWeeks weeks;
+  SearchTerm* term;
+  char dayLower[16];
+  long long found=0;
+  int year, type, leap, firstDay, w53, idx, result;
+  
+  if(parseSearchPredicate(str, &predicate, opts)!=0){
+    fprintf(stderr, "Invalid predicate%s", endLine);
+    return -1;
+  }
+  evalSearchTypes(&predicate);
+  
+  if(opts[OPT_IDX_FORMAT]==OPT_FORMAT_MD){
+    outPrintf("| Year | Type | 1st January |%s", endLine);
+    outPrintf("| ---- | ---- | ----------- |%s", endLine);
+  }else{
+    printSearchTitle(str, &predicate);
+  }
+  
+  for(year=yearFrom; year<=yearTo && year>0; year++){
+    leap=isLeapYear(year, opts);
+    firstDay=getFirstWDMonth(JANUARY, year, opts);
+    type=leap*7+firstDay;
+    if(!predicate.match[type]){
+      continue;
+    }
+    
+    //Saturday+W53 (depends of the previous year and of the week start),
+    //and the number of weeks with a week rule
+    w53=0;
+    if(firstDay==SATURDAY || weekRule.enabled){
+      initYearWeeks(year, opts, &weeks);
+      w53=(firstDay==SATURDAY && getYearWeekNumber(1, &weeks)==53);
+    }
+    result=1;
+    for(idx=0; idx<predicate.nbTerms && result; idx++){
+      term=&predicate.terms[idx];
+      if(term->kind=='w'){
+        result=(!weekRule.enabled || weeks.maxWeeks==term->value);
+      }else{
+        result=(term->kind!='t' || term->w53<0 || term->w53==w53);
+      }
+    }
+    if(!result){
+      continue;
+    }
+    
+    found++;
+    if(opts[OPT_IDX_FORMAT]==OPT_FORMAT_MD){
+      copyLower(dayLower, weekdays[firstDay], sizeof(dayLower));
+      outPrintf("| %d | %s | [%s%s](./%s/%s%s/index.txt) |%s", year, yearTypes[leap],
+                weekdays[firstDay], (w53) ? "-W53" : "", yearTypesLower[leap],
+                dayLower, (w53) ? "-w53" : "", endLine);
+    }else{
+      outPrintf("| %d |%s", year, endLine);
+    }
+  }
+  return found;
+}
+
+//Shards of a years table (-shard=<i>/<N> with -search : the part i of N of 
+//the years, in its own table), merged by -merge <file> <shards...> : the 
+//shards are ordered by their 1st year (not by the order of the files), 
+//so the result is the same on any host, checked by its checksum (-checksum)
+#define MERGE_HEADER_LINES  2
+
+typedef struct {
+  const char* fileName;
+  const char* text;
+  size_t size;
+  size_t rowsStart;           //after the lines of the header
+  long long firstYear;        //-1 : no years
+  long long lastYear;
+} YearsShard;
+
+//Parse a shard "<i>/<N>" (1<=i<=N), return 0 if OK
+static int parseShard(const char* str, int* shard, int* nbShards){
+  char* end;
+  long value=strtol(str, &end, 10);
+  
+  if(end==str || *end!='/' || value<1){
+    return -1;
+  }
+  *shard=(int)value;
+  str=end+1;
+  value=strtol(str, &end, 10);
+  if(end==str || *end!='\0' || value<*shard || value>100000){
+    return -1;
+  }
+  *nbShards=(int)value;
+  return 0;
+}
+
+//Set the years of a shard (a part of the years from..to, the same size)
+static void getShardYears(int shard, int nbShards, int* yearFrom, int* yearTo){
+  long long nbYears=(long long)*yearTo-*yearFrom+1;
+  long long from=*yearFrom;
+  
+  if(nbYears<=0){
+    return;
+  }
+  *yearFrom=(int)(from+nbYears*(shard-1)/nbShards);
+  *yearTo=(int)(from+nbYears*shard/nbShards-1);
+}
+
+//Return the year of a row ("| 1583 |..."), -1 if not a row of years
+static long long getRowYear(const char* row, size_t size){
+  long long year=0;
+  size_t c=2;
+  
+  if(size<3 || row[0]!='|' || row[1]!=' ' || row[2]<'0' || row[2]>'9'){
+    return -1;
+  }
+  for(; c<size && row[c]>='0' && row[c]<='9' && year<100000000; c++){
+    year=year*10+(row[c]-'0');
+  }
+  return (c<size && row[c]==' ') ? year : -1;
+}
+
+//Map a shard, and get its 1st and last years. Return 0 if OK
+static int mapYearsShard(const char* fileName, YearsShard* shard){
+  struct stat fileStat;
+  const char* newLine;
+  size_t start, lastStart;
+  int line, fd=open(fileName, O_RDONLY);
+  
+  memset(shard, 0, sizeof(YearsShard));
+  shard->fileName=fileName;
+  if(fd<0 || fstat(fd, &fileStat)!=0 || fileStat.st_size==0){
+    if(fd>=0){
+      close(fd);
+    }
+    return -1;
+  }
+  shard->text=mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(shard->text==MAP_FAILED){
+    shard->text=NULL;
+    return -1;
+  }
+  shard->size=fileStat.st_size;
+  if(shard->text[shard->size-1]!='\n'){
+    return -1;
+  }
+  
+  //Header
+  for(line=0, start=0; line<MERGE_HEADER_LINES; line++){
+    newLine=memchr(shard->text+start, '\n', shard->size-start);
+    if(newLine==NULL){
+      return -1;
+    }
+    start=newLine-shard->text+1;
+  }
+  shard->rowsStart=start;
+  shard->firstYear=-1;
+  shard->lastYear=-1;
+  if(start==shard->size){
+    return 0;
+  }
+  
+  //1st and last rows
+  for(lastStart=shard->size-1; lastStart>start && shard->text[lastStart-1]!='\n'; 
+      lastStart--){
+  }
+  shard->firstYear=getRowYear(shard->text+start, shard->size-start);
+  shard->lastYear=getRowYear(shard->text+lastStart, shard->size-lastStart);
+  return (shard->firstYear>=0 && shard->lastYear>=shard->firstYear) ? 0 : -1;
+}
+
+//Compare the shards : by 1st year, the empty ones at the end
+static int compareShards(const void* shardA, const void* shardB){
+  const YearsShard* a=shardA;
+  const YearsShard* b=shardB;
+  
+  if(a->firstYear!=b->firstYear){
+    if(a->firstYear<0 || b->firstYear<0){
+      return (a->firstYear<0) ? 1 : -1;
+    }
+    return (a->firstYear<b->firstYear) ? -1 : 1;
+  }
+  return strcmp(a->fileName, b->fileName);
+}
+
+//Print the checksum of a file (FNV-1a of all its bytes)
+static int printChecksum(const char* fileName){
+  char buffer[65536];
+  unsigned long long hash=hashChunk(NULL, 0);
+  ssize_t size;
+  int fd=open(fileName, O_RDONLY);
+  
+  if(fd<0){
+    fprintf(stderr, "Cannot read %s%s", fileName, endLine);
+    return -1;
+  }
+  while((size=read(fd, buffer, sizeof(buffer)))!=0){
+    if(size<0 && errno==EINTR){
+      continue;
+    }
+    if(size<0){
+      close(fd);
+      fprintf(stderr, "Cannot read %s%s", fileName, endLine);
+      return -1;
+    }
+    hash=addHash(hash, buffer, size);
+  }
+  close(fd);
+  outPrintf("%016llx  %s%s", hash, fileName, endLine);
+  return 0;
+}
+
+//Merge the shards of a years table, then print the checksum of the table
+//Return 0 if OK
+static int mergeShards(const char* fileName, char** shardNames, int nbShards){
+  YearsShard* shards=calloc(nbShards+1, sizeof(YearsShard));
+  char tmpName[PACK_PATH_SIZE];
+  struct iovec fragment;
+  unsigned long long hash=hashChunk(NULL, 0);
+  int idx, fd=-1, result=(shards==NULL || nbShards<1) ? -1 : 0;
+  
+  for(idx=0; idx<nbShards && result==0; idx++){
+    if(mapYearsShard(shardNames[idx], &shards[idx])!=0){
+      fprintf(stderr, "Invalid shard %s%s", shardNames[idx], endLine);
+      result=-1;
+    }else if(shards[idx].rowsStart!=shards[0].rowsStart 
+             || memcmp(shards[idx].text, shards[0].text, shards[0].rowsStart)!=0){
+      fprintf(stderr, "Not the same table : %s%s", shardNames[idx], endLine);
+      result=-1;
+    }
+  }
+  
+  //The years of a shard are after the years of the previous one
+  if(result==0){
+    qsort(shards, nbShards, sizeof(YearsShard), compareShards);
+    for(idx=1; idx<nbShards && shards[idx].firstYear>=0; idx++){
+      if(shards[idx].firstYear<=shards[idx-1].lastYear){
+        fprintf(stderr, "Overlapping shards : %s %s%s", shards[idx-1].fileName, 
+                shards[idx].fileName, endLine);
+        result=-1;
+        break;
+      }
+    }
+  }
+  
+  //Header, then the rows of each shard
+  if(result==0){
+    snprintf(tmpName, sizeof(tmpName), "%s.%ld", fileName, (long)getpid());
+    fd=open(tmpName, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+    result=(fd<0) ? -1 : 0;
+  }
+  for(idx=-1; idx<nbShards && result==0; idx++){
+    if(idx<0){
+      fragment.iov_base=(void*)shards[0].text;
+      fragment.iov_len=shards[0].rowsStart;
+    }else{
+      fragment.iov_base=(void*)(shards[idx].text+shards[idx].rowsStart);
+      fragment.iov_len=shards[idx].size-shards[idx].rowsStart;
+    }
+    hash=addHash(hash, fragment.iov_base, fragment.iov_len);
+    result=writeFragments(fd, &fragment, 1);
+  }
+  if(fd>=0){
+    if(close(fd)!=0 || result!=0 || rename(tmpName, fileName)!=0){
+      fprintf(stderr, "Cannot write %s%s", fileName, endLine);
+      unlink(tmpName);
+      result=-1;
+    }
+  }
+  
+  for(idx=0; shards!=NULL && idx<nbShards; idx++){
+    if(shards[idx].text!=NULL){
+      munmap((void*)shards[idx].text, shards[idx].size);
+    }
+  }
+  free(shards);
+  if(result==0){
+    outPrintf("%016llx  %s%s", hash, fileName, endLine);
+  }
+  return result;
+}
+
+//print the statistics (on stderr, to keep the calendar output clean)
+static void printStats(char* opts){
+#ifdef CAL_STATS
+  int idx;
+  outFlush();
+  if(opts[OPT_IDX_STATS]==OPT_STATS_JSON){
+    fprintf(stderr, "{");
+    for(idx=0; idx<STATS_NB; idx++){
+      fprintf(stderr, "\"%s\": %llu", statsStr[idx], stats[idx]);
+      if(idx<STATS_NB-1){
+        fprintf(stderr, ", ");
+      }
+    }
+    fprintf(stderr, "}%s", endLine);
+  }else{
+    for(idx=0; idx<STATS_NB; idx++){
+      fprintf(stderr, "%-28s %llu%s", statsStr[idx], stats[idx], endLine);
+    }
+  }
+#else
+  (void)opts;
+  (void)statsStr;
+  fprintf(stderr, "No statistics : build with -DCAL_STATS%s", endLine);
+#endif
+}
+
+//Check the properties of the dates, from year yearFrom to yearTo :
+//- weekday continuity (between days, months and years)
+//- day of the year + days left = days in the year
+//- week numbers : same week until the first day of week, then +1 (or W01)
+//Return the number of failures (0 : OK)
+static int checkDates(int yearFrom, int yearTo, char* opts){
+  int year, month, day, daysInMonth, daysInYear;
+  int weekday, previousWeekday=-1;
+  int weekNumber, previousWeekNumber=-1;
+  int dayOfYear, daysLeft;
+  int firstWD=opts[OPT_IDX_FIRSTWD]-'0';
+  int failures=0;
+  long nbDays=0;
+  CalIterator iterator;
+  DayRecord record;
+  
+  //The iterator gives the same values, day after day
+  initCalIterator(&iterator, 1, JANUARY, yearFrom, 31, DECEMBER, yearTo, opts);
+  
+  for(year=yearFrom; year<=yearTo; year++){
+    daysInYear=getDaysInfYear(year, opts);
+    
+    //Default calculation : the days removed by the Gregorian calendar
+    //are between the Julian and the Gregorian years
+    if(year==GREGORIAN_START_YEAR+1 && opts[OPT_IDX_LYC]==OPT_LYC_DEFAULT){
+      previousWeekday=-1;
+      previousWeekNumber=-1;
+    }
+    if(daysInYear!=365+isLeapYear(year, opts)){
+      fprintf(stderr, "check: days in year %d : %d%s", year, daysInYear, endLine);
+      failures++;
+    }
+    
+    for(month=JANUARY; month<=DECEMBER; month++){
+      daysInMonth=getDaysPerMonth(month, year, opts);
+      weekday=getFirstWDMonth(month, year, opts);
+      
+      for(day=1; day<=daysInMonth; day++){
+        nbDays++;
+        
+        //Weekday continuity
+        if(previousWeekday>=0 && weekday!=changeWeekDay(previousWeekday, 1)){
+          fprintf(stderr, "check: weekday %d/%d/%d%s", day, month+1, year, endLine);
+          failures++;
+        }
+        if(getWeekDay(day, month, year, opts)!=weekday){
+          fprintf(stderr, "check: getWeekDay %d/%d/%d%s", day, month+1, year, endLine);
+          failures++;
+        }
+        
+        //Day of the year + days left
+        dayOfYear=getDayOfYear(day, month, year, opts);
+        daysLeft=daysInYear-dayOfYear;
+        if(dayOfYear<1 || daysLeft<0 || dayOfYear+daysLeft!=daysInYear
+           || (month==JANUARY && day==1 && dayOfYear!=1)){
+          fprintf(stderr, "check: day of year %d/%d/%d%s", day, month+1, year, endLine);
+          failures++;
+        }
+        
+        //Week numbers
+        weekNumber=getWeekNumber(day, month, year, opts);
+        if(weekNumber<1 || weekNumber>53+weekRule.split){
+          fprintf(stderr, "check: week number %d/%d/%d%s", day, month+1, year, endLine);
+          failures++;
+        }else if(previousWeekNumber>0){
+          if(weekday==firstWD){
+            //A new week : next number, or the 1st week
+            if(weekNumber!=previousWeekNumber+1 && weekNumber!=1){
+              fprintf(stderr, "check: new week %d/%d/%d%s", day, month+1, year, endLine);
+              failures++;
+            }
+          }else if(weekNumber!=previousWeekNumber 
+                   && !(weekRule.split && month==JANUARY && day==1 && weekNumber==1)){
+            //Same week : same number (or a split week rule : week 1)
+            fprintf(stderr, "check: same week %d/%d/%d%s", day, month+1, year, endLine);
+            failures++;
+          }
+        }
+        
+        //Iterator
+        if(yearFrom>0 && (!nextCalDay(&iterator, &record) || record.day!=day 
+           || record.month!=month || record.year!=year || record.weekday!=weekday
+           || record.dayOfYear!=dayOfYear || record.daysLeft!=daysLeft 
+           || record.weekNumber!=weekNumber || record.leap!=isLeapYear(year, opts)
+           || record.dayNumber!=getJulianDayNumber(day, month, year, opts))){
+          fprintf(stderr, "check: iterator %d/%d/%d%s", day, month+1, year, endLine);
+          failures++;
+        }
+        
+        previousWeekday=weekday;
+        previousWeekNumber=weekNumber;
+        weekday=changeWeekDay(weekday, 1);
+      }
+    }
+  }
+  
+  fprintf(stderr, "check: %ld days, %d failures%s", nbDays, failures, endLine);
+  return (failures>0);
+}
+
+//Epoch conversion (-epoch) : Unix timestamps (seconds) to dates,
+//converted by blocks of values
+#define EPOCH_BLOCK          4096
+#define EPOCH_MAX_SECONDS    (1LL<<46)  //~2 million years
+#define EPOCH_MARCH_SHIFT    719468     //days from 01/03/0000 to 01/01/1970
+#define EPOCH_JULIAN_SHIFT   719470     //same, from the Julian 01/03/0000
+#define EPOCH_READ_SIZE      65536
+#define EPOCH_YEARS_CACHE    64         //week numbers of the years (power of 2)
+
+//Dates of a block of timestamps (one array per field)
+typedef struct {
+  long long days[EPOCH_BLOCK];   //days since 01/01/1970
+  int year[EPOCH_BLOCK];
+  int month[EPOCH_BLOCK];        //1-12
+  int day[EPOCH_BLOCK];
+  int weekday[EPOCH_BLOCK];
+  int dayOfYear[EPOCH_BLOCK];
+  int weekNumber[EPOCH_BLOCK];
+} EpochDates;
+
+static EpochDates epochDates;
+
+//Return the 1st day (since 1970) using the Gregorian calendar
+static long long getEpochGregorianStart(char* opts){
+  return getGregorianStartDayNumber(opts)-EPOCH_JDN;
+}
+
+//Convert timestamps to dates, with the calendar rules of the options
+//(the timestamps must be in -EPOCH_MAX_SECONDS..EPOCH_MAX_SECONDS)
+static void convertEpochs(const long long* timestamps, int count, 
+                          EpochDates* dates, char* opts){
+  long long gregorianStart=getEpochGregorianStart(opts);
+  long long days, era, dayOfEra, yearOfEra, dayOfYearG, dayOfYearJ, yearG, yearJ;
+  long long gregorian, dayOfYear, monthShift, year, month, leapDay;
+  static YearWeeks epochYears[EPOCH_YEARS_CACHE];
+  char yearsReady[EPOCH_YEARS_CACHE];
+  YearWeeks* weeks;
+  int i;
+  
+  //Civil dates : no branch, the Gregorian and the Julian dates are both
+  //calculated (from the 1st March, leap day at the end), then selected
+  for(i=0; i<count; i++){
+    days=timestamps[i]/86400-(timestamps[i]%86400<0);
+    dates->days[i]=days;
+    
+    //Gregorian : eras of 400 years (146097 days)
+    era=(days+EPOCH_MARCH_SHIFT-(days+EPOCH_MARCH_SHIFT<0)*146096)/146097;
+    dayOfEra=days+EPOCH_MARCH_SHIFT-era*146097;
+    yearOfEra=(dayOfEra-dayOfEra/1460+dayOfEra/36524-dayOfEra/146096)/365;
+    dayOfYearG=dayOfEra-(365*yearOfEra+yearOfEra/4-yearOfEra/100);
+    yearG=yearOfEra+era*400;
+    
+    //Julian : eras of 4 years (1461 days)
+    era=(days+EPOCH_JULIAN_SHIFT-(days+EPOCH_JULIAN_SHIFT<0)*1460)/1461;
+    dayOfEra=days+EPOCH_JULIAN_SHIFT-era*1461;
+    yearOfEra=(dayOfEra-dayOfEra/1460)/365;
+    dayOfYearJ=dayOfEra-365*yearOfEra;
+    yearJ=yearOfEra+era*4;
+    
+    gregorian=(days>=gregorianStart);
+    year=yearJ+gregorian*(yearG-yearJ);
+    dayOfYear=dayOfYearJ+gregorian*(dayOfYearG-dayOfYearJ);
+    
+    //Month and day (from March), back to January
+    monthShift=(5*dayOfYear+2)/153;
+    month=monthShift+3-12*(monthShift>=10);
+    year=year+(month<=2);
+    leapDay=((year%4==0) & ((year%100!=0) | (year%400==0) | !gregorian));
+    dates->year[i]=(int)year;
+    dates->month[i]=(int)month;
+    dates->day[i]=(int)(dayOfYear-(153*monthShift+2)/5+1);
+    dates->dayOfYear[i]=(int)((month<=2)*(dayOfYear-305)
+                              +(month>2)*(dayOfYear+60+leapDay));
+    dates->weekday[i]=(int)(((days+THURSDAY)%7+7)%7);
+  }
+  
+  //Week numbers : the values of the years are kept in a small cache
+  //(reset for each block, the options may change)
+  memset(yearsReady, 0, sizeof(yearsReady));
+  for(i=0; i<count; i++){
+    weeks=&epochYears[dates->year[i]&(EPOCH_YEARS_CACHE-1)];
+    year=dates->year[i]&(EPOCH_YEARS_CACHE-1);
+    if(!yearsReady[year] || weeks->year!=dates->year[i]){
+      initYearWeeks(dates->year[i], opts, weeks);
+      yearsReady[year]=1;
+    }
+    dates->weekNumber[i]=getYearWeekNumber(dates->dayOfYear[i], weeks);
+  }
+}
+
+//Write an integer in a string, return the end of the string
+static char* formatInt(char* str, long long value, int minDigits){
+  char digits[24];
+  int nbDigits=0;
+  unsigned long long absValue=(unsigned long long)value;
+  
+  if(value<0){
+    *str++='-';
+    absValue=-absValue;
+  }
+  do{
+    digits[nbDigits++]=(char)('0'+absValue%10);
+    absValue=absValue/10;
+  }while(absValue>0);
+  while(nbDigits<minDigits){
+    digits[nbDigits++]='0';
+  }
+  while(nbDigits>0){
+    *str++=digits[--nbDigits];
+  }
+  return str;
+}
+
+//Print the dates of timestamps : "timestamp,date,weekday,week,dayOfYear"
+//(the fields are empty if the timestamp is out of the limits)
+static void printEpochs(const long long* timestamps, int count, char* opts){
+  static long long values[EPOCH_BLOCK];
+  static char valid[EPOCH_BLOCK];
+  char line[128];
+  char* str;
+  int i;
+  
+  //The timestamps out of the limits are converted as 0
+  for(i=0; i<count; i++){
+    valid[i]=(timestamps[i]>-EPOCH_MAX_SECONDS && timestamps[i]<EPOCH_MAX_SECONDS);
+    values[i]=timestamps[i]*valid[i];
+  }
+  convertEpochs(values, count, &epochDates, opts);
+  
+  for(i=0; i<count; i++){
+    str=formatInt(line, timestamps[i], 1);
+    *str++=',';
+    if(valid[i]){
+      str=formatInt(str, epochDates.year[i], 4);
+      *str++='-';
+      str=formatInt(str, epochDates.month[i], 2);
+      *str++='-';
+      str=formatInt(str, epochDates.day[i], 2);
+      *str++=',';
+      strcpy(str, weekdays[epochDates.weekday[i]]);
+      str=str+strlen(str);
+      *str++=',';
+      *str++='W';
+      str=formatInt(str, epochDates.weekNumber[i], 2);
+      *str++=',';
+      str=formatInt(str, epochDates.dayOfYear[i], 1);
+    }else{
+      strcpy(str, ",,,");
+      str=str+strlen(str);
+    }
+    *str++='\n';
+    outWrite(line, str-line);
+  }
+}
+
+//Time scales (-timescale=<from>,<to> with -epoch) : UTC, TAI, TT and UT
+//(UT1), in seconds since 01/01/1970 of the scale. The leap seconds are 
+//embedded (TAI-UTC since 1972), TT=TAI+32.184s, and TT-UT (Delta T) uses
+//the polynomials of Espenak and Meeus (UTC is taken as UT before 1972)
+#define TIMESCALE_UTC      0
+#define TIMESCALE_TAI      1
+#define TIMESCALE_TT       2
+#define TIMESCALE_UT       3
+#define TIMESCALE_NB       4
+#define TT_TAI_MS          32184        //TT-TAI, in milliseconds
+#define LEAP_SECONDS_NB    28
+#define DELTA_T_RANGES     15
+#define SECONDS_PER_YEAR   31556952.0   //mean Gregorian year
+
+static const char* timeScales[TIMESCALE_NB]={"utc", "tai", "tt", "ut"};
+
+//Start of each TAI-UTC value (UTC seconds since 01/01/1970), TAI-UTC=10+idx
+static const long long leapSeconds[LEAP_SECONDS_NB]={
+  63072000LL,   78796800LL,   94694400LL,   126230400LL,  157766400LL,
+  189302400LL,  220924800LL,  252460800LL,  283996800LL,  315532800LL,
+  362793600LL,  394329600LL,  425865600LL,  489024000LL,  567993600LL,
+  631152000LL,  662688000LL,  709948800LL,  741484800LL,  773020800LL,
+  820454400LL,  867715200LL,  915148800LL,  1136073600LL, 1230768000LL,
+  1341100800LL, 1435708800LL, 1483228800LL
+};
+
+//Delta T polynomial on a range of years : t=(year-origin)/scale
+typedef struct {
+  double startYear;
+  double origin;
+  double scale;
+  double coefs[8];    //coefficients of t^0 to t^7
+} DeltaTRange;
+
+static const DeltaTRange deltaTRanges[DELTA_T_RANGES]={
+  {-1e9,  1820, 100, {-20, 0, 32}},
+  {-500,  0,    100, {10583.6, -1014.41, 33.78311, -5.952053, -0.1798452,
+                      0.022174192, 0.0090316521}},
+  {500,   1000, 100, {1574.2, -556.01, 71.23472, 0.319781, -0.8503463,
+                      -0.005050998, 0.0083572073}},
+  {1600,  1600, 1,   {120, -0.9808, -0.01532, 1.0/7129}},
+  {1700,  1700, 1,   {8.83, 0.1603, -0.0059285, 0.00013336, -1.0/1174000}},
+  {1800,  1800, 1,   {13.72, -0.332447, 0.0068612, 0.0041116, -0.00037436,
+                      0.0000121272, -0.0000001699, 0.000000000875}},
+  {1860,  1860, 1,   {7.62, 0.5737, -0.251754, 0.01680668, -0.0004473624,
+                      1.0/233174}},
+  {1900,  1900, 1,   {-2.79, 1.494119, -0.0598939, 0.0061966, -0.000197}},
+  {1920,  1920, 1,   {21.20, 0.84493, -0.076100, 0.0020936}},
+  {1941,  1950, 1,   {29.07, 0.407, -1.0/233, 1.0/2547}},
+  {1961,  1975, 1,   {45.45, 1.067, -1.0/260, -1.0/718}},
+  {1986,  2000, 1,   {63.86, 0.3345, -0.060374, 0.0017275, 0.000651814,
+                      0.00002373599}},
+  {2005,  2000, 1,   {62.92, 0.32217, 0.005589}},
+  //2050-2150 : the parabola, with a correction to join the measures
+  {2050,  1820, 100, {-20-0.5628*(2150-1820), 0.5628*100, 32}},
+  {2150,  1820, 100, {-20, 0, 32}}
+};
+
+//Return Delta T (TT-UT, seconds) of a decimal year
+static double getDeltaT(double year){
+  const DeltaTRange* range;
+  double t, value=0;
+  int idx, coef;
+  
+  for(idx=DELTA_T_RANGES-1; idx>0 && year<deltaTRanges[idx].startYear; idx--){
+  }
+  range=&deltaTRanges[idx];
+  t=(year-range->origin)/range->scale;
+  for(coef=7; coef>=0; coef--){
+    value=value*t+range->coefs[coef];
+  }
+  return value;
+}
+
+//Return the index of the TAI-UTC value (-1 : before 1972), the times are
+//the UTC starts (tai=0), or the TAI starts (tai=1)
+static int getLeapSecondIdx(long long seconds, int tai){
+  int base=0, size=LEAP_SECONDS_NB, half;
+  
+  //Binary search, without branches
+  while(size>1){
+    half=size/2;
+    base=(leapSeconds[base+half]+tai*(10+base+half)<=seconds) ? base+half : base;
+    size=size-half;
+  }
+  return (leapSeconds[base]+tai*(10+base)<=seconds) ? base : -1;
+}
+
+//Convert times from a scale to another, in milliseconds (by arrays : TT, 
+//then the scale asked)
+static void convertTimeScales(const long long* seconds, long long* millis, 
+                              int count, int from, int to){
+  static double deltaT[EPOCH_BLOCK];
+  long long tai;
+  int i, idx;
+  
+  //Delta T of the times (only needed for the UT, and before 1972)
+  for(i=0; i<count; i++){
+    deltaT[i]=(from==TIMESCALE_UT || to==TIMESCALE_UT || seconds[i]<leapSeconds[0]+86400)
+              ? getDeltaT(1970.0+seconds[i]/SECONDS_PER_YEAR)*1000.0 : 0;
+  }
+  
+  //To TT
+  for(i=0; i<count; i++){
+    millis[i]=seconds[i]*1000;
+    if(from==TIMESCALE_TAI){
+      millis[i]=millis[i]+TT_TAI_MS;
+    }else if(from==TIMESCALE_UT){
+      millis[i]=millis[i]+llround(deltaT[i]);
+    }else if(from==TIMESCALE_UTC){
+      idx=getLeapSecondIdx(seconds[i], 0);
+      millis[i]=millis[i]+((idx<0) ? llround(deltaT[i]) : (10+idx)*1000LL+TT_TAI_MS);
+    }
+  }
+  
+  //From TT
+  for(i=0; i<count; i++){
+    if(to==TIMESCALE_TAI){
+      millis[i]=millis[i]-TT_TAI_MS;
+    }else if(to==TIMESCALE_UT){
+      millis[i]=millis[i]-llround(deltaT[i]);
+    }else if(to==TIMESCALE_UTC){
+      tai=millis[i]-TT_TAI_MS;
+      idx=getLeapSecondIdx((tai>=0) ? tai/1000 : -((-tai+999)/1000), 1);
+      millis[i]=(idx<0) ? millis[i]-llround(deltaT[i]) : tai-(10+idx)*1000LL;
+    }
+  }
+}
+
+//Write milliseconds as seconds (3 decimals), return the end of the string
+static char* formatMillis(char* str, long long millis){
+  unsigned long long absValue=(millis<0) ? -(unsigned long long)millis 
+                                         : (unsigned long long)millis;
+  
+  if(millis<0){
+    *str++='-';
+  }
+  str=formatInt(str, (long long)(absValue/1000), 1);
+  *str++='.';
+  return formatInt(str, (long long)(absValue%1000), 3);
+}
+
+//Print timestamps converted to another time scale : "time,converted"
+static void printTimeScales(const long long* timestamps, int count, int from, int to){
+  static long long millis[EPOCH_BLOCK];
+  char line[64];
+  char* str;
+  int i;
+  
+  convertTimeScales(timestamps, millis, count, from, to);
+  for(i=0; i<count; i++){
+    str=formatInt(line, timestamps[i], 1);
+    *str++=',';
+    str=formatMillis(str, millis[i]);
+    *str++='\n';
+    outWrite(line, str-line);
+  }
+}
+
+//Parse the scales "<from>,<to>", return 0 if valid
+static int parseTimeScales(const char* str, int* from, int* to){
+  const char* comma=strchr(str, ',');
+  int idx;
+  
+  *from=-1;
+  *to=-1;
+  for(idx=0; idx<TIMESCALE_NB && comma!=NULL; idx++){
+    if((size_t)(comma-str)==strlen(timeScales[idx]) 
+       && strncmp(str, timeScales[idx], comma-str)==0){
+      *from=idx;
+    }
+    if(strcmp(comma+1, timeScales[idx])==0){
+      *to=idx;
+    }
+  }
+  return (*from>=0 && *to>=0) ? 0 : -1;
+}
+
+//Print the leap seconds ("YYYY-MM-DD,TAI-UTC"), and Delta T of the years
+//("year,deltaT")
+static void printLeapSeconds(int yearFrom, int yearTo){
+  int idx, year;
+  long long days, era, dayOfEra, yearOfEra, dayOfYear, month;
+  
+  if(yearTo<yearFrom){
+    for(idx=0; idx<LEAP_SECONDS_NB; idx++){
+      //Days since 01/03/0000 (the Gregorian civil date)
+      days=leapSeconds[idx]/86400+EPOCH_MARCH_SHIFT;
+      era=days/146097;
+      dayOfEra=days-era*146097;
+      yearOfEra=(dayOfEra-dayOfEra/1460+dayOfEra/36524-dayOfEra/146096)/365;
+      dayOfYear=dayOfEra-(365*yearOfEra+yearOfEra/4-yearOfEra/100);
+      month=(5*dayOfYear+2)/153;
+      outPrintf("%04lld-%02lld-%02lld,%d%s", era*400+yearOfEra+(month>=10), 
+                (month<10) ? month+3 : month-9, dayOfYear-(153*month+2)/5+1, 
+                10+idx, endLine);
+    }
+    return;
+  }
+  for(year=yearFrom; year<=yearTo; year++){
+    outPrintf("%d,%.1f%s", year, getDeltaT(year+0.5), endLine);
+  }
+}
+
+//Read the timestamps of a text (separated by any other character)
+//The number at the end is not read if more text is expected (!last)
+//Return the number of values, *used : number of characters read
+static int parseEpochs(const char* text, size_t size, int last, 
+                       long long* values, int max, size_t* used){
+  size_t c=0, start;
+  int count=0;
+  long long value;
+  int negative;
+  
+  while(c<size && count<max){
+    //Skip the separators
+    if(text[c]!='-' && (text[c]<'0' || text[c]>'9')){
+      c++;
+      continue;
+    }
+    
+    //Read the number (saturated, out of the limits if too long)
+    start=c;
+    negative=(text[c]=='-');
+    c=c+negative;
+    value=0;
+    while(c<size && text[c]>='0' && text[c]<='9'){
+      if(value<EPOCH_MAX_SECONDS){
+        value=value*10+(text[c]-'0');
+      }
+      c++;
+    }
+    if(c==size && !last){
+      //Maybe not the full number
+      c=start;
+      break;
+    }
+    if(c>start+negative){
+      values[count++]=(negative) ? -value : value;
+    }
+  }
+  
+  *used=c;
+  return count;
+}
+
+static int timeScaleFrom=-1;   //-timescale : scales converted (-1 : dates)
+static int timeScaleTo=-1;
+
+//Print a block of timestamps : dates, or another time scale
+static void printEpochBlock(const long long* timestamps, int count, char* opts){
+  if(timeScaleFrom>=0){
+    printTimeScales(timestamps, count, timeScaleFrom, timeScaleTo);
+  }else{
+    printEpochs(timestamps, count, opts);
+  }
+}
+
+//Dates (-dates) : lines of ISO 8601 dates ("YYYY-MM-DD", week dates 
+//"YYYY-Www-D", ordinal dates "YYYY-DDD") or RFC 3339 timestamps 
+//("YYYY-MM-DDThh:mm:ss[.fraction](Z|+hh:mm)"), converted to timestamps
+//(UTC) and printed as -epoch, with the errors by line and column
+#define DATES_ONES        0x0101010101010101ULL
+
+//State of the lines read
+typedef struct {
+  long long line;
+  long long errors;
+  int skip;             //rest of a too long line
+  char* opts;
+} DatesState;
+
+static DatesState datesState;
+
+//Check the 8 characters "YYYY-MM-" at once : xor the pattern, then the
+//digits must be below 10 (+0x76 sets no high bit) and the '-' must be 0
+//(+0x7F sets no high bit)
+static int isDatePrefix(const char* text){
+  static const char pattern[8]={'0', '0', '0', '0', '-', '0', '0', '-'};
+  static const unsigned char limits[8]={0x76, 0x76, 0x76, 0x76, 0x7F, 0x76, 0x76, 0x7F};
+  unsigned long long word, mask, limit;
+  
+  memcpy(&word, text, 8);
+  memcpy(&mask, pattern, 8);
+  memcpy(&limit, limits, 8);
+  word=word^mask;
+  return ((word|(word+limit))&(0x80*DATES_ONES))==0;
+}
+
+//Read a number of count digits, return the number of digits read
+static size_t readDateNumber(const char* text, size_t size, size_t count, int* value){
+  size_t c;
+  
+  *value=0;
+  for(c=0; c<count && c<size && text[c]>='0' && text[c]<='9'; c++){
+    *value=*value*10+(text[c]-'0');
+  }
+  return c;
+}
+
+//Return the 1st day (Monday) of the ISO week 1 of a year
+static long long getIsoWeekStart(int year, char* opts){
+  long long dayNumber=getJulianDayNumber(4, JANUARY, year, opts);
+  
+  return dayNumber-(getWeekDayOfDayNumber(dayNumber)+6)%7;
+}
+
+//Parse the time of a timestamp "hh:mm:ss[.fraction](Z|+hh:mm)"
+//Return 0 and the seconds (UTC shift), or the column of the error
+static size_t parseDateTime(const char* text, size_t size, size_t c, long long* seconds){
+  int hour, minute, second, offsetHour, offsetMinute;
+  size_t n;
+  
+  if((n=readDateNumber(text+c, size-c, 2, &hour))<2 || hour>23){
+    return c+n+1-(n==2);
+  }
+  if(c+2>=size || text[c+2]!=':'){
+    return c+3;
+  }
+  if((n=readDateNumber(text+c+3, size-c-3, 2, &minute))<2 || minute>59){
+    return c+n+4-(n==2);
+  }
+  if(c+5>=size || text[c+5]!=':'){
+    return c+6;
+  }
+  //(60 : leap second)
+  if((n=readDateNumber(text+c+6, size-c-6, 2, &second))<2 || second>60){
+    return c+n+7-(n==2);
+  }
+  c=c+8;
+  
+  //Fraction : dropped (the time is rounded down)
+  if(c<size && text[c]=='.'){
+    for(n=c+1; n<size && text[n]>='0' && text[n]<='9'; n++);
+    if(n==c+1){
+      return c+2;
+    }
+    c=n;
+  }
+  *seconds=hour*3600+minute*60+second;
+  
+  //Offset
+  if(c<size && (text[c]=='Z' || text[c]=='z')){
+    return (c+1==size) ? 0 : c+2;
+  }
+  if(c>=size || (text[c]!='+' && text[c]!='-')){
+    return c+1;
+  }
+  if((n=readDateNumber(text+c+1, size-c-1, 2, &offsetHour))<2 || offsetHour>23){
+    return c+n+2-(n==2);
+  }
+  if(c+3>=size || text[c+3]!=':'){
+    return c+4;
+  }
+  if((n=readDateNumber(text+c+4, size-c-4, 2, &offsetMinute))<2 || offsetMinute>59){
+    return c+n+5-(n==2);
+  }
+  if(c+6!=size){
+    return c+7;
+  }
+  *seconds=*seconds-((text[c]=='-') ? -1 : 1)*(offsetHour*3600+offsetMinute*60);
+  return 0;
+}
+
+//Parse a line (date or timestamp), with the calendar rules of the options
+//Return 0 and the timestamp, or the column of the error
+static size_t parseDateLine(const char* text, size_t size, long long* timestamp, 
+                            char* opts){
+  int year, month, day, week, weekday, days;
+  long long dayNumber, seconds=0;
+  size_t c, n;
+  
+  //Year (0001-9999) and month : the common dates, at once
+  if(size>=8 && isDatePrefix(text)){
+    year=(text[0]-'0')*1000+(text[1]-'0')*100+(text[2]-'0')*10+(text[3]-'0');
+    month=(text[5]-'0')*10+(text[6]-'0');
+    c=8;
+  }else{
+    if((n=readDateNumber(text, size, 4, &year))<4){
+      return n+1;
+    }
+    if(size<=4 || text[4]!='-'){
+      return 5;
+    }
+    month=-1;
+    c=5;
+  }
+  if(year<1){
+    return 1;
+  }
+  
+  if(month<0 && c<size && text[c]=='W'){
+    //Week date : weeks from the Monday of the week of the 4th January
+    if((n=readDateNumber(text+6, size-6, 2, &week))<2){
+      return n+7;
+    }
+    dayNumber=getIsoWeekStart(year, opts);
+    if(week<1 || (long long)week*7>getIsoWeekStart(year+1, opts)-dayNumber){
+      return 7;
+    }
+    if(size<=8 || text[8]!='-'){
+      return 9;
+    }
+    if(readDateNumber(text+9, size-9, 1, &weekday)<1 || weekday<1 || weekday>7){
+      return 10;
+    }
+    dayNumber=dayNumber+(week-1)*7+weekday-1;
+    c=10;
+  }else if(month<0 && size>=8 && readDateNumber(text+5, 3, 3, &day)==3){
+    //Ordinal date
+    if(day<1 || day>getDaysInfYear(year, opts)){
+      return 6;
+    }
+    dayNumber=getJulianDayNumber(1, JANUARY, year, opts)+day-1;
+    c=8;
+  }else{
+    //Calendar date
+    if(month<0){
+      if((n=readDateNumber(text+5, size-5, 2, &month))<2){
+        return n+6;
+      }
+      if(size<=7 || text[7]!='-'){
+        return 8;
+      }
+    }
+    if(month<1 || month>12){
+      return 6;
+    }
+    if((n=readDateNumber(text+8, size-8, 2, &day))<2){
+      return n+9;
+    }
+    days=getDaysPerMonth(month-1, year, opts);
+    if(day<1 || day>days){
+      return 9;
+    }
+    dayNumber=getJulianDayNumber(day, month-1, year, opts);
+    c=10;
+  }
+  
+  //Time (RFC 3339 : 'T' or a space)
+  if(c<size){
+    if(text[c]!='T' && text[c]!='t' && text[c]!=' '){
+      return c+1;
+    }
+    n=parseDateTime(text, size, c+1, &seconds);
+    if(n>0){
+      return n;
+    }
+  }
+  *timestamp=(dayNumber-EPOCH_JDN)*86400+seconds;
+  return 0;
+}
+
+//Read the dates of a text (one per line, the empty lines are skipped)
+//The line at the end is not read if more text is expected (!last)
+//Return the number of values, *used : number of characters read
+static int parseDates(const char* text, size_t size, int last, 
+                      long long* values, int max, size_t* used){
+  const char* end;
+  size_t c=0, next, length, column;
+  int count=0;
+  
+  while(c<size && count<max){
+    end=memchr(text+c, '\n', size-c);
+    if(end==NULL && !last){
+      //Maybe not the full line, unless it fills the buffer
+      if(c>0 || size<EPOCH_READ_SIZE){
+        break;
+      }
+      datesState.line++;
+      datesState.errors++;
+      fprintf(stderr, "Invalid date, line %lld column %lld%s", datesState.line, 
+              (long long)parseDateLine(text, size, &values[count], datesState.opts), 
+              endLine);
+      datesState.skip=1;
+      c=size;
+      break;
+    }
+    length=(end!=NULL) ? (size_t)(end-text)-c : size-c;
+    next=c+length+(end!=NULL);
+    if(datesState.skip){
+      datesState.skip=0;
+      c=next;
+      continue;
+    }
+    datesState.line++;
+    
+    //(Windows end of lines)
+    if(length>0 && text[c+length-1]=='\r'){
+      length--;
+    }
+    if(length>0){
+      column=parseDateLine(text+c, length, &values[count], datesState.opts);
+      if(column>0){
+        datesState.errors++;
+        fprintf(stderr, "Invalid date, line %lld column %lld%s", datesState.line, 
+                (long long)column, endLine);
+      }else{
+        count++;
+      }
+    }
+    c=next;
+  }
+  
+  *used=c;
+  return count;
+}
+
+//Reader of the values of a text (parseEpochs or parseDates)
+typedef int (*EpochParser)(const char* text, size_t size, int last, 
+                           long long* values, int max, size_t* used);
+
+//Print the dates of the values of a file ("-" : standard input)
+//Return 0 if OK
+static int printEpochFile(const char* fileName, EpochParser parse, char* opts){
+  static long long timestamps[EPOCH_BLOCK];
+  static char buffer[EPOCH_READ_SIZE];
+  struct stat fileStat;
+  const char* text;
+  size_t size, used, length=0;
+  ssize_t readSize;
+  int fd, count;
+  STATS_START(cycles);
+  
+  if(strcmp(fileName, "-")!=0){
+    //File : mapped in memory, read once
+    fd=open(fileName, O_RDONLY);
+    if(fd<0 || fstat(fd, &fileStat)!=0){
+      if(fd>=0){
+        close(fd);
+      }
+      fprintf(stderr, "Cannot read %s%s", fileName, endLine);
+      return -1;
+    }
+    size=(size_t)fileStat.st_size;
+    if(size>0){
+      text=mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if(text==MAP_FAILED){
+        close(fd);
+        fprintf(stderr, "Cannot read %s%s", fileName, endLine);
+        return -1;
+      }
+      madvise((void*)text, size, MADV_SEQUENTIAL);
+      for(used=0; length<size; length=length+used){
+        count=parse(text+length, size-length, 1, timestamps, EPOCH_BLOCK, &used);
+        printEpochBlock(timestamps, count, opts);
       }
+      munmap((void*)text, size);
     }
-    
-    //End the line
-    printf("%s", endLine);
-    
-    if(printedMonth<=monthEnd){
-      //Add another newline for multiples months
-      printf("%s", endLine);
+    close(fd);
+  }else{
+    //Standard input : by blocks, a number cut at the end is kept
+    do{
+      readSize=read(STDIN_FILENO, buffer+length, sizeof(buffer)-length);
+      if(readSize<0 && errno==EINTR){
+        continue;
+      }
+      if(readSize<0){
+        fprintf(stderr, "Cannot read the standard input%s", endLine);
+        return -1;
+      }
+      length=length+readSize;
+      
+      size=0;
+      do{
+        count=parse(buffer+size, length-size, (readSize==0), 
+                    timestamps, EPOCH_BLOCK, &used);
+        printEpochBlock(timestamps, count, opts);
+        size=size+used;
+      }while(count==EPOCH_BLOCK);
+      
+      //Keep the text not read (or drop a too long value)
+      length=length-size;
+      if(length==sizeof(buffer)){
+        length=0;
+      }
+      memmove(buffer, buffer+size, length);
+    }while(readSize>0);
+  }
+  
+  STATS_STOP(STAT_IDX_CYCLES_EPOCH, cycles);
+  return 0;
+}
+
+//Check the parser with some lines (column of the error, 0 if valid)
+//Return the number of failures
+static int checkDateLines(char* opts){
+  static const struct {
+    const char* line;
+    size_t column;
+  } lines[]={
+    {"2024-03-15", 0}, {"2024-W11-5", 0}, {"2024-075", 0}, 
+    {"2024-03-15T10:20:30.5+01:00", 0}, {"1990-12-31T23:59:60Z", 0},
+    {"2024/03/15", 5}, {"2024.03.15", 5}, {"2024-03/15", 8}, {"2024-02-30", 9},
+    {"2023-W53-1", 7}, {"2023-366", 6}, {"2024-13-01", 6}, {"0000-01-01", 1},
+    {"2024-03-15T24:00:00Z", 13}, {"2024-03-15T10:20:30", 20}, {"2024-03-15x", 11}
+  };
+  long long timestamp;
+  size_t idx, column;
+  int failures=0;
+  
+  for(idx=0; idx<sizeof(lines)/sizeof(lines[0]); idx++){
+    column=parseDateLine(lines[idx].line, strlen(lines[idx].line), &timestamp, opts);
+    if(column!=lines[idx].column){
+      fprintf(stderr, "check: date %s : column %lld%s", lines[idx].line, 
+              (long long)column, endLine);
+      failures++;
     }
   }
+  return failures;
 }
 
-//print a cal 
-static void printCal(int monthStart, int monthEnd, int year, char* opts){
-  if(opts[OPT_IDX_VIEW]==OPT_VIEW_VERTICAL){
-    printVCal(monthStart, monthEnd, year, opts);
-  }else if(opts[OPT_IDX_VIEW]==OPT_VIEW_GRID){
-    printGCal(monthStart, monthEnd, year, opts);
-  }else if(opts[OPT_IDX_VIEW]==OPT_VIEW_LINEAR){
-    printHCal(monthStart, monthEnd, year, opts);
+//Print the dates of the lines of a file ("-" : standard input)
+//Return 0 if all the lines are valid
+static int printDateFile(const char* fileName, char* opts){
+  memset(&datesState, 0, sizeof(datesState));
+  datesState.opts=opts;
+  if(printEpochFile(fileName, parseDates, opts)!=0){
+    return -1;
   }
+  return (datesState.errors>0) ? -1 : 0;
 }
 
-int main(int argc, char* argv[]){
-  //program args
-  char strArg[20];
-  int argValue;
-  int currentArg;
-  char str[80];
+//Arguments of the program
+typedef struct {
+  int year;
+  int month;
+  int day;
+  char* pagesDir;       //-pages : folder of the generated pages
+  int checkFrom;        //-check : years checked
+  int checkTo;
+  char* epochFile;      //-epoch : file of timestamps ("-" : standard input)
+  char* datesFile;      //-dates : file of dates (ISO 8601, RFC 3339)
+  char* eventsFile;     //-events : file of events
+  char* rules[RRULE_ARGS_MAX]; //-rrule : recurrence rules
+  int nbRules;
+  char* occurrencesFrom;  //-occurrences : dates of the occurrences printed
+  char* occurrencesTo;
+  int easterFrom;       //-easter : years of the moveable feasts printed
+  int easterTo;
+  char* weekRule;       //-weeks : week rule
+  char* packDir;        //-pack/-unpack : folder of the files
+  char* packFile;       //-pack/-unpack/-packcat : pack
+  char* packPath;       //-packcat : file printed
+  int unpack;
+  char* timeScales;     //-timescale : scales of the timestamps converted
+  char* languages;      //-lang : languages of the names
+  char* zone;           //-tz : time zone of today
+  int localeIdx[LOCALES_NB];
+  int nbLocales;
+  int listLeapSeconds;  //-leapseconds : print the leap seconds
+  int deltaTFrom;       //-deltat : years of Delta T printed
+  int deltaTTo;
+  char* fiscalRules[FISCAL_RULES_MAX]; //-fiscal : fiscal calendars
+  int nbFiscal;
+  int fiscalFrom;       //-fiscal-periods : years of the periods printed
+  int fiscalTo;
+  char* iterateUnit;    //-iterate : days, weeks or months
+  char* iterateFrom;    //-iterate : 1st and last days (YYYYMMDD)
+  char* iterateTo;
+  int posterFrom;       //-poster : years of the poster
+  int posterTo;
+  char* page;           //-page : 1st week of the page (week or date)
+  long long pageWeek;
+  int pageWeeks;        //-page : number of weeks
+  char* search;         //-search : predicate of the years searched
+  int searchFrom;
+  int searchTo;
+  char* shard;          //-shard : part of the years searched
+  char* mergeFile;      //-merge : table of the shards merged
+  char** mergeShards;
+  int nbMergeShards;
+  char* checksumFile;   //-checksum : file checked
+  int cache;            //-cache : render cache ($XDG_RUNTIME_DIR)
+  int location;         //-loc : 0 none, 1 valid, -1 invalid
+  SunLocation sun;
+  char opts[OPTS_NB];
+} CalArgs;
+
+//Parse a location "<lat>,<lon>[,<UTC offset>]" (degrees, hours)
+//Return 1 if valid, -1 if not
+static int parseLocation(const char* str, SunLocation* location){
+  char* end;
+  
+  location->latitude=strtod(str, &end);
+  if(end==str || *end!=','){
+    return -1;
+  }
+  str=end+1;
+  location->longitude=strtod(str, &end);
+  if(end==str){
+    return -1;
+  }
+  location->utcOffset=0.0;
+  if(*end==','){
+    str=end+1;
+    location->utcOffset=strtod(str, &end);
+    if(end==str){
+      return -1;
+    }
+  }
+  
+  //Check the values (NaN fails too)
+  if(*end!='\0' || !(fabs(location->latitude)<=90.0) 
+     || !(fabs(location->longitude)<=180.0) || !(fabs(location->utcOffset)<=14.0)){
+    return -1;
+  }
+  location->enabled=1;
+  return 1;
+}
+
+//Reset the state set by the options, and the caches depending of it
+//(a new calendar in the same process : fuzzing)
+static void resetGlobals(void){
+  memset(&weekRule, 0, sizeof(weekRule));
+  feastsEnabled=0;
+  memset(&sunLocation, 0, sizeof(sunLocation));
+  nbFiscalRules=0;
+  nbArgsRules=0;
+  eventsIndex.enabled=0;
+  currentZone=NULL;
+  zoneToday=-1;
+  timeScaleFrom=-1;
+  timeScaleTo=-1;
+  currentLocale=&locales[0];
+  
+  memset(weekTables, 0, sizeof(weekTables));
+  yearLayoutReady=0;
+  yearEvents.ready=0;
+  renderPlan.ready=0;
+}
+
+//Set the default values of the arguments
+static void initArgs(CalArgs* args){
+  char* opts=args->opts;
+  
+  resetGlobals();
   
   //Date values
-  int year=-1;
-  int month=-1;
-  int day=-1;
-  int monthStart;
-  int monthEnd;
+  args->year=-1;
+  args->month=-1;
+  args->day=-1;
+  args->pagesDir=NULL;
+  args->checkFrom=0;
+  args->checkTo=-1;
+  args->epochFile=NULL;
+  args->datesFile=NULL;
+  args->eventsFile=NULL;
+  args->nbRules=0;
+  args->occurrencesFrom=NULL;
+  args->occurrencesTo=NULL;
+  args->easterFrom=0;
+  args->easterTo=-1;
+  args->iterateUnit=NULL;
+  args->iterateFrom=NULL;
+  args->iterateTo=NULL;
+  args->posterFrom=0;
+  args->posterTo=-1;
+  args->page=NULL;
+  args->pageWeek=-1;
+  args->pageWeeks=0;
+  args->weekRule=NULL;
+  args->packDir=NULL;
+  args->packFile=NULL;
+  args->packPath=NULL;
+  args->unpack=0;
+  args->timeScales=NULL;
+  args->languages=NULL;
+  args->zone=NULL;
+  args->nbLocales=0;
+  args->listLeapSeconds=0;
+  args->deltaTFrom=0;
+  args->deltaTTo=-1;
+  args->nbFiscal=0;
+  args->fiscalFrom=0;
+  args->fiscalTo=-1;
+  args->search=NULL;
+  args->searchFrom=0;
+  args->searchTo=-1;
+  args->shard=NULL;
+  args->mergeFile=NULL;
+  args->mergeShards=NULL;
+  args->nbMergeShards=0;
+  args->checksumFile=NULL;
+  args->cache=0;
+  args->location=0;
+  args->sun=sunLocation;
   
-  //options
-  char opts[13];
   //Default values :
   opts[OPT_IDX_WKN]=OPT_NONE;
   opts[OPT_IDX_DOY]=OPT_NONE;
@@ -1359,11 +7352,25 @@ int main(int argc, char* argv[]){
   opts[OPT_IDX_LYC]=OPT_LYC_DEFAULT; //Default LeapYear calculation
   opts[OPT_IDX_NBCOL]=1+'A';         //1 column printed
   opts[OPT_IDX_FIXED]=OPT_NONE;      //no Fixed mode
+  opts[OPT_IDX_STATS]=OPT_NONE;      //no statistics
+  opts[OPT_IDX_FORMAT]=OPT_FORMAT_TEXT; //text calendars
+}
+
+//Fetch the parameters (day, month, year and options)
+static void parseArgs(int argc, char* argv[], CalArgs* args){
+  char strArg[32];
+  int argValue;
+  int currentArg;
+  char str[80];
+  char* opts=args->opts;
+  int year=args->year;
+  int month=args->month;
+  int day=args->day;
   
-  //Fetch the parameters
   currentArg=1;
   while(currentArg<argc){
-    strncpy(strArg, argv[currentArg], 15);
+    //Copy the argument (truncated, always terminated)
+    snprintf(strArg, sizeof(strArg), "%s", argv[currentArg]);
     argValue=atoi(strArg);
     
     //Parameter is an integer (= day, month or year)
@@ -1459,9 +7466,188 @@ int main(int argc, char* argv[]){
         opts[OPT_IDX_LYD]=OPT_YES;
       }
       
-      if(strcmp(strArg,"-col")==0){
+      if(strcmp(strArg,"-format=md")==0){
+        opts[OPT_IDX_FORMAT]=OPT_FORMAT_MD;
+      }
+      if(strcmp(strArg,"-format=json")==0){
+        opts[OPT_IDX_FORMAT]=OPT_FORMAT_JSON;
+      }
+      if(strcmp(strArg,"-format=csv")==0){
+        opts[OPT_IDX_FORMAT]=OPT_FORMAT_CSV;
+      }
+      if(strcmp(strArg,"-format=ics")==0){
+        opts[OPT_IDX_FORMAT]=OPT_FORMAT_ICS;
+      }
+      
+      if(strcmp(strArg,"-cache")==0){
+        args->cache=1;
+      }
+      
+      if(strcmp(strArg,"-stats")==0){
+        opts[OPT_IDX_STATS]=OPT_YES;
+      }
+      if(strcmp(strArg,"-stats=json")==0){
+        opts[OPT_IDX_STATS]=OPT_STATS_JSON;
+      }
+      
+      if(strcmp(strArg,"-pages")==0 && currentArg+1<argc){
+        currentArg++;
+        args->pagesDir=argv[currentArg];
+      }
+      
+      if(strcmp(strArg,"-events")==0 && currentArg+1<argc){
+        currentArg++;
+        args->eventsFile=argv[currentArg];
+      }
+      
+      if(strcmp(strArg,"-rrule")==0 && currentArg+1<argc){
+        currentArg++;
+        if(args->nbRules<RRULE_ARGS_MAX){
+          args->rules[args->nbRules++]=argv[currentArg];
+        }
+      }
+      
+      if(strcmp(strArg,"-occurrences")==0 && currentArg+2<argc){
+        args->occurrencesFrom=argv[currentArg+1];
+        args->occurrencesTo=argv[currentArg+2];
+        currentArg=currentArg+2;
+      }
+      
+      if(strcmp(strArg,"-feasts")==0){
+        feastsEnabled=1;
+      }
+      
+      if(strcmp(strArg,"-easter")==0 && currentArg+2<argc){
+        args->easterFrom=atoi(argv[currentArg+1]);
+        args->easterTo=atoi(argv[currentArg+2]);
+        currentArg=currentArg+2;
+      }
+      
+      if(strcmp(strArg,"-poster")==0 && currentArg+2<argc){
+        args->posterFrom=atoi(argv[currentArg+1]);
+        args->posterTo=atoi(argv[currentArg+2]);
+        currentArg=currentArg+2;
+      }
+      
+      if(strcmp(strArg,"-iterate")==0 && currentArg+3<argc){
+        args->iterateUnit=argv[currentArg+1];
+        args->iterateFrom=argv[currentArg+2];
+        args->iterateTo=argv[currentArg+3];
+        currentArg=currentArg+3;
+      }
+      
+      if(strcmp(strArg,"-page")==0 && currentArg+2<argc){
+        args->page=argv[currentArg+1];
+        args->pageWeeks=atoi(argv[currentArg+2]);
+        currentArg=currentArg+2;
+      }
+      
+      if(strcmp(strArg,"-search")==0 && currentArg+3<argc){
+        args->search=argv[currentArg+1];
+        args->searchFrom=atoi(argv[currentArg+2]);
+        args->searchTo=atoi(argv[currentArg+3]);
+        currentArg=currentArg+3;
+      }
+      
+      if(strncmp(argv[currentArg],"-shard=",7)==0){
+        args->shard=argv[currentArg]+7;
+      }
+      
+      //-merge : all the next arguments are the shards
+      if(strcmp(strArg,"-merge")==0 && currentArg+2<argc){
+        args->mergeFile=argv[currentArg+1];
+        args->mergeShards=&argv[currentArg+2];
+        args->nbMergeShards=argc-currentArg-2;
+        currentArg=argc-1;
+      }
+      
+      if(strcmp(strArg,"-checksum")==0 && currentArg+1<argc){
+        args->checksumFile=argv[currentArg+1];
+        currentArg++;
+      }
+      
+      if(strcmp(strArg,"-check")==0 && currentArg+2<argc){
+        args->checkFrom=atoi(argv[currentArg+1]);
+        args->checkTo=atoi(argv[currentArg+2]);
+        currentArg=currentArg+2;
+      }
+      
+      if(strcmp(argv[currentArg],"-epoch")==0){
+        args->epochFile="-";
+      }
+      if(strncmp(argv[currentArg],"-epoch=",7)==0){
+        args->epochFile=argv[currentArg]+7;
+      }
+      
+      if(strcmp(argv[currentArg],"-dates")==0){
+        args->datesFile="-";
+      }
+      if(strncmp(argv[currentArg],"-dates=",7)==0){
+        args->datesFile=argv[currentArg]+7;
+      }
+      
+      if(strncmp(argv[currentArg],"-fiscal=",8)==0 && args->nbFiscal<FISCAL_RULES_MAX){
+        args->fiscalRules[args->nbFiscal++]=argv[currentArg]+8;
+      }
+      
+      if(strcmp(strArg,"-fiscal-periods")==0 && currentArg+2<argc){
+        args->fiscalFrom=atoi(argv[currentArg+1]);
+        args->fiscalTo=atoi(argv[currentArg+2]);
+        currentArg=currentArg+2;
+      }
+      
+      if(strcmp(strArg,"-pack")==0 && currentArg+2<argc){
+        args->packDir=argv[currentArg+1];
+        args->packFile=argv[currentArg+2];
+        currentArg=currentArg+2;
+      }
+      
+      if(strcmp(strArg,"-unpack")==0 && currentArg+2<argc){
+        args->packFile=argv[currentArg+1];
+        args->packDir=argv[currentArg+2];
+        args->unpack=1;
+        currentArg=currentArg+2;
+      }
+      
+      if(strcmp(strArg,"-packcat")==0 && currentArg+2<argc){
+        args->packFile=argv[currentArg+1];
+        args->packPath=argv[currentArg+2];
+        currentArg=currentArg+2;
+      }
+      
+      if(strncmp(argv[currentArg],"-timescale=",11)==0){
+        args->timeScales=argv[currentArg]+11;
+      }
+      
+      if(strcmp(strArg,"-leapseconds")==0){
+        args->listLeapSeconds=1;
+      }
+      
+      if(strcmp(strArg,"-deltat")==0 && currentArg+2<argc){
+        args->deltaTFrom=atoi(argv[currentArg+1]);
+        args->deltaTTo=atoi(argv[currentArg+2]);
+        currentArg=currentArg+2;
+      }
+      
+      if(strncmp(argv[currentArg],"-lang=",6)==0){
+        args->languages=argv[currentArg]+6;
+      }
+      
+      if(strncmp(argv[currentArg],"-tz=",4)==0){
+        args->zone=argv[currentArg]+4;
+      }
+      
+      if(strncmp(argv[currentArg],"-weeks=",7)==0){
+        args->weekRule=argv[currentArg]+7;
+      }
+      
+      if(strncmp(argv[currentArg],"-loc=",5)==0){
+        args->location=parseLocation(argv[currentArg]+5, &args->sun);
+      }
+      
+      if(strcmp(strArg,"-col")==0 && currentArg+1<argc){
         currentArg++;
-        strncpy(strArg, argv[currentArg], 15);
+        snprintf(strArg, sizeof(strArg), "%s", argv[currentArg]);
         argValue=atoi(strArg);
         if(argValue!=0){
           if(argValue<0){
@@ -1480,6 +7666,19 @@ int main(int argc, char* argv[]){
     currentArg++;
   }
   
+  args->year=year;
+  args->month=month;
+  args->day=day;
+}
+
+//Complete the arguments (options depending of the view, today...)
+//Return 0 if the date is valid
+static int finishArgs(CalArgs* args){
+  char* opts=args->opts;
+  int year=args->year;
+  int month=args->month;
+  int day=args->day;
+  
   //Only a 'day' ? it's the month
   if(day>=JANUARY && day<=DECEMBER+1 && month<0){
     month=day;
@@ -1507,7 +7706,21 @@ int main(int argc, char* argv[]){
     }
   }
   
-  //No year given : get the 
+  //Time zone of today
+  if(args->zone!=NULL && setZone(args->zone)!=0){
+    return -9;
+  }
+  
+  //No year given : get the year of today (in the zone if -tz), and its month
+  //if no month given
+  if(year<0 && currentZone!=NULL){
+    int zoneDay, zoneMonth;
+    
+    getDateOfDayNumber(zoneToday, &zoneDay, &zoneMonth, &year, opts);
+    if(month<1){
+      month=zoneMonth+1;
+    }
+  }
   if(year<0){
     time_t t = time(NULL);
     struct tm tm = *localtime(&t);
@@ -1519,21 +7732,543 @@ int main(int argc, char* argv[]){
     }
   }
   
+  //Check the location asked
+  if(args->location<0){
+    return -2;
+  }
+  
+  //Time scales of the timestamps
+  if(args->timeScales!=NULL && parseTimeScales(args->timeScales, &timeScaleFrom, 
+                                                &timeScaleTo)!=0){
+    timeScaleFrom=-1;
+    return -6;
+  }
+  
+  //Languages of the names, separated by ','
+  if(args->languages!=NULL){
+    const char* code=args->languages;
+    const char* comma;
+    
+    do{
+      comma=strchr(code, ',');
+      if(args->nbLocales>=LOCALES_NB){
+        return -7;
+      }
+      args->localeIdx[args->nbLocales]=getLocaleIdx(code, (comma!=NULL) ? 
+                                          (size_t)(comma-code) : strlen(code));
+      if(args->localeIdx[args->nbLocales]<0){
+        args->nbLocales=0;
+        return -7;
+      }
+      args->nbLocales++;
+      code=comma+1;
+    }while(comma!=NULL);
+  }
+  
+  //Days iterated
+  if(args->iterateUnit!=NULL 
+     && ((strcmp(args->iterateUnit, "days")!=0 && strcmp(args->iterateUnit, "weeks")!=0
+          && strcmp(args->iterateUnit, "months")!=0)
+         || parseRRuleDate(args->iterateFrom, opts)<0 
+         || parseRRuleDate(args->iterateTo, opts)<0)){
+    return -1;
+  }
+  
+  //1st week of the page
+  if(args->page!=NULL){
+    args->pageWeek=parsePageWeek(args->page, opts);
+    if(args->pageWeek<0 || args->pageWeeks<1){
+      return -1;
+    }
+  }
+  
+  //Part of the years searched
+  if(args->shard!=NULL){
+    int shard, nbShards;
+    
+    if(parseShard(args->shard, &shard, &nbShards)!=0){
+      return -8;
+    }
+    getShardYears(shard, nbShards, &args->searchFrom, &args->searchTo);
+  }
+  
+  //Fiscal rules
+  for(nbFiscalRules=0; nbFiscalRules<args->nbFiscal; nbFiscalRules++){
+    if(parseFiscalRule(args->fiscalRules[nbFiscalRules], &fiscalRules[nbFiscalRules])!=0){
+      nbFiscalRules=0;
+      return -5;
+    }
+  }
+  
+  //Week rule : also the 1st weekday printed
+  if(args->weekRule!=NULL){
+    if(parseWeekRule(args->weekRule, &weekRule)!=0){
+      weekRule.enabled=0;
+      return -4;
+    }
+    opts[OPT_IDX_FIRSTWD]=weekRule.firstWeekday+'0';
+  }
+  
+  //Check the rules (DTSTART : the 1st January, if not in the rule)
+  for(nbArgsRules=0; nbArgsRules<args->nbRules; nbArgsRules++){
+    if(year<1 || parseRRule(args->rules[nbArgsRules], 
+                            getJulianDayNumber(1, JANUARY, year, opts),
+                            &argsRules[nbArgsRules], opts)!=0){
+      nbArgsRules=0;
+      return -3;
+    }
+  }
+  if(args->occurrencesFrom!=NULL 
+     && (parseRRuleDate(args->occurrencesFrom, opts)<0 
+         || parseRRuleDate(args->occurrencesTo, opts)<0)){
+    return -1;
+  }
+  
+  //Check the date asked
+  if(month>DECEMBER+1 || (month>0 && day>getDaysPerMonth(month-1, year, opts))){
+    return -1;
+  }
+  
+  args->year=year;
+  args->month=month;
+  args->day=day;
+  return 0;
+}
+
+//Render cache (-cache) : the calendars printed are kept in a file mapped by
+//all the processes ($XDG_RUNTIME_DIR/calendar.cache), with an index of slots
+//found by the hash of the options. A slot is taken by compare-and-swap, its
+//data is added at the end, then the slot is marked ready : no lock, and no
+//removal (a full cache is only read)
+#define CACHE_MAGIC       "CALCACH1"
+#define CACHE_NAME        "calendar.cache"
+#define CACHE_SLOTS       4096          //power of 2
+#define CACHE_PROBES      16
+#define CACHE_DATA_SIZE   (8<<20)
+#define CACHE_KEY_SIZE    256
+#define CACHE_PATH_SIZE   4096
+
+typedef struct {
+  char magic[8];
+  long long slots;
+  long long dataSize;
+  long long dataEnd;                 //(atomic) end of the data used
+} CacheHeader;
+
+//A slot : the key, then the calendar, in the data
+typedef struct {
+  unsigned long long hash;           //(atomic) 0 : free
+  int ready;                         //(atomic) set when the data is written
+  int keySize;
+  long long offset;
+  long long size;
+  unsigned long long check;          //hash of the key and the calendar
+} CacheSlot;
+
+typedef struct {
+  CacheHeader* header;
+  CacheSlot* slots;
+  char* data;
+  size_t mapSize;
+} RenderCache;
+
+static RenderCache renderCache={NULL, NULL, NULL, 0};
+
+//Map the cache file, created if needed
+//Return 0 if OK
+static int openRenderCache(void){
+  char path[CACHE_PATH_SIZE], tmpName[CACHE_PATH_SIZE+32];
+  const char* dir=getenv("XDG_RUNTIME_DIR");
+  size_t mapSize=sizeof(CacheHeader)+CACHE_SLOTS*sizeof(CacheSlot)+CACHE_DATA_SIZE;
+  CacheHeader header;
+  struct stat fileStat;
+  void* map;
+  int fd;
+  
+  if(renderCache.header!=NULL){
+    return 0;
+  }
+  if(dir==NULL || dir[0]=='\0'){
+    return -1;
+  }
+  snprintf(path, sizeof(path), "%s/%s", dir, CACHE_NAME);
+  fd=open(path, O_RDWR);
+  if(fd<0 && errno==ENOENT){
+    //New file : complete before linked (another process may do the same)
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+    header.slots=CACHE_SLOTS;
+    header.dataSize=CACHE_DATA_SIZE;
+    snprintf(tmpName, sizeof(tmpName), "%s.%ld", path, (long)getpid());
+    fd=open(tmpName, O_WRONLY|O_CREAT|O_EXCL, 0600);
+    if(fd<0){
+      return -1;
+    }
+    if(ftruncate(fd, (off_t)mapSize)!=0 
+       || pwrite(fd, &header, sizeof(header), 0)!=(ssize_t)sizeof(header)
+       || close(fd)!=0 || (link(tmpName, path)!=0 && errno!=EEXIST)){
+      unlink(tmpName);
+      return -1;
+    }
+    unlink(tmpName);
+    fd=open(path, O_RDWR);
+  }
+  if(fd<0){
+    return -1;
+  }
+  if(fstat(fd, &fileStat)!=0 || (size_t)fileStat.st_size!=mapSize){
+    close(fd);
+    return -1;
+  }
+  map=mmap(NULL, mapSize, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if(map==MAP_FAILED){
+    return -1;
+  }
+  
+  renderCache.header=(CacheHeader*)map;
+  if(memcmp(renderCache.header->magic, CACHE_MAGIC, sizeof(header.magic))!=0
+     || renderCache.header->slots!=CACHE_SLOTS 
+     || renderCache.header->dataSize!=CACHE_DATA_SIZE){
+    munmap(map, mapSize);
+    renderCache.header=NULL;
+    return -1;
+  }
+  renderCache.slots=(CacheSlot*)(renderCache.header+1);
+  renderCache.data=(char*)(renderCache.slots+CACHE_SLOTS);
+  renderCache.mapSize=mapSize;
+  return 0;
+}
+
+//Return the calendar of a key (NULL if not in the cache)
+static const char* findRenderCache(const char* key, int keySize, unsigned long long hash, 
+                                   size_t* size){
+  CacheSlot* slot;
+  const char* data;
+  int probe;
+  
+  for(probe=0; probe<CACHE_PROBES; probe++){
+    slot=&renderCache.slots[(hash+probe)&(CACHE_SLOTS-1)];
+    if(__atomic_load_n(&slot->hash, __ATOMIC_ACQUIRE)==0){
+      return NULL;
+    }
+    if(slot->hash!=hash || !__atomic_load_n(&slot->ready, __ATOMIC_ACQUIRE)){
+      continue;
+    }
+    //(the values are checked : the file is shared)
+    if(slot->keySize!=keySize || slot->offset<0 || slot->size<0 
+       || slot->offset+keySize+slot->size>CACHE_DATA_SIZE){
+      return NULL;
+    }
+    data=renderCache.data+slot->offset;
+    if(memcmp(data, key, keySize)==0 
+       && hashChunk(data, keySize+slot->size)==slot->check){
+      *size=(size_t)slot->size;
+      return data+keySize;
+    }
+  }
+  return NULL;
+}
+
+//Add the calendar of a key (not added if the cache is full)
+static void addRenderCache(const char* key, int keySize, unsigned long long hash, 
+                           const char* calendar, size_t size){
+  unsigned long long expected;
+  long long offset;
+  CacheSlot* slot;
+  int probe;
+  
+  for(probe=0; probe<CACHE_PROBES; probe++){
+    slot=&renderCache.slots[(hash+probe)&(CACHE_SLOTS-1)];
+    expected=0;
+    if(__atomic_compare_exchange_n(&slot->hash, &expected, hash, 0, 
+                                   __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)){
+      break;
+    }
+    //(added by another process)
+    if(expected==hash){
+      return;
+    }
+  }
+  if(probe==CACHE_PROBES){
+    return;
+  }
+  
+  offset=__atomic_fetch_add(&renderCache.header->dataEnd, (long long)(keySize+size), 
+                            __ATOMIC_RELAXED);
+  if(offset<0 || offset+keySize+(long long)size>CACHE_DATA_SIZE){
+    //(the slot stays not ready)
+    return;
+  }
+  memcpy(renderCache.data+offset, key, keySize);
+  memcpy(renderCache.data+offset+keySize, calendar, size);
+  slot->keySize=keySize;
+  slot->offset=offset;
+  slot->size=(long long)size;
+  slot->check=hashChunk(renderCache.data+offset, keySize+size);
+  __atomic_store_n(&slot->ready, 1, __ATOMIC_RELEASE);
+}
+
+//Print the calendars asked : day infos, or the months in each language
+static void printCalendars(CalArgs* args, int monthStart, int monthEnd){
+  char* opts=args->opts;
+  
+  if(args->day>0 || (opts[OPT_IDX_LYD]==OPT_YES)){
+    STATS_START(cycles);
+    printDayInfos(args->day, monthStart, args->year, 0, opts);
+    STATS_STOP(STAT_IDX_CYCLES_DAY, cycles);
+  }else if(args->nbLocales>0){
+    int idx;
+    
+    //The calendar in each language (named if several)
+    for(idx=0; idx<args->nbLocales; idx++){
+      currentLocale=&locales[args->localeIdx[idx]];
+      if(args->nbLocales>1){
+        outPrintf("%s%s:%s", (idx>0) ? endLine : "", currentLocale->code, endLine);
+      }
+      printCal(monthStart, monthEnd, args->year, opts);
+    }
+    currentLocale=&locales[0];
+  }else{
+    printCal(monthStart, monthEnd, args->year, opts);
+  }
+}
+
+//Return the size of the key of the calendars asked (0 : not cached)
+//(the calendars with events, sun times or fiscal years are not cached)
+static int getRenderKey(CalArgs* args, int monthStart, int monthEnd, char* key){
+  int values[5]={args->year, monthStart, monthEnd, args->day, args->nbLocales};
+  size_t ruleSize=(args->weekRule!=NULL) ? strlen(args->weekRule)+1 : 0;
+  int keySize=0;
+  
+  if(eventsIndex.enabled || sunLocation.enabled || nbFiscalRules>0 
+     || args->opts[OPT_IDX_STATS]!=OPT_NONE
+     || OPTS_NB+sizeof(values)+sizeof(args->localeIdx)+ruleSize>CACHE_KEY_SIZE){
+    return 0;
+  }
+  memcpy(key, args->opts, OPTS_NB);
+  keySize=OPTS_NB;
+  memcpy(key+keySize, values, sizeof(values));
+  keySize=keySize+sizeof(values);
+  memcpy(key+keySize, args->localeIdx, args->nbLocales*sizeof(int));
+  keySize=keySize+args->nbLocales*sizeof(int);
+  if(ruleSize>0){
+    memcpy(key+keySize, args->weekRule, ruleSize);
+    keySize=keySize+ruleSize;
+  }
+  return keySize;
+}
+
+//Print the calendars asked, from the render cache if there
+//(a calendar is added only if it was kept whole in the output buffer)
+static void printCachedCalendars(CalArgs* args, int monthStart, int monthEnd){
+  char key[CACHE_KEY_SIZE];
+  int keySize=getRenderKey(args, monthStart, monthEnd, key);
+  unsigned long long hash, flushed=outFlushed;
+  size_t start=outLength, size;
+  const char* calendar;
+  
+  if(keySize==0 || openRenderCache()!=0){
+    printCalendars(args, monthStart, monthEnd);
+    return;
+  }
+  hash=hashChunk(key, keySize);
+  hash=hash+(hash==0);
+  calendar=findRenderCache(key, keySize, hash, &size);
+  if(calendar!=NULL){
+    outWrite(calendar, size);
+    return;
+  }
+  
+  printCalendars(args, monthStart, monthEnd);
+  if(outFlushed==flushed){
+    addRenderCache(key, keySize, hash, outBuffer+start, outLength-start);
+  }
+}
+
+//Print the calendar (or the day infos, or the pages) asked
+//Return 0 if OK
+static int runCalendar(CalArgs* args){
+  int monthStart;
+  int monthEnd;
+  int result=0;
+  char* opts=args->opts;
+  
   //print all or only the month asked
-  if(month<0){
+  if(args->month<0){
     monthStart=JANUARY;
     monthEnd=DECEMBER;
   }else{
     //index start at 0, need subtract 1
-    monthStart=month-1;
-    monthEnd=month-1;
+    monthStart=args->month-1;
+    monthEnd=args->month-1;
   }
   
-  if(day>0 || (opts[OPT_IDX_LYD]==OPT_YES)){
-    printDayInfos(day, monthStart, year, 0, opts);
+  if(args->location>0){
+    sunLocation=args->sun;
+  }
+  if(args->eventsFile!=NULL && loadEvents(args->eventsFile, opts)!=0){
+    return 1;
+  }
+  if(nbArgsRules>0 || feastsEnabled || currentZone!=NULL){
+    eventsIndex.enabled=1;
+  }
+  
+  if(args->checkTo>=args->checkFrom){
+    result=checkDates(args->checkFrom, args->checkTo, opts);
+    result=(checkDateLines(opts)>0) || result;
+    result=(checkRRules(opts)>0) || result;
+    result=(checkFiscalPeriods(args->checkFrom, args->checkTo, opts)>0) || result;
+  }else if(args->packFile!=NULL){
+    if(args->packPath!=NULL){
+      result=(unpackTree(args->packFile, NULL, args->packPath)!=0);
+    }else if(args->unpack){
+      result=(unpackTree(args->packFile, args->packDir, NULL)!=0);
+    }else{
+      result=(packTree(args->packDir, args->packFile)!=0);
+    }
+  }else if(args->mergeFile!=NULL){
+    result=(mergeShards(args->mergeFile, args->mergeShards, args->nbMergeShards)!=0);
+  }else if(args->checksumFile!=NULL){
+    result=(printChecksum(args->checksumFile)!=0);
+  }else if(args->listLeapSeconds || args->deltaTTo>=args->deltaTFrom){
+    printLeapSeconds(args->deltaTFrom, args->deltaTTo);
+  }else if(nbFiscalRules>0 && args->fiscalTo>=args->fiscalFrom){
+    printFiscalPeriods(args->fiscalFrom, args->fiscalTo, opts);
+  }else if(nbFiscalRules>0 && args->day<1){
+    printFiscalYear(args->year, opts);
+  }else if(args->easterTo>=args->easterFrom){
+    printFeasts(args->easterFrom, args->easterTo, opts);
+  }else if(args->search!=NULL){
+    result=(printSearch(args->search, args->searchFrom, args->searchTo, opts)<0);
+  }else if(args->occurrencesFrom!=NULL){
+    printOccurrences(parseRRuleDate(args->occurrencesFrom, opts),
+                     parseRRuleDate(args->occurrencesTo, opts), opts);
+  }else if(args->epochFile!=NULL){
+    result=(printEpochFile(args->epochFile, parseEpochs, opts)!=0);
+  }else if(args->datesFile!=NULL){
+    result=(printDateFile(args->datesFile, opts)!=0);
+  }else if(args->pagesDir!=NULL){
+    result=(printPages(args->pagesDir, opts)!=0);
+  }else if(args->iterateUnit!=NULL){
+    printIterations(args->iterateUnit[0], parseRRuleDate(args->iterateFrom, opts),
+                    parseRRuleDate(args->iterateTo, opts), opts);
+  }else if(args->page!=NULL){
+    printPage(args->pageWeek, args->pageWeeks, opts);
+  }else if(args->posterTo>=args->posterFrom && args->posterFrom>0){
+    //(names in the 1st language asked)
+    currentLocale=&locales[(args->nbLocales>0) ? args->localeIdx[0] : 0];
+    printPoster(args->posterFrom, args->posterTo, opts);
+    currentLocale=&locales[0];
+  }else if(args->cache){
+    printCachedCalendars(args, monthStart, monthEnd);
   }else{
-    printCal(monthStart, monthEnd, year, opts);
+    printCalendars(args, monthStart, monthEnd);
+  }
+  
+  if(opts[OPT_IDX_STATS]!=OPT_NONE){
+    printStats(opts);
   }
+  
+  return result;
+}
 
+#ifdef CAL_FUZZ
+//Fuzzing entry (libFuzzer) : cc -g -fsanitize=fuzzer,address,undefined -DCAL_FUZZ
+//the input is a list of arguments, separated by spaces or '\0'
+int LLVMFuzzerTestOneInput(const unsigned char* data, size_t size){
+  char buffer[256];
+  char* argv[16];
+  int argc=1;
+  size_t c;
+  CalArgs args;
+  static int init=0;
+  
+  if(!init){
+    //The calendars are not needed
+    if(freopen("/dev/null", "w", stdout)==NULL){
+      return 0;
+    }
+    init=1;
+  }
+  
+  if(size>=sizeof(buffer)){
+    size=sizeof(buffer)-1;
+  }
+  memcpy(buffer, data, size);
+  buffer[size]='\0';
+  
+  //Split the arguments
+  argv[0]="calendar";
+  for(c=0; c<size && argc<16; c++){
+    if(buffer[c]==' ' || buffer[c]=='\0'){
+      buffer[c]='\0';
+    }else if(c==0 || buffer[c-1]=='\0'){
+      argv[argc++]=&buffer[c];
+    }
+  }
+  
+  initArgs(&args);
+  parseArgs(argc, argv, &args);
+  //No files, no long checks
+  args.pagesDir=NULL;
+  args.epochFile=NULL;
+  args.datesFile=NULL;
+  args.eventsFile=NULL;
+  args.occurrencesFrom=NULL;
+  args.packFile=NULL;
+  args.mergeFile=NULL;
+  args.iterateUnit=NULL;
+  args.checksumFile=NULL;
+  args.zone=NULL;
+  args.cache=0;
+  if(args.checkTo-args.checkFrom>10){
+    args.checkTo=args.checkFrom+10;
+  }
+  if(args.fiscalTo-args.fiscalFrom>1000){
+    args.fiscalTo=args.fiscalFrom+1000;
+  }
+  if(args.pageWeeks>1000){
+    args.pageWeeks=1000;
+  }
+  if(args.posterTo-args.posterFrom>100){
+    args.posterTo=args.posterFrom+100;
+  }
+  if(args.easterTo-args.easterFrom>1000){
+    args.easterTo=args.easterFrom+1000;
+  }
+  if(args.searchTo-args.searchFrom>1000){
+    args.searchTo=args.searchFrom+1000;
+  }
+  if(finishArgs(&args)==0){
+    runCalendar(&args);
+  }
+  outFlush();
   return 0;
 }
+#else
+int main(int argc, char* argv[]){
+  CalArgs args;
+  int result;
+  
+  initArgs(&args);
+  parseArgs(argc, argv, &args);
+  result=finishArgs(&args);
+  if(result!=0){
+    fprintf(stderr, "Invalid %s%s", (result==-2) ? "location" 
+                                    : ((result==-3) ? "rule" 
+                                    : ((result==-4) ? "week rule" 
+                                    : ((result==-5) ? "fiscal rule" 
+                                    : ((result==-6) ? "time scale" 
+                                    : ((result==-7) ? "language" 
+                                    : ((result==-8) ? "shard" 
+                                    : ((result==-9) ? "zone" : "date"))))))), endLine);
+    return 1;
+  }
+  
+  result=runCalendar(&args);
+  outFlush();
+
+  return result;
+}
+#endif
@@ -4,16 +4,18 @@
 # License: [Unlicense](unlicense.txt)
 
 #Const
-calendarBin="./calendar.exe" #or "./calendar" for unix
+calendarBin="./calendar" #POSIX build (on Windows : Cygwin or MSYS2, "./calendar.exe")
 typesOfYear=("Common" "Leap")
 months=("January" "February" "March" "April" "May" "June" "July" "August" "September" "October" "November" "December")
 days=("Sunday" "Monday" "Tuesday" "Wednesday" "Thursday" "Friday" "Saturday")
-startingDays=("Monday" "Sunday") #can include Saturday ???
+startingDays=("Monday" "Sunday") #Saturday : with the week rule "-weeks=mideast"
 # List of different calendars (depending of the 1st day of year)
 # Common-Sunday to Common-Saturday + Common-Saturday-W53 + Leap-Sunday to Leap-Saturday
 yearsList=(2006 2001 2002 2003 2009 2010 2011 2005 2012 2024 2008 2020 2004 2016 2000)
 indexFile="index.txt"
 yearsFile="years.txt"
+packFile="" #e.g. "../calendars.pack" : pack of the generated files (-pack)
+shards=1 #years lists : number of processes (-shard), then merged (-merge)
 
 #return the next/previous day
 #$1 is the currentDay
@@ -67,6 +69,16 @@ completeWithSpace() {
   echo "$stringResult"
 }
 
+#Apply the sed expressions one after the other, as a pipeline
+#(same result than a "sed -i" for each expression, but no file rewritten)
+sedPipeline() {
+  pipeline="cat"
+  for expression in "$@"; do
+    printf -v quotedExpression "%q" "${expression}"
+    pipeline="${pipeline} | sed -E -e ${quotedExpression}"
+  done
+  eval "${pipeline}"
+}
 
 doColumnMode(){
   startingDay="$1"
@@ -101,9 +113,11 @@ doColumnMode(){
     fi
     
     #Add the title to the index file
-    echo "" >> "${path}/${indexFile}"
-    echo "## Calendars" >> "${path}/${indexFile}"
-    echo "" >> "${path}/${indexFile}"
+    {
+      echo ""
+      echo "## Calendars"
+      echo ""
+    } >> "${path}/${indexFile}"
       
     #MONTH LOOP
     for((month=1; month<13; month++)); do 
@@ -126,8 +140,9 @@ doColumnMode(){
           echo "[${monthName}](./${filename})" >> "${path}/${indexFile}"
         fi
       
-        #call the program, write the result to a file
-        $calendarBin "${month}" "${year}" "-view=v" "-start=${startingDay}" "-WkN=left" "-WD" > "${newFile}"
+        #Regex applied to the output of the program (see sedPipeline)
+        sedExpressions=()
+        tableEnd=""
         
         #######################################################################
         ##REGEX 
@@ -141,52 +156,59 @@ doColumnMode(){
           #LINES with no week number
           regexPattern="^(   ) (..) (..)"
           regexReplace="|   +--+------+\n|\1|\2|\3    |"
-          sed "-i" "-E" "-e" "s/${regexPattern}/${regexReplace}/gm" "${newFile}"
+          sedExpressions+=("s/${regexPattern}/${regexReplace}/gm")
           
           #LINES with a week number : add a separator BEFORE the week number
           regexPattern="^(W[0-9][0-9]) (..) (..)"
           regexReplace="+---+--+------+\n|\1|\2|\3    |"
-          sed "-i" "-E" "-e" "s/${regexPattern}/${regexReplace}/gm" "${newFile}"
+          sedExpressions+=("s/${regexPattern}/${regexReplace}/gm")
 
           #SUB-HEADER
           regexPattern="^(W[^0-9 ][^0-9 ]) (..) (..)"
           regexReplace="|\1|\2|\3    |"
-          sed "-i" "-E" "-e" "s/${regexPattern}/${regexReplace}/gm" "${newFile}"
+          sedExpressions+=("s/${regexPattern}/${regexReplace}/gm")
 
           #replace the 1st line separator for the sub-header
           regexPattern="^\+---\+--\+------\+"
           regexReplace="+===+==+======+"
-          sed "-i" "-E" "-e" "0,/${regexPattern}/{s/${regexPattern}/${regexReplace}/}" "${newFile}"
+          sedExpressions+=("0,/${regexPattern}/{s/${regexPattern}/${regexReplace}/}")
           
           #YEAR HEADER
           regexPattern="^${monthName} [^\n]*"
           regexReplace="+---+---------+\n"
           regexReplace="${regexReplace}|   |${monthName}${addSpacesMonth}|\n"
           regexReplace="${regexReplace}+---+--+------+"
-          sed "-i" "-E" "-e" "s/${regexPattern}/${regexReplace}/gm" "${newFile}"
+          sedExpressions+=("s/${regexPattern}/${regexReplace}/gm")
 
           #Add the end of the table manually...
-          echo "+---+--+------+" >>"${newFile}"
+          tableEnd="+---+--+------+"
         fi
         
+        #call the program : the file is written once, then completed
+        exec 3>"${newFile}"
+        $calendarBin "${month}" "${year}" "-view=v" "-start=${startingDay}" "-WkN=left" "-WD" | sedPipeline "${sedExpressions[@]}" >&3
+        if [[ -n "${tableEnd}" ]]; then
+          echo "${tableEnd}" >&3
+        fi
+
         #######################################################################
         ##YAML 
         if [[ "${doYAML}" == "yes" ]]; then
         
           #YAML : Add current section to the file
-          echo "" >> "${newFile}"
-          echo "---" >> "${newFile}"
-          echo "current:" >> "${newFile}"
-          echo "  month: ${monthName}" >> "${newFile}"
-          echo "  year: " >> "${newFile}"
-          echo "    starting: ${dayName}" >> "${newFile}"
-          echo "    type: ${typeOfYear}" >> "${newFile}"
-          echo "    index: <./${indexFile}>" >> "${newFile}"
-          echo "  file: <./${filename}>" >> "${newFile}"
-          echo "    license: public domain" >> "${newFile}"
+          echo "" >&3
+          echo "---" >&3
+          echo "current:" >&3
+          echo "  month: ${monthName}" >&3
+          echo "  year: " >&3
+          echo "    starting: ${dayName}" >&3
+          echo "    type: ${typeOfYear}" >&3
+          echo "    index: <./${indexFile}>" >&3
+          echo "  file: <./${filename}>" >&3
+          echo "    license: public domain" >&3
 
           #YAML : Add the "previous" section to the CURRENT file
-          echo "previous:" >> "${newFile}"
+          echo "previous:" >&3
           if (( "${month}" > 1 )); then
             #Set for previous month in the current year
             previousMonth=$((${month}-1))
@@ -196,8 +218,8 @@ doColumnMode(){
             else
               previousFileName="./m${previousMonth}-${previousMonthName,,}.txt"
             fi
-            echo "  month: ${previousMonthName}" >> "${newFile}"
-            echo "  file: <${previousFileName}>" >> "${newFile}"
+            echo "  month: ${previousMonthName}" >&3
+            echo "  file: <${previousFileName}>" >&3
           else
             #Set for December in the previous year
             previousMonthName="${months[11]}"
@@ -205,8 +227,8 @@ doColumnMode(){
             #Get 1st day of previous year, common (-1d) and leap (-2d)
             previousDayNameCommon=`getDay "${dayName}" "-1"`
             previousDayNameLeap=`getDay "${previousDayNameCommon}" "-1"`
-            echo "  month: ${previousMonthName}" >> "${newFile}"
-            echo "  year: " >> "${newFile}"
+            echo "  month: ${previousMonthName}" >&3
+            echo "  year: " >&3
             #Check if current year is common or not
             if [[ "${typeOfYear}" == "${typesOfYear[0]}" ]]; then
               #Saturday+W53 is an exception (a Common year AFTER a leap year)
@@ -215,38 +237,38 @@ doColumnMode(){
                 leapDay="${previousDayNameLeap}"
                 switchTypeOfYear="${typesOfYear[1]}"
                 relativePathFile="../../${switchTypeOfYear,,}/${leapDay,,}/${previousFileName}"
-                echo "    type: ${typesOfYear[1]}" >> "${newFile}"
-                echo "    starting: ${leapDay}" >> "${newFile}"
-                echo "    file: <${relativePathFile}>" >> "${newFile}"
+                echo "    type: ${typesOfYear[1]}" >&3
+                echo "    starting: ${leapDay}" >&3
+                echo "    file: <${relativePathFile}>" >&3
               else
                 #(list) Link to the previous Common year (current year: Common)
                 commonDay="${previousDayNameCommon}"
                 switchTypeOfYear="${typesOfYear[0]}"
                 relativePathFile="../../${switchTypeOfYear,,}/${commonDay,,}/${previousFileName}"
-                echo "    - type: ${typesOfYear[0]}" >> "${newFile}"
-                echo "      starting: ${commonDay}" >> "${newFile}"
-                echo "      file: <${relativePathFile}>" >> "${newFile}"
+                echo "    - type: ${typesOfYear[0]}" >&3
+                echo "      starting: ${commonDay}" >&3
+                echo "      file: <${relativePathFile}>" >&3
                 #(list) Link to the previous Leap year (current year: Common)
                 leapDay="${previousDayNameLeap}"
                 switchTypeOfYear="${typesOfYear[1]}"
                 relativePathFile="../../${switchTypeOfYear,,}/${leapDay,,}/${previousFileName}"
-                echo "    - type: ${typesOfYear[1]}" >> "${newFile}"
-                echo "      starting: ${leapDay}" >> "${newFile}"
-                echo "      file: <${relativePathFile}>" >> "${newFile}"
+                echo "    - type: ${typesOfYear[1]}" >&3
+                echo "      starting: ${leapDay}" >&3
+                echo "      file: <${relativePathFile}>" >&3
               fi
             else
               #(No list) Link to the previous common year only (current year: leap)
               commonDay="${previousDayNameCommon}"
               switchTypeOfYear="${typesOfYear[0]}"
               relativePathFile="../../${switchTypeOfYear,,}/${commonDay,,}/${previousFileName}"
-              echo "    type: ${typesOfYear[0]}" >> "${newFile}"
-              echo "    starting: ${commonDay}" >> "${newFile}"
-              echo "    file: <${relativePathFile}>" >> "${newFile}"
+              echo "    type: ${typesOfYear[0]}" >&3
+              echo "    starting: ${commonDay}" >&3
+              echo "    file: <${relativePathFile}>" >&3
             fi
           fi
           
           #YAML : Add "next" section to the CURRENT file
-          echo "next:" >> "${newFile}"
+          echo "next:" >&3
           if (( "${month}" < 12 )); then
             nextMonth=$((${month}+1))
             nextMonthName="${months[${nextMonth}-1]}"
@@ -255,34 +277,34 @@ doColumnMode(){
             else
               nextFileName="./m${nextMonth}-${nextMonthName,,}.txt"
             fi
-            echo "  month: ${nextMonthName}" >> "${newFile}"
-            echo "  file: <${nextFileName}>" >> "${newFile}"
+            echo "  month: ${nextMonthName}" >&3
+            echo "  file: <${nextFileName}>" >&3
           else
             nextMonthName="${months[0]}"
             nextFileName="m01-${nextMonthName,,}.txt"
-            echo "  month: ${nextMonthName}" >> "${newFile}"
-            echo "  year: " >> "${newFile}"
+            echo "  month: ${nextMonthName}" >&3
+            echo "  year: " >&3
             nextDayName=`getDay "${dayName}" "1"`
             #Check the current type of the year
             if [[ "${typeOfYear}" == "${typesOfYear[0]}" ]]; then
-              echo "    starting: ${nextDayName}" >> "${newFile}"
+              echo "    starting: ${nextDayName}" >&3
               if [[ "${weekNumber}" == "W53" && "${dayName}" == "Saturday" ]]; then
                 #(NO list) link to the next common year (as leap was previous)
                 switchTypeOfYear="${typesOfYear[0]}"
                 relativePathFile="../../${switchTypeOfYear,,}/${nextDayName,,}/${nextFileName}"
-                echo "    type: ${switchTypeOfYear}" >> "${newFile}"
-                echo "    file: <${relativePathFile}>" >> "${newFile}"
+                echo "    type: ${switchTypeOfYear}" >&3
+                echo "    file: <${relativePathFile}>" >&3
               else
                 #(list) link to next common year (current year: Common)
                 switchTypeOfYear="${typesOfYear[0]}"
                 relativePathFile="../../${switchTypeOfYear,,}/${nextDayName,,}/${nextFileName}"
-                echo "    - type: ${switchTypeOfYear}" >> "${newFile}"
-                echo "      file: <${relativePathFile}>" >> "${newFile}"
+                echo "    - type: ${switchTypeOfYear}" >&3
+                echo "      file: <${relativePathFile}>" >&3
                 #(list) link to next leap year (current year: Common)
                 switchTypeOfYear="${typesOfYear[1]}"
                 relativePathFile="../../${switchTypeOfYear,,}/${nextDayName,,}/${nextFileName}"
-                echo "    - type: ${switchTypeOfYear}" >> "${newFile}"
-                echo "      file: <${relativePathFile}>" >> "${newFile}"
+                echo "    - type: ${switchTypeOfYear}" >&3
+                echo "      file: <${relativePathFile}>" >&3
               fi
             else
               #link to the next Common year ONLY (current year: Leap)
@@ -299,15 +321,16 @@ doColumnMode(){
               fi
               switchTypeOfYear="${typesOfYear[0]}"
               relativePathFile="../../${switchTypeOfYear,,}/${nextDayName,,}/${nextFileName}"
-              echo "    starting: ${nextDayName}" >> "${newFile}"
-              echo "    type: ${switchTypeOfYear}" >> "${newFile}"
-              echo "    file: <${relativePathFile}>" >> "${newFile}"
+              echo "    starting: ${nextDayName}" >&3
+              echo "    type: ${switchTypeOfYear}" >&3
+              echo "    file: <${relativePathFile}>" >&3
             fi
           fi
           
           #End of YAML section
-          echo "..." >> "${newFile}"
+          echo "..." >&3
         fi
+        exec 3>&-
       fi
     done
   done
@@ -315,237 +338,11 @@ doColumnMode(){
 
 doGridMode(){
   startingDay="$1"
-  doRegex="yes"
-  doYAML="yes"
-
-  #YEAR LOOP
-  for year in "${yearsList[@]}"; do
-  
-    #Get information from the year
-    isLeap=`$calendarBin 1 "${year}" "-start=${startingDay}" -LeapYear`
-    weekNumber=`$calendarBin 1 1 "${year}" "-start=${startingDay}" -WkN`
-    dayName=`$calendarBin 1 1 "${year}" "-start=${startingDay}" -WD`
-
-    #Get the type of the year (common or leap)
-    typeOfYear="${typesOfYear[${isLeap}]}"
-    #Create the path
-    path="${startingDay,,}/grid/${typeOfYear,,}"
-    
-    #Saturday+W53 is an exception
-    FolderDayName="${dayName}"
-    if [[ "${weekNumber}" == "W53" && "${dayName}" == "Saturday" ]]; then
-      FolderDayName="${FolderDayName}-W53"
-    fi
-    
-    #Create the weekday folder
-    path="${path}/${FolderDayName,,}"
-
-    #Create folders if needed
-    if [ ! -d "${path}" ]; then
-      mkdir -p "${path}"
-    fi
-
-    #Add the title to the index file
-    echo "" >> "${path}/${indexFile}"
-    echo "## Calendars" >> "${path}/${indexFile}"
-    echo "" >> "${path}/${indexFile}"
-
-    #MONTH LOOP
-    for (( month=1; month<13; month++ )); do 
-    
-      monthName="${months[${month}-1]}"
-      #Add the month to the filename
-      if (( month < 10 )); then
-        newFile="${path}/m0${month}-${monthName,,}.txt"
-      else
-        newFile="${path}/m${month}-${monthName,,}.txt"
-      fi
-      #Get the filename (used to link to the file)
-      filename="${newFile##*/}"
-
-      #Continue if file doesn't exist
-      if [[ ! -f "${newFile}" ]]; then
 
-        if [[ -e "${path}/${indexFile}" ]]; then
-          # Add the month to the index file
-          echo "[${monthName}](./${filename})" >> "${path}/${indexFile}"
-        fi
-
-        #call the program, write the result to a file
-        $calendarBin "${month}" "${year}" "-view=g" "-start=${startingDay}" "-WkN=left" "-WD" > "${newFile}"
-        
-        #######################################################################
-        ##REGEX
-        if [[ "${doRegex}" == "yes" ]]; then
-          #Add space to the month names
-          addSpacesMonth=""
-          for((i=${#monthName}; i<9; i++)); do
-            addSpacesMonth="${addSpacesMonth} "
-          done
-          
-          #YEAR HEADER (1st line)
-          regexPattern="^${monthName} [^\n]*"
-          regexReplace="+---+--------------------+\n"
-          regexReplace="${regexReplace}|   |${monthName}${addSpacesMonth}           |\n"
-          regexReplace="${regexReplace}+---+--+--+--+--+--+--+--+"
-          sed "-i" "-E" "-e" "s/${regexPattern}/${regexReplace}/gm" "${newFile}"
-          
-          #SUB-HEADER
-          regexPattern="^(W[^0-9][^0-9]) (..) (..) (..) (..) (..) (..) (..)"
-          regexReplace="|\1|\2|\3|\4|\5|\6|\7|\8|\n"
-          regexReplace="${regexReplace}+===+==+==+==+==+==+==+==+"
-          sed "-i" "-E" "-e" "s/${regexPattern}/${regexReplace}/gm" "${newFile}"
-          
-          #LINES
-          regexPattern="^(W[0-9][0-9]) (..) (..) (..) (..) (..) (..) (..)"
-          regexReplace="|\1|\2|\3|\4|\5|\6|\7|\8|\n"
-          regexReplace="${regexReplace}+---+--+--+--+--+--+--+--+"
-          sed "-i" "-E" "-e" "s/${regexPattern}/${regexReplace}/gm" "${newFile}"
-        fi
-        
-        #######################################################################
-        ##YAML 
-        if [[ "${doYAML}" == "yes" ]]; then
-        
-          #YAML : Add current section to the file
-          echo "" >> "${newFile}"
-          echo "---" >> "${newFile}"
-          echo "current:" >> "${newFile}"
-          echo "  month: ${monthName}" >> "${newFile}"
-          echo "  year: " >> "${newFile}"
-          echo "    starting: ${dayName}" >> "${newFile}"
-          echo "    type: ${typeOfYear}" >> "${newFile}"
-          echo "    index: <./${indexFile}>" >> "${newFile}"
-          echo "  file: <./${filename}>" >> "${newFile}"
-          echo "    license: public domain" >> "${newFile}"
-
-          #YAML : Add the "previous" section to the CURRENT file
-          echo "previous:" >> "${newFile}"
-          if (( "${month}" > 1 )); then
-            #Set for previous month in the current year
-            previousMonth=$((${month}-1))
-            previousMonthName="${months[${previousMonth}-1]}"
-            if (( previousMonth < 10 )); then
-              previousFileName="./m0${previousMonth}-${previousMonthName,,}.txt"
-            else
-              previousFileName="./m${previousMonth}-${previousMonthName,,}.txt"
-            fi
-            echo "  month: ${previousMonthName}" >> "${newFile}"
-            echo "  file: <${previousFileName}>" >> "${newFile}"
-          else
-            #Set for December in the previous year
-            previousMonthName="${months[11]}"
-            previousFileName="m12-${previousMonthName,,}.txt"
-            #Get 1st day of previous year, common (-1d) and leap (-2d)
-            previousDayNameCommon=`getDay "${dayName}" "-1"`
-            previousDayNameLeap=`getDay "${previousDayNameCommon}" "-1"`
-            echo "  month: ${previousMonthName}" >> "${newFile}"
-            echo "  year: " >> "${newFile}"
-            #Check if current year is common or not
-            if [[ "${typeOfYear}" == "${typesOfYear[0]}" ]]; then
-              #Saturday+W53 is an exception (a Common year AFTER a leap year)
-              if [[ "${weekNumber}" == "W53" && "${dayName}" == "Saturday" ]]; then
-                #(NO list) Link to the previous Leap year
-                leapDay="${previousDayNameLeap}"
-                switchTypeOfYear="${typesOfYear[1]}"
-                relativePathFile="../../${switchTypeOfYear,,}/${leapDay,,}/${previousFileName}"
-                echo "    type: ${typesOfYear[1]}" >> "${newFile}"
-                echo "    starting: ${leapDay}" >> "${newFile}"
-                echo "    file: <${relativePathFile}>" >> "${newFile}"
-              else
-                #(list) Link to the previous Common year (current year: Common)
-                commonDay="${previousDayNameCommon}"
-                switchTypeOfYear="${typesOfYear[0]}"
-                relativePathFile="../../${switchTypeOfYear,,}/${commonDay,,}/${previousFileName}"
-                echo "    - type: ${typesOfYear[0]}" >> "${newFile}"
-                echo "      starting: ${commonDay}" >> "${newFile}"
-                echo "      file: <${relativePathFile}>" >> "${newFile}"
-                #(list) Link to the previous Leap year (current year: Common)
-                leapDay="${previousDayNameLeap}"
-                switchTypeOfYear="${typesOfYear[1]}"
-                relativePathFile="../../${switchTypeOfYear,,}/${leapDay,,}/${previousFileName}"
-                echo "    - type: ${typesOfYear[1]}" >> "${newFile}"
-                echo "      starting: ${leapDay}" >> "${newFile}"
-                echo "      file: <${relativePathFile}>" >> "${newFile}"
-              fi
-            else
-              #(No list) Link to the previous common year only (current year: leap)
-              commonDay="${previousDayNameCommon}"
-              switchTypeOfYear="${typesOfYear[0]}"
-              relativePathFile="../../${switchTypeOfYear,,}/${commonDay,,}/${previousFileName}"
-              echo "    type: ${typesOfYear[0]}" >> "${newFile}"
-              echo "    starting: ${commonDay}" >> "${newFile}"
-              echo "    file: <${relativePathFile}>" >> "${newFile}"
-            fi
-          fi
-          
-          #YAML : Add "next" section to the CURRENT file
-          echo "next:" >> "${newFile}"
-          if (( "${month}" < 12 )); then
-            nextMonth=$((${month}+1))
-            nextMonthName="${months[${nextMonth}-1]}"
-            if (( nextMonth < 10 )); then
-              nextFileName="./m0${nextMonth}-${nextMonthName,,}.txt"
-            else
-              nextFileName="./m${nextMonth}-${nextMonthName,,}.txt"
-            fi
-            echo "  month: ${nextMonthName}" >> "${newFile}"
-            echo "  file: <${nextFileName}>" >> "${newFile}"
-          else
-            nextMonthName="${months[0]}"
-            nextFileName="m01-${nextMonthName,,}.txt"
-            echo "  month: ${nextMonthName}" >> "${newFile}"
-            echo "  year: " >> "${newFile}"
-            nextDayName=`getDay "${dayName}" "1"`
-            #Check the current type of the year
-            if [[ "${typeOfYear}" == "${typesOfYear[0]}" ]]; then
-              echo "    starting: ${nextDayName}" >> "${newFile}"
-              if [[ "${weekNumber}" == "W53" && "${dayName}" == "Saturday" ]]; then
-                #(NO list) link to the next common year (as leap was previous)
-                switchTypeOfYear="${typesOfYear[0]}"
-                relativePathFile="../../${switchTypeOfYear,,}/${nextDayName,,}/${nextFileName}"
-                echo "    type: ${switchTypeOfYear}" >> "${newFile}"
-                echo "    file: <${relativePathFile}>" >> "${newFile}"
-              else
-                #(list) link to next common year (current year: Common)
-                switchTypeOfYear="${typesOfYear[0]}"
-                relativePathFile="../../${switchTypeOfYear,,}/${nextDayName,,}/${nextFileName}"
-                echo "    - type: ${switchTypeOfYear}" >> "${newFile}"
-                echo "      file: <${relativePathFile}>" >> "${newFile}"
-                #(list) link to next leap year (current year: Common)
-                switchTypeOfYear="${typesOfYear[1]}"
-                relativePathFile="../../${switchTypeOfYear,,}/${nextDayName,,}/${nextFileName}"
-                echo "    - type: ${switchTypeOfYear}" >> "${newFile}"
-                echo "      file: <${relativePathFile}>" >> "${newFile}"
-              fi
-            else
-              #link to the next Common year ONLY (current year: Leap)
-              nextDayName=`getDay "${nextDayName}" "1"`
-              #Saturday+W53 is an exception (a Common year AFTER a leap year)
-              if [[ "${nextDayName}" == "Saturday" ]]; then
-                #Check the week number 
-                nextYear=$((year+1))
-                nextWeekNumber=`$calendarBin 1 1 "${nextYear}" "-start=${startingDay}" -WkN`
-                #if week number is W53 (and current day Saturday) : add W53 to the name
-                if [[ "${nextWeekNumber}" == "W53" ]]; then
-                  nextDayName="${nextDayName}-W53"
-                fi
-              fi
-              switchTypeOfYear="${typesOfYear[0]}"
-              relativePathFile="../../${switchTypeOfYear,,}/${nextDayName,,}/${nextFileName}"
-              echo "    starting: ${nextDayName}" >> "${newFile}"
-              echo "    type: ${switchTypeOfYear}" >> "${newFile}"
-              echo "    file: <${relativePathFile}>" >> "${newFile}"
-            fi
-          fi
-          
-          #End of YAML section
-          echo "..." >> "${newFile}"
-          
-        fi
-      fi
-    done
-  done
+  #Month pages (markdown table + YAML navigation) for all years of the list,
+  #the navigation between years is computed once by the program
+  #(the years list is the same than yearsList)
+  $calendarBin "-start=${startingDay}" "-pages" "."
 }
 
 doContinousView(){
@@ -591,11 +388,12 @@ doContinousView(){
 
       #Add the file to index
       if [[ -e "${path}/${indexFile}" ]]; then
-        echo "" >> "${path}/${indexFile}"
-        echo "[Continuous](./${filename})" >> "${path}/${indexFile}"
+        printf "\n[Continuous](./%s)\n" "${filename}" >> "${path}/${indexFile}"
       fi
 
-      $calendarBin "${year}" "-view=g" "-start=${startingDay}" "-WkN=left" "-compact" > "${newFile}"
+      #Regex applied to the output of the program (see sedPipeline)
+      sedExpressions=()
+      tableEnd=""
 
       if [[ "${doRegex}" == "yes" ]]; then
         
@@ -603,32 +401,39 @@ doContinousView(){
         regexPattern="^(   ) (W[0-9][0-9]) (..) (..) (..) (..) (..) (..) (..)"
         regexReplace="+   +---+--+--+--+--+--+--+--+\n"
         regexReplace="${regexReplace}|\1|\2|\3|\4|\5|\6|\7|\8|\9|"
-        sed "-i" "-E" "-e" "s/${regexPattern}/${regexReplace}/gm" "${newFile}"
+        sedExpressions+=("s/${regexPattern}/${regexReplace}/gm")
         
         #LINES with new month
         regexPattern="^(...) (W[0-9][0-9]) (..) (..) (..) (..) (..) (..) (..)"
         regexReplace="+---+---+--+--+--+--+--+--+--+\n"
         regexReplace="${regexReplace}|\1|\2|\3|\4|\5|\6|\7|\8|\9|"
-        sed "-i" "-E" "-e" "s/${regexPattern}/${regexReplace}/gm" "${newFile}"
+        sedExpressions+=("s/${regexPattern}/${regexReplace}/gm")
         
         #replace the 1st line separator for the sub-header
         regexPattern="^\+---\+---\+--\+--\+--\+--\+--\+--\+--\+"
         regexReplace="+===+===+==+==+==+==+==+==+==+"
-        sed "-i" "-E" "-e" "0,/${regexPattern}/{s/${regexPattern}/${regexReplace}/}" "${newFile}"
+        sedExpressions+=("0,/${regexPattern}/{s/${regexPattern}/${regexReplace}/}")
         
         #replace the year with table border
         regexPattern="^.*${year}:"
         regexReplace="+---+---+--+--+--+--+--+--+--+"
-        sed "-i" "-E" "-e" "s/${regexPattern}/${regexReplace}/gm" "${newFile}"
+        sedExpressions+=("s/${regexPattern}/${regexReplace}/gm")
         
         #Sub
         regexPattern="^(...) (W[^0-9][^0-9]) (..) (..) (..) (..) (..) (..) (..)"
         regexReplace="|\1|\2|\3|\4|\5|\6|\7|\8|\9|"
-        sed "-i" "-E" "-e" "s/${regexPattern}/${regexReplace}/gm" "${newFile}"
+        sedExpressions+=("s/${regexPattern}/${regexReplace}/gm")
 
         #Add the end of the table manually...
-        echo "+---+---+--+--+--+--+--+--+--+" >>"${newFile}"
+        tableEnd="+---+---+--+--+--+--+--+--+--+"
+
+      fi
 
+      #call the program : the file is written once, then completed
+      exec 3>"${newFile}"
+      $calendarBin "${year}" "-view=g" "-start=${startingDay}" "-WkN=left" "-compact" | sedPipeline "${sedExpressions[@]}" >&3
+      if [[ -n "${tableEnd}" ]]; then
+        echo "${tableEnd}" >&3
       fi
 
       #######################################################################
@@ -636,23 +441,23 @@ doContinousView(){
       if [[ "${doYAML}" == "yes" ]]; then
 
         #YAML : Add current section to the file
-        echo "" >> "${newFile}"
-        echo "---" >> "${newFile}"
-        echo "current:" >> "${newFile}"
-        echo "  year: " >> "${newFile}"
-        echo "    starting: ${dayName}" >> "${newFile}"
-        echo "    type: ${typeOfYear}" >> "${newFile}"
-        echo "    index: <./${indexFile}>" >> "${newFile}"
-        echo "  file: <./${filename}>" >> "${newFile}"
-        echo "    license: public domain" >> "${newFile}"
+        echo "" >&3
+        echo "---" >&3
+        echo "current:" >&3
+        echo "  year: " >&3
+        echo "    starting: ${dayName}" >&3
+        echo "    type: ${typeOfYear}" >&3
+        echo "    index: <./${indexFile}>" >&3
+        echo "  file: <./${filename}>" >&3
+        echo "    license: public domain" >&3
 
         #YAML : Add the "previous" section to the CURRENT file
-        echo "previous:" >> "${newFile}"
+        echo "previous:" >&3
 
         previousDayNameCommon=`getDay "${dayName}" "-1"`
         previousDayNameLeap=`getDay "${previousDayNameCommon}" "-1"`
 
-        echo "  year: " >> "${newFile}"
+        echo "  year: " >&3
         #Check if current year is common or not
         if [[ "${typeOfYear}" == "${typesOfYear[0]}" ]]; then
           #Saturday+W53 is an exception (a Common year AFTER a leap year)
@@ -661,33 +466,33 @@ doContinousView(){
             commonDay="${previousDayNameCommon}"
             switchTypeOfYear="${typesOfYear[0]}"
             relativePathFile="../../${switchTypeOfYear,,}/${commonDay,,}/${filename}"
-            echo "    type: ${typesOfYear[0]}" >> "${newFile}"
-            echo "    starting: ${commonDay}" >> "${newFile}"
-            echo "    file: <${relativePathFile}>" >> "${newFile}"
+            echo "    type: ${typesOfYear[0]}" >&3
+            echo "    starting: ${commonDay}" >&3
+            echo "    file: <${relativePathFile}>" >&3
           else
             #(list) Link to the previous Common year (current year: Common)
             commonDay="${previousDayNameCommon}"
             switchTypeOfYear="${typesOfYear[0]}"
             relativePathFile="../../${switchTypeOfYear,,}/${commonDay,,}/${filename}"
-            echo "    - type: ${typesOfYear[0]}" >> "${newFile}"
-            echo "      starting: ${commonDay}" >> "${newFile}"
-            echo "      file: <${relativePathFile}>" >> "${newFile}"
+            echo "    - type: ${typesOfYear[0]}" >&3
+            echo "      starting: ${commonDay}" >&3
+            echo "      file: <${relativePathFile}>" >&3
             #(list) Link to the previous Leap year (current year: Common)
             leapDay="${previousDayNameLeap}"
             switchTypeOfYear="${typesOfYear[1]}"
             relativePathFile="../../${switchTypeOfYear,,}/${leapDay,,}/${filename}"
-            echo "    - type: ${typesOfYear[1]}" >> "${newFile}"
-            echo "      starting: ${leapDay}" >> "${newFile}"
-            echo "      file: <${relativePathFile}>" >> "${newFile}"
+            echo "    - type: ${typesOfYear[1]}" >&3
+            echo "      starting: ${leapDay}" >&3
+            echo "      file: <${relativePathFile}>" >&3
           fi
         else
           #a Leap year : Link to the next common year only
           commonDay="${previousDayNameCommon}"
           switchTypeOfYear="${typesOfYear[0]}"
           relativePathFile="../../${switchTypeOfYear,,}/${commonDay,,}/${filename}"
-          echo "    type: ${typesOfYear[0]}" >> "${newFile}"
-          echo "    starting: ${commonDay}" >> "${newFile}"
-          echo "    file: <${relativePathFile}>" >> "${newFile}"
+          echo "    type: ${typesOfYear[0]}" >&3
+          echo "    starting: ${commonDay}" >&3
+          echo "    file: <${relativePathFile}>" >&3
         fi
 
         #Get the next dayname
@@ -708,9 +513,9 @@ doContinousView(){
           fi
         fi
 
-        echo "next:" >> "${newFile}"
-        echo "  year: " >> "${newFile}"
-        echo "    starting: ${nextDayName}" >> "${newFile}"
+        echo "next:" >&3
+        echo "  year: " >&3
+        echo "    starting: ${nextDayName}" >&3
         #Check if the previous year is common or not
         if [[ "${typeOfYear}" == "${typesOfYear[0]}" ]]; then
           #Saturday+W53 is an exception (a Common year AFTER a leap year)
@@ -718,32 +523,33 @@ doContinousView(){
             #(NO list) Link to the next common year
             switchTypeOfYear="${typesOfYear[0]}"
             relativePathFile="../../${switchTypeOfYear,,}/${nextDayName,,}/${filename}"
-            echo "    type: ${switchTypeOfYear}" >> "${newFile}"
-            echo "    file: <${relativePathFile}>" >> "${newFile}"
+            echo "    type: ${switchTypeOfYear}" >&3
+            echo "    file: <${relativePathFile}>" >&3
           else
             #(list) link to next common year for a Common year
             switchTypeOfYear="${typesOfYear[0]}"
             relativePathFile="../../${switchTypeOfYear,,}/${nextDayName,,}/${filename}"
-            echo "    - type: ${switchTypeOfYear}" >> "${newFile}"
-            echo "      file: <${relativePathFile}>" >> "${newFile}"
+            echo "    - type: ${switchTypeOfYear}" >&3
+            echo "      file: <${relativePathFile}>" >&3
             #(list) link to next leap year for a Common year
             switchTypeOfYear="${typesOfYear[1]}"
             relativePathFile="../../${switchTypeOfYear,,}/${nextDayName,,}/${filename}"
-            echo "    - type: ${switchTypeOfYear}" >> "${newFile}"
-            echo "      file: <${relativePathFile}>" >> "${newFile}"
+            echo "    - type: ${switchTypeOfYear}" >&3
+            echo "      file: <${relativePathFile}>" >&3
           fi
         else
           #(No list) Link to the previous common year only (current year: leap)
           switchTypeOfYear="${typesOfYear[0]}"
           relativePathFile="../../${switchTypeOfYear,,}/${nextDayName,,}/${filename}"
-          echo "    type: ${switchTypeOfYear}" >> "${newFile}"
-          echo "    file: <${relativePathFile}>" >> "${newFile}"
+          echo "    type: ${switchTypeOfYear}" >&3
+          echo "    file: <${relativePathFile}>" >&3
         fi
 
         #End of YAML section
-        echo "..." >> "${newFile}"
+        echo "..." >&3
 
       fi
+      exec 3>&-
     fi
   done
 }
@@ -792,11 +598,12 @@ doMultipleView(){
   
       #Add the file to index
       if [[ -e "${path}/${indexFile}" ]]; then
-        echo "" >> "${path}/${indexFile}"
-        echo "[All months](./${filename})" >> "${path}/${indexFile}"
+        printf "\n[All months](./%s)\n" "${filename}" >> "${path}/${indexFile}"
       fi
   
-      $calendarBin "${year}" "-view=g" "-start=${startingDay}" "-WkN=left" "-col" "3" > "${newFile}"
+      #Regex applied to the output of the program (see sedPipeline)
+      sedExpressions=()
+      tableEnd=""
       
       if [[ "${doRegex}" == "yes" ]]; then
 
@@ -806,7 +613,7 @@ doMultipleView(){
         regexReplace="${regexReplace}+---+--+--+--+--+--+--+--+"
         regexReplace="${regexReplace} +---+--+--+--+--+--+--+--+"
         regexReplace="${regexReplace} +---+--+--+--+--+--+--+--+"
-        sed "-i" "-E" "-e" "s/${regexPattern}/${regexReplace}/gm" "${newFile}"
+        sedExpressions+=("s/${regexPattern}/${regexReplace}/gm")
         
         # HEADER
         regexPattern="^(W[^0-9 ][^0-9 ] .*)"
@@ -814,18 +621,18 @@ doMultipleView(){
         regexReplace="${regexReplace}+===+==+==+==+==+==+==+==+"
         regexReplace="${regexReplace} +===+==+==+==+==+==+==+==+"
         regexReplace="${regexReplace} +===+==+==+==+==+==+==+==+"
-        sed "-i" "-E" "-e" "s/${regexPattern}/${regexReplace}/gm" "${newFile}"
+        sedExpressions+=("s/${regexPattern}/${regexReplace}/gm")
 
         for((i=0; i<4; i++)); do
           #Correct the header 
           regexPattern="(W[^0-9 ][^0-9 ]) (..) (..) (..) (..) (..) (..) (..)"
           regexReplace="|\1|\2|\3|\4|\5|\6|\7|\8|"
-          sed "-i" "-E" "-e" "s/${regexPattern}/${regexReplace}/gm" "${newFile}"
+          sedExpressions+=("s/${regexPattern}/${regexReplace}/gm")
           
           #Change the lines
           regexPattern="([W ][0-9 ][0-9 ]) ([0-9 ][0-9 ]) ([0-9 ][0-9 ]) ([0-9 ][0-9 ]) ([0-9 ][0-9 ]) ([0-9 ][0-9 ]) ([0-9 ][0-9 ]) ([0-9 ][0-9 ])"
           regexReplace="|\1|\2|\3|\4|\5|\6|\7|\8|"
-          sed "-i" "-E" "-e" "s/${regexPattern}/${regexReplace}/gm" "${newFile}"
+          sedExpressions+=("s/${regexPattern}/${regexReplace}/gm")
         done
 
         #replace the year with table border
@@ -833,7 +640,7 @@ doMultipleView(){
         regexReplace="+---+--------------------+"
         regexReplace="${regexReplace} +---+--------------------+"
         regexReplace="${regexReplace} +---+--------------------+"
-        sed "-i" "-E" "-e" "s/${regexPattern}/${regexReplace}/gm" "${newFile}"
+        sedExpressions+=("s/${regexPattern}/${regexReplace}/gm")
 
         for((row=0; row<12; row=row+3)); do
           regexPattern="${months[$row]} *${months[$row+1]} *${months[$row+2]} *"
@@ -857,44 +664,51 @@ doMultipleView(){
           regexReplace="${regexReplace}+---+--+--+--+--+--+--+--+"
           regexReplace="${regexReplace} +---+--+--+--+--+--+--+--+"
           regexReplace="${regexReplace} +---+--+--+--+--+--+--+--+"
-          sed "-i" "-E" "-e" "s/${regexPattern}/${regexReplace}/gm" "${newFile}"
+          sedExpressions+=("s/${regexPattern}/${regexReplace}/gm")
         done
         
         #Correct the columns space, between months
         regexPattern="\|\|"
         regexReplace="| |"
-        sed "-i" "-E" "-e" "s/${regexPattern}/${regexReplace}/gm" "${newFile}"
+        sedExpressions+=("s/${regexPattern}/${regexReplace}/gm")
         regexPattern="\|  *\|W"
         regexReplace="| |W"
-        sed "-i" "-E" "-e" "s/${regexPattern}/${regexReplace}/gm" "${newFile}"
+        sedExpressions+=("s/${regexPattern}/${regexReplace}/gm")
         regexPattern="\| *$"
         regexReplace="|"
-        sed "-i" "-E" "-e" "s/${regexPattern}/${regexReplace}/gm" "${newFile}"
+        sedExpressions+=("s/${regexPattern}/${regexReplace}/gm")
        
       fi
         
+      #call the program : the file is written once, then completed
+      exec 3>"${newFile}"
+      $calendarBin "${year}" "-view=g" "-start=${startingDay}" "-WkN=left" "-col" "3" | sedPipeline "${sedExpressions[@]}" >&3
+      if [[ -n "${tableEnd}" ]]; then
+        echo "${tableEnd}" >&3
+      fi
+
       #######################################################################
       ##YAML 
       if [[ "${doYAML}" == "yes" ]]; then
         
         #YAML : Add current section to the file
-        echo "" >> "${newFile}"
-        echo "---" >> "${newFile}"
-        echo "current:" >> "${newFile}"
-        echo "  year: " >> "${newFile}"
-        echo "    starting: ${dayName}" >> "${newFile}"
-        echo "    type: ${typeOfYear}" >> "${newFile}"
-        echo "    index: <./${indexFile}>" >> "${newFile}"
-        echo "  file: <./${filename}>" >> "${newFile}"
-        echo "    license: public domain" >> "${newFile}"
+        echo "" >&3
+        echo "---" >&3
+        echo "current:" >&3
+        echo "  year: " >&3
+        echo "    starting: ${dayName}" >&3
+        echo "    type: ${typeOfYear}" >&3
+        echo "    index: <./${indexFile}>" >&3
+        echo "  file: <./${filename}>" >&3
+        echo "    license: public domain" >&3
 
         #YAML : Add the "previous" section to the CURRENT file
-        echo "previous:" >> "${newFile}"
+        echo "previous:" >&3
 
         previousDayNameCommon=`getDay "${dayName}" "-1"`
         previousDayNameLeap=`getDay "${previousDayNameCommon}" "-1"`
 
-        echo "  year: " >> "${newFile}"
+        echo "  year: " >&3
         #Check if current year is common or not
         if [[ "${typeOfYear}" == "${typesOfYear[0]}" ]]; then
           #Saturday+W53 is an exception (a Common year AFTER a leap year)
@@ -903,33 +717,33 @@ doMultipleView(){
             commonDay="${previousDayNameCommon}"
             switchTypeOfYear="${typesOfYear[0]}"
             relativePathFile="../../${switchTypeOfYear,,}/${commonDay,,}/${filename}"
-            echo "    - type: ${typesOfYear[0]}" >> "${newFile}"
-            echo "      starting: ${commonDay}" >> "${newFile}"
-            echo "      file: <${relativePathFile}>" >> "${newFile}"
+            echo "    - type: ${typesOfYear[0]}" >&3
+            echo "      starting: ${commonDay}" >&3
+            echo "      file: <${relativePathFile}>" >&3
           else
             #(list) Link to the previous Common year (current year: Common)
             commonDay="${previousDayNameCommon}"
             switchTypeOfYear="${typesOfYear[0]}"
             relativePathFile="../../${switchTypeOfYear,,}/${commonDay,,}/${filename}"
-            echo "    - type: ${typesOfYear[0]}" >> "${newFile}"
-            echo "      starting: ${commonDay}" >> "${newFile}"
-            echo "      file: <${relativePathFile}>" >> "${newFile}"
+            echo "    - type: ${typesOfYear[0]}" >&3
+            echo "      starting: ${commonDay}" >&3
+            echo "      file: <${relativePathFile}>" >&3
             #(list) Link to the previous Leap year (current year: Common)
             leapDay="${previousDayNameLeap}"
             switchTypeOfYear="${typesOfYear[1]}"
             relativePathFile="../../${switchTypeOfYear,,}/${leapDay,,}/${filename}"
-            echo "    - type: ${typesOfYear[1]}" >> "${newFile}"
-            echo "      starting: ${leapDay}" >> "${newFile}"
-            echo "      file: <${relativePathFile}>" >> "${newFile}"
+            echo "    - type: ${typesOfYear[1]}" >&3
+            echo "      starting: ${leapDay}" >&3
+            echo "      file: <${relativePathFile}>" >&3
           fi
         else
           #(No list) Link to the previous common year only (current year: leap)
           commonDay="${previousDayNameCommon}"
           switchTypeOfYear="${typesOfYear[0]}"
           relativePathFile="../../${switchTypeOfYear,,}/${commonDay,,}/${filename}"
-          echo "    type: ${typesOfYear[0]}" >> "${newFile}"
-          echo "    starting: ${commonDay}" >> "${newFile}"
-          echo "    file: <${relativePathFile}>" >> "${newFile}"
+          echo "    type: ${typesOfYear[0]}" >&3
+          echo "    starting: ${commonDay}" >&3
+          echo "    file: <${relativePathFile}>" >&3
         fi
         
         #Get the next dayname
@@ -950,9 +764,9 @@ doMultipleView(){
           fi
         fi
         
-        echo "next:" >> "${newFile}"
-        echo "  year: " >> "${newFile}"
-        echo "    starting: ${nextDayName}" >> "${newFile}"
+        echo "next:" >&3
+        echo "  year: " >&3
+        echo "    starting: ${nextDayName}" >&3
         #Check if the previous year is common or not
         if [[ "${typeOfYear}" == "${typesOfYear[0]}" ]]; then
           #Saturday+W53 is an exception (a Common year AFTER a leap year)
@@ -960,31 +774,32 @@ doMultipleView(){
             #(NO list) Link to the next common year
             switchTypeOfYear="${typesOfYear[0]}"
             relativePathFile="../../${switchTypeOfYear,,}/${nextDayName,,}/${filename}"
-            echo "    type: ${switchTypeOfYear}" >> "${newFile}"
-            echo "    file: <${relativePathFile}>" >> "${newFile}"
+            echo "    type: ${switchTypeOfYear}" >&3
+            echo "    file: <${relativePathFile}>" >&3
           else
             #(list) Link to the next common year
             switchTypeOfYear="${typesOfYear[0]}"
             relativePathFile="../../${switchTypeOfYear,,}/${nextDayName,,}/${filename}"
-            echo "    - type: ${switchTypeOfYear}" >> "${newFile}"
-            echo "      file: <${relativePathFile}>" >> "${newFile}"
+            echo "    - type: ${switchTypeOfYear}" >&3
+            echo "      file: <${relativePathFile}>" >&3
             #(list) link to next leap year for a Common year
             switchTypeOfYear="${typesOfYear[1]}"
             relativePathFile="../../${switchTypeOfYear,,}/${nextDayName,,}/${filename}"
-            echo "    - type: ${switchTypeOfYear}" >> "${newFile}"
-            echo "      file: <${relativePathFile}>" >> "${newFile}"
+            echo "    - type: ${switchTypeOfYear}" >&3
+            echo "      file: <${relativePathFile}>" >&3
           fi
         else
           #a Leap year : link to the next Common year only
           switchTypeOfYear="${typesOfYear[0]}"
           relativePathFile="../../${switchTypeOfYear,,}/${nextDayName,,}/${filename}"
-          echo "    type: ${switchTypeOfYear}" >> "${newFile}"
-          echo "    file: <${relativePathFile}>" >> "${newFile}"
+          echo "    type: ${switchTypeOfYear}" >&3
+          echo "    file: <${relativePathFile}>" >&3
         fi
 
         #End of YAML section
-        echo "..." >> "${newFile}"
+        echo "..." >&3
       fi
+      exec 3>&-
     fi
   done
 }
@@ -1024,6 +839,24 @@ createIndexFile(){
   done
 }
 
+#Search the years ($3 : predicate) from $4 to $5, into the file $1
+#$2 : option of the search (or "")
+#with shards>1 : a process for each part of the years, then the parts are merged
+searchYears() {
+  yearsListFile="$1"
+  if (( shards > 1 )); then
+    for((shard=1; shard<=shards; shard++)); do
+      $calendarBin "-start=${startingDay}" $2 "-shard=${shard}/${shards}" -search "$3" "$4" "$5" > "${yearsListFile}.shard${shard}" &
+    done
+    wait
+    #the checksum of the merged list is printed
+    $calendarBin -merge "${yearsListFile}" "${yearsListFile}".shard*
+    rm -f "${yearsListFile}".shard*
+  else
+    $calendarBin "-start=${startingDay}" $2 -search "$3" "$4" "$5" > "${yearsListFile}"
+  fi
+}
+
 doPrintYears(){
   startingDay="$1"
   currentMode="$2"
@@ -1038,10 +871,6 @@ doPrintYears(){
     mkdir -p "${path}"
   fi
 
-  # Create an index with all years
-  echo "| Year | Type | 1st January |" > "${path}/${indexFile}"
-  echo "| ---- | ---- | ----------- |" >> "${path}/${indexFile}"
-
 
  #Create a list of year
  for year in "${yearsList[@]}"; do
@@ -1070,50 +899,20 @@ doPrintYears(){
       mkdir -p "${path}"
     fi
 
-    #Create a YEARS list
-    echo "| ${typeOfYear} years starting ${dayName} |" > "${path}/${yearsFile}"
-    echo "| --- |" >> "${path}/${yearsFile}"
+    #Create a YEARS list (one search for all the years of this type)
+    searchYears "${path}/${yearsFile}" "" "type=${typeOfYear,,}-${dayName,,}" "${startYear}" "${endYear}"
     
     #Add line to the indexfile
-    echo "" >> "${path}/${indexFile}"
-    echo "## Years" >> "${path}/${indexFile}"
-    echo "" >> "${path}/${indexFile}"
-    echo "[List of years](./${yearsFile})" >> "${path}/${indexFile}"
+    {
+      echo ""
+      echo "## Years"
+      echo ""
+      echo "[List of years](./${yearsFile})"
+    } >> "${path}/${indexFile}"
   done
 
-  #YEAR LOOP
-  for((year=startYear; year<endYear+1; year++)); do
-  
-    #Get information from the year
-    isLeap=`$calendarBin 1 "${year}" "-start=${startingDay}" -LeapYear`
-    weekNumber=`$calendarBin 1 1 "${year}" "-start=${startingDay}" -WkN`
-    dayName=`$calendarBin 1 1 "${year}" "-start=${startingDay}" -WD`
-    
-    #Get the type of the year (common or leap)
-    typeOfYear="${typesOfYear[${isLeap}]}"
-    #Create the path
-    path="${startingDay,,}/${currentMode}/${typeOfYear,,}"
-    
-    #Saturday+W53 is an exception
-    FolderDayName="${dayName}"
-    if [[ "${weekNumber}" == "W53" && "${dayName}" == "Saturday" ]]; then
-      dayName="${dayName}-W53"
-    fi
-    
-    #Create the weekday folder
-    path="${path}/${dayName,,}"
-
-    #Create folders if needed
-    if [ ! -d "${path}" ]; then
-      mkdir -p "${path}"
-    fi
-
-    # Add the year to the Year list
-    echo "| ${year} | ${typeOfYear} | [${dayName}](./${typeOfYear,,}/${dayName,,}/${indexFile}) |" >> "${startingDay,,}/${currentMode}/${indexFile}"
-    
-    #Add this year to the weekday-year file
-    echo "| ${year} |" >> "${path}/${yearsFile}"
-  done
+  #Add all the years to the index (type and 1st January of each year)
+  searchYears "${startingDay,,}/${currentMode}/${indexFile}" "-format=md" all "${startYear}" "${endYear}"
   
 }
 
@@ -1134,3 +933,8 @@ for weekDay in "${startingDays[@]}"; do
     doPrintYears "${weekDay}" "columns"  1583 3000
 done
 
+#Pack of the generated files : each different line stored once
+if [[ -n "${packFile}" ]]; then
+  echo "Creating the pack ${packFile}"
+  $calendarBin -pack "." "${packFile}"
+fi